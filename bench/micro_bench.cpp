@@ -0,0 +1,474 @@
+// Микробенчмарки горячих путей: парсер запроса, chunked, роутер, пути,
+// MIME и сборка заголовков ответа.
+//
+//   make bench
+//   ./build/bench/micro_bench [-t ms] [-j] [фильтр ...]
+//
+//   -t ms   сколько минимум гонять каждый замер (по умолчанию 300)
+//   -j      JSON Lines вместо TSV
+//   фильтр  подстрока имени: запускаются только совпавшие
+//
+// Вывод — одна строка на замер: ns/op, выделений памяти и их байт на op
+// (operator new подменён в этом бинарнике), обработанных байт на op и в
+// секунду. Формат стабилен: результаты двух сборок можно сравнивать скриптом.
+#include "webserv/http/Parser.hpp"
+#include "webserv/http/Chunked.hpp"
+#include "webserv/http/Router.hpp"
+#include "webserv/fs/Path.hpp"
+#include "webserv/utils/Mime.hpp"
+#include "webserv/utils/Time.hpp"
+#include "webserv/net/ResponseBuilder.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <string>
+#include <vector>
+
+// ---- подсчёт выделений ----------------------------------------------------
+
+static unsigned long long g_allocs = 0;
+static unsigned long long g_allocBytes = 0;
+
+#if __cplusplus >= 201103L
+#define BENCH_THROW_BAD_ALLOC
+#else
+#define BENCH_THROW_BAD_ALLOC throw(std::bad_alloc)
+#endif
+
+void *operator new(std::size_t n) BENCH_THROW_BAD_ALLOC
+{
+	++g_allocs;
+	g_allocBytes += n;
+	void *p = std::malloc(n ? n : 1);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+// noinline: иначе GCC после встраивания free() в вызывающий код
+// ругается -Wmismatched-new-delete на пару new/free
+__attribute__((noinline)) void operator delete(void *p) throw()
+{
+	std::free(p);
+}
+
+// ---- каркас ---------------------------------------------------------------
+
+// результат, который компилятор не может выбросить
+static volatile unsigned long g_sink = 0;
+
+static long long nowNs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+class Bench
+{
+public:
+	Bench(const char *name, size_t bytes) : _name(name), _bytes(bytes) {}
+	virtual ~Bench() {}
+	const char *name() const { return _name; }
+	size_t bytes() const { return _bytes; } // входных байт на одну операцию (0 — не считаем)
+	virtual void run(unsigned long long n) = 0;
+
+private:
+	const char *_name;
+	size_t _bytes;
+};
+
+struct Result
+{
+	unsigned long long iters;
+	double nsPerOp;
+	double allocsPerOp;
+	double allocBytesPerOp;
+};
+
+static Result measure(Bench &b, long long minNs)
+{
+	b.run(1); // прогрев: кэши, ленивые таблицы
+	unsigned long long n = 1;
+	for (;;)
+	{
+		const unsigned long long a0 = g_allocs, ab0 = g_allocBytes;
+		const long long t0 = nowNs();
+		b.run(n);
+		const long long dt = nowNs() - t0;
+		if (dt >= minNs || n >= (1ULL << 40))
+		{
+			Result r;
+			r.iters = n;
+			r.nsPerOp = (double)dt / (double)n;
+			r.allocsPerOp = (double)(g_allocs - a0) / (double)n;
+			r.allocBytesPerOp = (double)(g_allocBytes - ab0) / (double)n;
+			return r;
+		}
+		// следующая попытка — с запасом до minNs, но не больше чем в 100 раз
+		unsigned long long next = dt > 0 ? (unsigned long long)((double)n * 1.2 * (double)minNs / (double)dt) : n * 100;
+		if (next > n * 100)
+			next = n * 100;
+		if (next <= n)
+			next = n * 2;
+		n = next;
+	}
+}
+
+// ---- HttpParser -------------------------------------------------------------
+
+class ParserBench : public Bench
+{
+public:
+	// fragment: по сколько байт скармливать (0 — всё сразу); requests — запросов в data
+	ParserBench(const char *name, const std::string &data, size_t fragment, size_t requests)
+		: Bench(name, data.size()), _data(data), _fragment(fragment), _requests(requests) {}
+
+	void run(unsigned long long n)
+	{
+		ws::HttpParser p;
+		for (unsigned long long i = 0; i < n; ++i)
+		{
+			size_t done = 0;
+			if (!_fragment)
+			{
+				p.feed(_data.data(), _data.size());
+				while (done < _requests)
+				{
+					ws::HttpRequest req;
+					if (p.parse(req) != ws::HttpParser::OK)
+						break;
+					g_sink += req.headers.size();
+					++done;
+					p.nextRequest();
+				}
+			}
+			else
+			{
+				// как Connection: parse() после каждого recv
+				for (size_t off = 0; off < _data.size(); off += _fragment)
+				{
+					const size_t len = _data.size() - off < _fragment ? _data.size() - off : _fragment;
+					p.feed(_data.data() + off, len);
+					ws::HttpRequest req;
+					if (p.parse(req) == ws::HttpParser::OK)
+					{
+						g_sink += req.headers.size();
+						++done;
+						p.nextRequest();
+					}
+				}
+			}
+			if (done != _requests)
+			{
+				std::fprintf(stderr, "%s: parsed %lu of %lu requests\n", name(), (unsigned long)done, (unsigned long)_requests);
+				std::exit(1);
+			}
+			p.reset();
+		}
+	}
+
+private:
+	std::string _data;
+	size_t _fragment;
+	size_t _requests;
+};
+
+static std::string smallGet()
+{
+	return "GET /index.html HTTP/1.1\r\n"
+		   "Host: example.com\r\n"
+		   "User-Agent: Mozilla/5.0 (X11; Linux x86_64) bench\r\n"
+		   "Accept: text/html,application/xhtml+xml;q=0.9,*/*;q=0.8\r\n"
+		   "Accept-Encoding: gzip, deflate\r\n"
+		   "Connection: keep-alive\r\n"
+		   "\r\n";
+}
+
+static std::string largeHeaders()
+{
+	std::string r = "GET /api/v1/items?page=2&sort=name HTTP/1.1\r\nHost: example.com\r\n";
+	for (int i = 0; i < 40; ++i)
+	{
+		char line[160];
+		std::snprintf(line, sizeof(line), "X-Custom-Header-%02d: %s\r\n", i,
+					  "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef");
+		r += line;
+	}
+	r += "Cookie: session=";
+	r += std::string(1024, 'c');
+	r += "\r\n\r\n";
+	return r;
+}
+
+// ---- ChunkedDecoder ---------------------------------------------------------
+
+class ChunkedBench : public Bench
+{
+public:
+	ChunkedBench(const char *name, const std::string &encoded, size_t body)
+		: Bench(name, encoded.size()), _in(encoded), _body(body) {}
+
+	void run(unsigned long long n)
+	{
+		std::string out;
+		out.reserve(_body);
+		for (unsigned long long i = 0; i < n; ++i)
+		{
+			ws::ChunkedDecoder d;
+			size_t consumed = 0;
+			out.clear();
+			if (!d.feed(_in, consumed, out) || out.size() != _body)
+			{
+				std::fprintf(stderr, "%s: decoder did not finish\n", name());
+				std::exit(1);
+			}
+			g_sink += consumed;
+		}
+	}
+
+private:
+	std::string _in;
+	size_t _body;
+};
+
+static std::string chunkedBody(size_t body, size_t chunk)
+{
+	std::string r;
+	for (size_t off = 0; off < body; off += chunk)
+	{
+		const size_t len = body - off < chunk ? body - off : chunk;
+		ws::appendHex(r, len);
+		r += "\r\n";
+		r.append(len, 'x');
+		r += "\r\n";
+	}
+	r += "0\r\n\r\n";
+	return r;
+}
+
+// ---- Router -----------------------------------------------------------------
+
+class RouterBench : public Bench
+{
+public:
+	RouterBench(const char *name, size_t vhosts) : Bench(name, 0), _router(0), _lr(0)
+	{
+		static const char *const prefixes[] = {"/", "/static/", "/api/", "/api/v1/", "/images/", "/upload"};
+		for (size_t i = 0; i < vhosts; ++i)
+		{
+			ws::ServerConfig s;
+			s.host = "0.0.0.0";
+			s.port = 8080;
+			char name[64];
+			std::snprintf(name, sizeof(name), "h%lu.example.com", (unsigned long)i);
+			s.server_names.push_back(name);
+			for (size_t k = 0; k < sizeof(prefixes) / sizeof(prefixes[0]); ++k)
+			{
+				ws::Location l;
+				l.path = prefixes[k];
+				s.locations.push_back(l);
+			}
+			ws::Location exact;
+			exact.match = ws::LOC_EXACT;
+			exact.path = "/status";
+			s.locations.push_back(exact);
+			ws::Location re;
+			re.match = ws::LOC_REGEX;
+			re.path = "\\.php$";
+			s.locations.push_back(re);
+			_cfg.servers.push_back(s);
+			_hosts.push_back(name);
+		}
+		_hosts.push_back("unknown.example.org"); // default_server
+		_targets.push_back("/api/v1/users/42");
+		_targets.push_back("/static/css/site.css");
+		_targets.push_back("/index.php");
+		_targets.push_back("/status");
+		_targets.push_back("/about");
+		_router = new ws::Router(&_cfg);
+		_lr = _router->listenerRoutes("0.0.0.0", 8080);
+	}
+	~RouterBench() { delete _router; }
+
+	void run(unsigned long long n)
+	{
+		for (unsigned long long i = 0; i < n; ++i)
+		{
+			const ws::RouteMatch m = _router->resolve(_lr, _hosts[(i * 7) % _hosts.size()], _targets[i % _targets.size()]);
+			g_sink += (unsigned long)(m.location != 0);
+		}
+	}
+
+private:
+	ws::Config _cfg;
+	ws::Router *_router;
+	const ws::ListenerRoutes *_lr;
+	std::vector<std::string> _hosts;
+	std::vector<std::string> _targets;
+};
+
+// ---- пути, MIME -------------------------------------------------------------
+
+class NormalizeBench : public Bench
+{
+public:
+	NormalizeBench() : Bench("path/normalize", 0), _p("/static/./css/../img//icons/../logo.png") {}
+	void run(unsigned long long n)
+	{
+		for (unsigned long long i = 0; i < n; ++i)
+			g_sink += ws::normalizePath(_p).size();
+	}
+
+private:
+	std::string _p;
+};
+
+class TraversalBench : public Bench
+{
+public:
+	TraversalBench() : Bench("path/traversal_suspect", 0)
+	{
+		_p[0] = "/static/css/site.css";
+		_p[1] = "/static/%2e%2e/%2e%2e/etc/passwd";
+	}
+	void run(unsigned long long n)
+	{
+		for (unsigned long long i = 0; i < n; ++i)
+			g_sink += (unsigned long)ws::pathTraversalSuspect(_p[i & 1]);
+	}
+
+private:
+	std::string _p[2];
+};
+
+class MimeBench : public Bench
+{
+public:
+	MimeBench() : Bench("mime/by_ext", 0)
+	{
+		static const char *const names[] = {"/index.html", "/app.js", "/style.css", "/img/logo.png",
+											"/video.mp4", "/README", "/archive.tar.gz", "/font.woff2"};
+		for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i)
+			_names.push_back(names[i]);
+	}
+	void run(unsigned long long n)
+	{
+		for (unsigned long long i = 0; i < n; ++i)
+			g_sink += ws::mimeByExt(_names[i % _names.size()]).size();
+	}
+
+private:
+	std::vector<std::string> _names;
+};
+
+// ---- заголовки ответа -------------------------------------------------------
+
+class HeadersBench : public Bench
+{
+public:
+	explicit HeadersBench(bool tpl) : Bench(tpl ? "response/headers_template" : "response/headers", 0), _tpl(tpl)
+	{
+		_reason = "OK";
+		_ctype = "text/html";
+		ws::renderHeaderTemplate(_t, 200, _reason, _ctype, 4096);
+	}
+	void run(unsigned long long n)
+	{
+		std::string out;
+		out.reserve(512); // как Connection::_out: ёмкость живёт между ответами
+		const std::string none;
+		for (unsigned long long i = 0; i < n; ++i)
+		{
+			out.clear();
+			if (_tpl)
+				ws::appendFromTemplate(out, _t, true);
+			else
+				ws::appendHeaders(out, 200, _reason, _ctype, 4096, true, none, none);
+			g_sink += out.size();
+		}
+	}
+
+private:
+	bool _tpl;
+	std::string _reason;
+	std::string _ctype;
+	ws::HeaderTemplate _t;
+};
+
+// ---- main -------------------------------------------------------------------
+
+static bool selected(const char *name, const std::vector<const char *> &filters)
+{
+	if (filters.empty())
+		return true;
+	for (size_t i = 0; i < filters.size(); ++i)
+		if (std::strstr(name, filters[i]))
+			return true;
+	return false;
+}
+
+int main(int argc, char **argv)
+{
+	long long minMs = 300;
+	bool json = false;
+	std::vector<const char *> filters;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (!std::strcmp(argv[i], "-t") && i + 1 < argc)
+			minMs = std::atol(argv[++i]);
+		else if (!std::strcmp(argv[i], "-j"))
+			json = true;
+		else
+			filters.push_back(argv[i]);
+	}
+	if (minMs <= 0)
+		minMs = 1;
+	ws::refreshHttpDate(std::time(0)); // Date в заголовках — из кэша, как в цикле
+
+	std::string pipelined;
+	for (int i = 0; i < 16; ++i)
+		pipelined += smallGet();
+
+	std::vector<Bench *> all;
+	all.push_back(new ParserBench("parser/small_get", smallGet(), 0, 1));
+	all.push_back(new ParserBench("parser/large_headers", largeHeaders(), 0, 1));
+	all.push_back(new ParserBench("parser/pipelined_16", pipelined, 0, 16));
+	all.push_back(new ParserBench("parser/fragmented_8b", smallGet(), 8, 1));
+	all.push_back(new ParserBench("parser/fragmented_1460b", largeHeaders(), 1460, 1));
+	all.push_back(new ChunkedBench("chunked/64k_in_4k", chunkedBody(64 * 1024, 4096), 64 * 1024));
+	all.push_back(new ChunkedBench("chunked/64k_in_64b", chunkedBody(64 * 1024, 64), 64 * 1024));
+	all.push_back(new RouterBench("router/resolve_1_vhost", 1));
+	all.push_back(new RouterBench("router/resolve_64_vhosts", 64));
+	all.push_back(new RouterBench("router/resolve_1024_vhosts", 1024));
+	all.push_back(new NormalizeBench());
+	all.push_back(new TraversalBench());
+	all.push_back(new MimeBench());
+	all.push_back(new HeadersBench(false));
+	all.push_back(new HeadersBench(true));
+
+	if (!json)
+		std::printf("bench\titers\tns_per_op\tallocs_per_op\talloc_bytes_per_op\tbytes_per_op\tbytes_per_sec\n");
+	for (size_t i = 0; i < all.size(); ++i)
+	{
+		Bench &b = *all[i];
+		if (!selected(b.name(), filters))
+			continue;
+		const Result r = measure(b, minMs * 1000000LL);
+		const double bps = b.bytes() ? (double)b.bytes() * 1e9 / r.nsPerOp : 0.0;
+		if (json)
+			std::printf("{\"bench\":\"%s\",\"iters\":%llu,\"ns_per_op\":%.2f,\"allocs_per_op\":%.2f,"
+						"\"alloc_bytes_per_op\":%.1f,\"bytes_per_op\":%lu,\"bytes_per_sec\":%.0f}\n",
+						b.name(), r.iters, r.nsPerOp, r.allocsPerOp, r.allocBytesPerOp, (unsigned long)b.bytes(), bps);
+		else
+			std::printf("%s\t%llu\t%.2f\t%.2f\t%.1f\t%lu\t%.0f\n", b.name(), r.iters, r.nsPerOp, r.allocsPerOp,
+						r.allocBytesPerOp, (unsigned long)b.bytes(), bps);
+		std::fflush(stdout);
+	}
+	for (size_t i = 0; i < all.size(); ++i)
+		delete all[i];
+	return (int)(g_sink & 0); // g_sink читается: оптимизатор не выкинет замеры
+}
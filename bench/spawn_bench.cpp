@@ -0,0 +1,117 @@
+// Латентность запуска CGI в зависимости от размера кучи сервера:
+// fork()+execve() против CgiHandler::spawn() (posix_spawn).
+//
+//   make bench-spawn
+//   ./build/spawn_bench [-n iterations] [-b /bin/true] [heap_mb ...]
+//
+// Вывод: одна строка на размер кучи, микросекунды на запуск (среднее).
+#include "webserv/http/Cgi.hpp"
+
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static double nowUs()
+{
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return (double)tv.tv_sec * 1e6 + (double)tv.tv_usec;
+}
+
+// «кэш» сервера: тронутые страницы, которые fork обязан отобразить в ребёнка
+static std::vector<char *> g_heap;
+
+static void growHeap(size_t mb)
+{
+	const size_t block = 1 << 20;
+	while (g_heap.size() < mb)
+	{
+		char *p = static_cast<char *>(std::malloc(block));
+		if (!p)
+			break;
+		for (size_t i = 0; i < block; i += 4096)
+			p[i] = 1;
+		g_heap.push_back(p);
+	}
+}
+
+static double benchFork(const ws::CgiLaunch &l, int iters)
+{
+	char *argv[3] = {const_cast<char *>(l.bin.c_str()), const_cast<char *>(l.script.c_str()), NULL};
+	char *envp[1] = {NULL};
+	double t0 = nowUs();
+	for (int i = 0; i < iters; ++i)
+	{
+		pid_t pid = fork();
+		if (pid == 0)
+		{
+			execve(argv[0], argv, envp);
+			_exit(127);
+		}
+		int st = 0;
+		if (pid > 0)
+			waitpid(pid, &st, 0);
+	}
+	return (nowUs() - t0) / iters;
+}
+
+static double benchSpawn(const ws::CgiLaunch &l, int iters)
+{
+	double t0 = nowUs();
+	for (int i = 0; i < iters; ++i)
+	{
+		int in = -1, out = -1;
+		pid_t pid = ws::CgiHandler::spawn(l, in, out);
+		if (pid < 0)
+			return -1;
+		close(in);
+		close(out);
+		int st = 0;
+		waitpid(pid, &st, 0);
+	}
+	return (nowUs() - t0) / iters;
+}
+
+int main(int argc, char **argv)
+{
+	int iters = 200;
+	ws::CgiLaunch l;
+	l.bin = "/bin/true";
+	l.script = "script";
+	l.env = std::string("GATEWAY_INTERFACE=CGI/1.1\0SERVER_SOFTWARE=webserv-dev\0", 53);
+	std::vector<size_t> sizes;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (!std::strcmp(argv[i], "-n") && i + 1 < argc)
+			iters = std::atoi(argv[++i]);
+		else if (!std::strcmp(argv[i], "-b") && i + 1 < argc)
+			l.bin = argv[++i];
+		else
+			sizes.push_back((size_t)std::atoi(argv[i]));
+	}
+	if (sizes.empty())
+	{
+		sizes.push_back(0);
+		sizes.push_back(64);
+		sizes.push_back(256);
+		sizes.push_back(1024);
+	}
+	if (iters <= 0)
+		iters = 1;
+
+	std::printf("%-10s %14s %14s\n", "heap_mb", "fork_us", "spawn_us");
+	for (size_t i = 0; i < sizes.size(); ++i)
+	{
+		growHeap(sizes[i]);
+		double f = benchFork(l, iters);
+		double s = benchSpawn(l, iters);
+		std::printf("%-10lu %14.1f %14.1f\n", (unsigned long)g_heap.size(), f, s);
+	}
+	return 0;
+}
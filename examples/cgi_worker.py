@@ -0,0 +1,79 @@
+# Воркер для `cgi_pool`: интерпретатор стартует один раз и выполняет
+# CGI-скрипты по очереди, запрос за запросом.
+#
+# Протокол (оба направления): кадры "<длина>\n<байты>", кадр длины 0 —
+# конец потока. На запрос: окружение "K=V\0K=V\0...", кадры тела, пустой кадр.
+# Ответ: CGI-вывод кадрами, пустой кадр. EOF на stdin — выход.
+import io
+import os
+import runpy
+import sys
+import traceback
+
+# настоящий stdout — только для кадров; случайные записи в fd 1 уйдут в stderr
+_out = os.fdopen(os.dup(1), "wb")
+os.dup2(2, 1)
+_in = sys.stdin.buffer
+_base_env = dict(os.environb)
+
+
+def read_frame():
+    line = _in.readline()
+    if not line:
+        return None
+    n = int(line)
+    return _in.read(n) if n else b""
+
+
+def write_frame(data):
+    _out.write(b"%d\n" % len(data))
+    _out.write(data)
+
+
+class FrameWriter(io.RawIOBase):
+    def writable(self):
+        return True
+
+    def write(self, b):
+        if b:
+            write_frame(bytes(b))
+            _out.flush()
+        return len(b)
+
+
+while True:
+    env = read_frame()
+    if env is None:
+        break
+    body = []
+    while True:
+        chunk = read_frame()
+        if chunk is None:
+            sys.exit(0)
+        if not chunk:
+            break
+        body.append(chunk)
+
+    os.environb.clear()
+    os.environb.update(_base_env)
+    for kv in env.split(b"\0"):
+        k, eq, v = kv.partition(b"=")
+        if eq:
+            os.environb[k] = v
+
+    raw = io.BufferedWriter(FrameWriter(), 65536)
+    sys.stdout = io.TextIOWrapper(raw, encoding="utf-8")
+    sys.stdin = io.TextIOWrapper(io.BufferedReader(io.BytesIO(b"".join(body))), encoding="utf-8")
+    try:
+        runpy.run_path(os.environ.get("SCRIPT_FILENAME", ""), run_name="__main__")
+    except SystemExit:
+        pass
+    except BaseException:
+        traceback.print_exc()
+    try:
+        sys.stdout.flush()
+    except Exception:
+        pass
+    sys.stdout = sys.__stdout__
+    write_frame(b"")
+    _out.flush()
@@ -15,10 +15,45 @@ public:
     static void error(const std::string &msg);
     static void debug(const std::string &msg);
 
+    // порог error_log: сообщения ниже него не пишутся (по умолчанию INFO)
+    static void setLevel(Level lvl) { _level = lvl; }
+    static bool enabled(Level lvl) { return lvl >= _level; }
+    // debug | info | notice | warn | error | crit | alert | emerg (как у nginx)
+    static bool levelFromName(const std::string &name, Level &lvl);
+    // число для текста сообщения: "fd " + Log::num(fd)
+    static std::string num(long long v);
+
 private:
+    static Level _level;
     static const char* levelToStr(Level lvl);
 };
 
 }
 
+// Отладочные сообщения: без -DNDEBUG есть, с ним (release) вырезаются при
+// компиляции вместе с аргументами. Явно: -DWEBSERV_DEBUG_LOG=0/1.
+#ifndef WEBSERV_DEBUG_LOG
+# ifdef NDEBUG
+#  define WEBSERV_DEBUG_LOG 0
+# else
+#  define WEBSERV_DEBUG_LOG 1
+# endif
+#endif
+
+// Аргумент вычисляется, только если уровень включён: строки для
+// отключённых сообщений не собираются.
+#define WS_LOG(lvl, msg) \
+    do { if (::ws::Log::enabled(lvl)) ::ws::Log::write((lvl), (msg)); } while (0)
+
+#define WS_LOG_INFO(msg)  WS_LOG(::ws::Log::INFO, msg)
+#define WS_LOG_WARN(msg)  WS_LOG(::ws::Log::WARN, msg)
+#define WS_LOG_ERROR(msg) WS_LOG(::ws::Log::ERROR, msg)
+#if WEBSERV_DEBUG_LOG
+# define WS_LOG_DEBUG(msg) WS_LOG(::ws::Log::DEBUG, msg)
+#else
+// if (false): выражение проверяется компилятором, но кода не остаётся
+# define WS_LOG_DEBUG(msg) \
+    do { if (false) ::ws::Log::write(::ws::Log::DEBUG, (msg)); } while (0)
+#endif
+
 #endif
@@ -8,23 +8,65 @@
 
 namespace ws {
 
+enum LocationMatch {
+    LOC_PREFIX,   // location /path      — самый длинный префикс
+    LOC_EXACT,    // location = /path    — точное совпадение
+    LOC_REGEX     // location ~ "re"     — регулярное выражение (~* — без учёта регистра)
+};
+
+// access_log path [format] [buffer=size] [flush=time] | off
+struct AccessLogConfig {
+    std::string path;           // пусто — не писать
+    std::string format;         // combined | common | timing
+    size_t buffer;              // кольцо на поток, байт
+    size_t flush_ms;            // не реже — в файл
+    bool set;                   // задано в этом блоке (location без него — как у сервера)
+
+    AccessLogConfig() : format("combined"), buffer(64 * 1024), flush_ms(1000), set(false) {}
+};
+
 struct Location {
-    std::string path;
+    std::string path;           // для LOC_REGEX — само выражение
+    LocationMatch match;
+    bool regex_icase;
     std::vector<std::string> allow_methods;
+    unsigned allow_mask;        // скомпилировано из allow_methods (биты ws::Method)
+    std::string allow_header;   // готовое значение заголовка Allow
     std::string root;
     std::string alias;
     std::vector<std::string> index;
     bool autoindex;
+    bool internal;              // только для X-Accel-Redirect из CGI; снаружи — 404
+    bool stub_status;           // location отдаёт метрики сервера (текст или Prometheus)
+    size_t aio_threads;         // aio threads [N]: stat/open/запись/unlink в пуле потоков (0 — в цикле)
     bool upload_enable;
     std::string upload_store;
+    bool upload_durable;        // upload_durability group: 201/204 только после fdatasync файла и каталога
+    size_t upload_sync_delay;   // мс: сколько группа ждёт попутчиков
+    size_t upload_sync_batch;   // столько ожидающих — синхронизируем, не дожидаясь срока
     int return_code;
     std::string return_url;
     std::string cgi_ext;
     std::string cgi_bin;
+    std::string cgi_env;        // статическая часть окружения CGI ("K=V\0..."), готовится при загрузке
+    std::string fastcgi_pass;   // unix:/path.sock | host:port — вместо запуска cgi_bin
+    std::string proxy_pass;     // http://host[:port][/uri] — HTTP/1.1 backend
+    size_t cgi_pool;            // сколько тёплых воркеров cgi_bin держать (0 — запуск на запрос)
+    std::string cgi_pool_worker;       // скрипт-воркер, которому cgi_bin отдаёт запросы
+    size_t cgi_pool_max_requests;      // после стольких запросов воркер перезапускается
+    size_t cgi_max_concurrency; // одновременно выполняемых запросов (0 — без ограничения)
+    size_t cgi_queue;           // сколько ещё ждут слота; дальше — 503
+    size_t cgi_timeout;         // секунд на ожидание + выполнение (0 — без ограничения)
+    std::map<int, size_t> cache_valid; // микрокэш ответов CGI/autoindex: код -> секунд (пусто — выкл.)
     size_t client_max_body_size;
+    size_t stats_slot;          // номер гистограмм задержек (Metrics::latency), задаёт Parser
+    AccessLogConfig access_log;
 
-    Location() : autoindex(false), upload_enable(false),
-                 return_code(0), client_max_body_size(0) {}
+    Location() : match(LOC_PREFIX), regex_icase(false), allow_mask(0),
+                 autoindex(false), internal(false), stub_status(false), aio_threads(0), upload_enable(false),
+                 upload_durable(false), upload_sync_delay(2), upload_sync_batch(32), return_code(0), cgi_pool(0), cgi_pool_max_requests(1000),
+                 cgi_max_concurrency(0), cgi_queue(16), cgi_timeout(60),
+                 client_max_body_size(0), stats_slot(0) {}
 };
 
 struct ServerConfig {
@@ -35,12 +77,18 @@ struct ServerConfig {
     std::map<int, std::string> error_pages;
     size_t client_max_body_size;
     std::vector<Location> locations;
+    size_t stats_slot;          // запросы, не попавшие ни в один location
+    AccessLogConfig access_log;
 
-    ServerConfig() : port(80), client_max_body_size(1<<20) {}
+    ServerConfig() : port(80), client_max_body_size(1<<20), stats_slot(0) {}
 };
 
 struct Config {
     std::vector<ServerConfig> servers;
+    size_t stats_slots;         // серверов + location'ов: по гистограмме задержек на каждый
+    std::string error_log;      // порог сообщений в stderr (Log::levelFromName)
+
+    Config() : stats_slots(0), error_log("info") {}
 };
 
 struct ConfigError : public std::runtime_error {
@@ -50,6 +98,12 @@ struct ConfigError : public std::runtime_error {
 };
 
 size_t parseSizeWithUnits(const std::string& s, size_t ln, size_t col);
+// целое без единиц (число воркеров, лимиты); what — имя директивы для ошибки
+size_t parseCount(const std::string& s, const char* what, size_t ln, size_t col);
+// длительность в секундах: 30, 30s, 2m
+size_t parseSeconds(const std::string& s, const char* what, size_t ln, size_t col);
+// длительность в миллисекундах: 5, 5ms, 1s
+size_t parseMillis(const std::string& s, const char* what, size_t ln, size_t col);
 
 } // namespace ws
 #endif
\ No newline at end of file
@@ -22,6 +22,7 @@ private:
     void parseServer(Config& cfg);
     void parseServerBody(ServerConfig& srv);
     void parseLocation(ServerConfig& srv);
+    void parseAccessLog(AccessLogConfig& al);
 
     static bool toBool(const std::string& s);
 };
@@ -3,6 +3,8 @@
 
 #include <string>
 #include <map>
+#include <vector>
+#include <sys/types.h>
 #include "webserv/http/Request.hpp"
 #include "webserv/config/Config.hpp"
 
@@ -15,18 +17,50 @@ namespace ws
 		std::string reason;
 		std::map<std::string, std::string> headers; // lower-case ключи
 		std::string body;
+		std::string accelRedirect; // X-Accel-Redirect: URI internal-location, тело скрипта не нужно
+		std::string sendfile;      // X-Sendfile: путь к файлу, тело скрипта не нужно
+		std::string extraHeaders;  // остальные заголовки ответа как есть, "K: V\r\n" — клиенту
 		CgiResult() : status(200), reason("OK"), headers(), body() {}
 	};
 
+	// всё, что нужно для запуска скрипта; собирается в родителе до запуска
+	struct CgiLaunch
+	{
+		std::string bin;	// cgi_bin
+		std::string script; // путь скрипта относительно CWD (argv[1])
+		std::string env;	// "K=V\0K=V\0...": шаблон location + переменные запроса
+	};
+
 	class CgiHandler
 	{
 	public:
-		// true: это был CGI-кандидат, ответ собран в out (даже если 4xx/5xx)
-		// false: не CGI — пусть обрабатывает статика
-		static bool handle(const ServerConfig &srv,
+		// CGI-кандидат: location с cgi_bin/fastcgi_pass и подходящим расширением
+		// (regex-location уже отобрал путь сам, fastcgi_pass без cgi_ext
+		// забирает всё в location — cgi_ext не обязателен)
+		static bool matches(const Location *loc, const HttpRequest &req);
+
+		// argv/env для запуска; 0 — готово, иначе HTTP-код ошибки (403)
+		static int prepare(const ServerConfig &srv,
 						   const Location *loc,
 						   const HttpRequest &req,
-						   CgiResult &out);
+						   CgiLaunch &out);
+
+		// статическая часть окружения location (GATEWAY_INTERFACE, SERVER_*):
+		// строится один раз при загрузке конфига -> Location::cgi_env
+		static std::string envTemplate(const ServerConfig &srv, const Location &loc);
+
+		// запуск через posix_spawn: stdin/stdout — наши концы пайпов (блокирующие,
+		// close-on-exec); -1 если пайпы/запуск не удались
+		static pid_t spawn(const CgiLaunch &launch, int &stdinFd, int &stdoutFd);
+
+		// разбор CGI-вывода целиком: заголовки (до пустой строки) + тело
+		static void parseOutput(const std::string &out, CgiResult &res);
+
+		// потоковый разбор: есть ли уже пустая строка после заголовков?
+		// hdrLen — длина блока заголовков, bodyOff — начало тела
+		static bool headerEnd(const std::string &out, size_t &hdrLen, size_t &bodyOff);
+		// только заголовки (Status, Content-Type, ...) — без тела
+		static void parseHeaders(const std::string &hdrs, CgiResult &res);
 	};
 
 } // namespace ws
@@ -0,0 +1,71 @@
+#ifndef WEBSERV_HTTP_FASTCGI_HPP
+#define WEBSERV_HTTP_FASTCGI_HPP
+
+#include <string>
+#include <map>
+
+namespace ws
+{
+
+	// FastCGI 1.0: кодирование/разбор записей. Сеть — в net/FcgiPool.
+	enum FcgiType
+	{
+		FCGI_BEGIN_REQUEST = 1,
+		FCGI_ABORT_REQUEST = 2,
+		FCGI_END_REQUEST = 3,
+		FCGI_PARAMS = 4,
+		FCGI_STDIN = 5,
+		FCGI_STDOUT = 6,
+		FCGI_STDERR = 7,
+		FCGI_GET_VALUES = 9,
+		FCGI_GET_VALUES_RESULT = 10
+	};
+
+	struct FcgiRecord
+	{
+		int type;
+		unsigned id; // 0 — управляющие записи
+		std::string content;
+	};
+
+	// fastcgi_pass unix:/path.sock | host:port
+	struct FcgiAddress
+	{
+		bool isUnix;
+		std::string path; // unix
+		std::string host; // tcp
+		int port;
+		FcgiAddress() : isUnix(false), port(0) {}
+	};
+
+	// false + err, если строка не похожа ни на unix:/path, ни на host:port
+	bool fcgiParseAddress(const std::string &spec, FcgiAddress &out, std::string &err);
+
+	// запись(и) type/id; содержимое длиннее 65535 режется на несколько записей;
+	// n == 0 — пустая запись (конец потока PARAMS/STDIN)
+	void fcgiAppendRecord(std::string &out, int type, unsigned id, const char *data, size_t n);
+	void fcgiAppendBeginRequest(std::string &out, unsigned id, bool keepConn);
+	// пара имя-значение (длины 1 или 4 байта)
+	void fcgiAppendPair(std::string &out, const char *name, size_t nlen, const char *val, size_t vlen);
+	// блок окружения CGI "K=V\0K=V\0..." -> пары для FCGI_PARAMS
+	void fcgiEnvToParams(const std::string &env, std::string &params);
+	// разбор пар (ответ FCGI_GET_VALUES_RESULT)
+	bool fcgiParsePairs(const std::string &in, std::map<std::string, std::string> &out);
+
+	// Потоковый разбор входящих записей: feed() кусками, next() — по одной.
+	class FcgiReader
+	{
+	public:
+		FcgiReader() : _off(0) {}
+		void feed(const char *data, size_t n);
+		// true — запись готова в rec; false — нужно ещё данных
+		bool next(FcgiRecord &rec);
+		void reset();
+
+	private:
+		std::string _buf;
+		size_t _off; // начало неразобранного
+	};
+
+} // namespace ws
+#endif
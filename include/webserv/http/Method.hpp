@@ -0,0 +1,40 @@
+#ifndef WEBSERV_HTTP_METHOD_HPP
+#define WEBSERV_HTTP_METHOD_HPP
+
+#include <string>
+#include <vector>
+
+namespace ws
+{
+
+	// Методы как биты: маска allow_methods проверяется одним AND
+	enum Method
+	{
+		M_UNKNOWN = 0,
+		M_GET = 1 << 0,
+		M_HEAD = 1 << 1,
+		M_POST = 1 << 2,
+		M_DELETE = 1 << 3,
+		M_PUT = 1 << 4,
+		M_PATCH = 1 << 5
+	};
+
+	// методы, которые ядро сервера умеет обслуживать
+	const unsigned METHODS_IMPLEMENTED = M_GET | M_HEAD | M_POST | M_DELETE | M_PATCH; // PATCH — возобновляемые загрузки
+	// что разрешено, если location не найден
+	const unsigned METHODS_DEFAULT = M_GET | M_HEAD | M_POST | M_DELETE;
+
+	// "GET" -> M_GET; неизвестное -> M_UNKNOWN
+	Method methodFromToken(const char *s, size_t n);
+	const char *methodName(Method m);
+
+	// allow_methods -> маска (HEAD разрешён ровно тогда, когда разрешён GET).
+	// false, если в списке встретилось неизвестное имя (badName заполнено).
+	bool compileMethodMask(const std::vector<std::string> &names,
+						   unsigned &mask, std::string &badName);
+
+	// значение заголовка Allow по маске, напр. "GET, POST, DELETE, HEAD"
+	std::string allowHeaderValue(unsigned mask);
+
+} // namespace ws
+#endif
@@ -0,0 +1,69 @@
+#ifndef WEBSERV_HTTP_MULTIPART_HPP
+#define WEBSERV_HTTP_MULTIPART_HPP
+
+#include <string>
+
+namespace ws
+{
+
+	// boundary из Content-Type: multipart/form-data; boundary=...
+	// false — не multipart/form-data или boundary нет/некорректен
+	bool multipartBoundary(const std::string &contentType, std::string &boundary);
+
+	// Заголовки одной части
+	struct MultipartPart
+	{
+		std::string name;		 // Content-Disposition: name
+		std::string filename;	 // Content-Disposition: filename (пусто — обычное поле)
+		std::string contentType; // Content-Type части (по умолчанию text/plain)
+	};
+
+	// Куда парсер отдаёт части; false из любого вызова прерывает разбор
+	class MultipartSink
+	{
+	public:
+		virtual ~MultipartSink() {}
+		virtual bool partBegin(const MultipartPart &p) = 0;
+		virtual bool partData(const char *data, size_t n) = 0;
+		virtual bool partEnd() = 0;
+	};
+
+	// Потоковый разбор multipart/form-data (RFC 7578): тело подаётся кусками
+	// любого размера, данные частей уходят в sink сразу. Разделитель ищется
+	// Boyer–Moore–Horspool; между вызовами копится не больше его длины
+	// (плюс заголовки текущей части), так что память не зависит от размера тела.
+	class MultipartParser
+	{
+	public:
+		explicit MultipartParser(const std::string &boundary);
+
+		// false — нарушен формат или sink отказался
+		bool feed(const char *data, size_t n, MultipartSink &sink);
+		// дошли до закрывающего --boundary--
+		bool done() const { return _st == EPILOGUE; }
+
+		static const size_t MAX_PART_HEADERS = 8192;
+
+	private:
+		enum State
+		{
+			PREAMBLE,  // до первого разделителя
+			DELIMITER, // после разделителя: "--" (конец) или CRLF (часть)
+			HEADERS,
+			BODY,
+			EPILOGUE,
+			FAILED
+		};
+
+		State _st;
+		std::string _delim;	 // "\r\n--" + boundary
+		size_t _skip[256];	 // BMH: сдвиг по последнему байту окна
+		std::string _buf;	 // хвост, который ещё может оказаться началом разделителя
+		bool _inPart;
+
+		size_t find(const char *hay, size_t n) const;
+		bool parsePartHeaders(const std::string &block, MultipartPart &p) const;
+	};
+}
+
+#endif
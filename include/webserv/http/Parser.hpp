@@ -16,6 +16,7 @@ namespace ws
 		enum Result
 		{
 			NEED_MORE,
+			HEADERS, // заголовки разобраны, тело ещё впереди (out — без тела)
 			OK,
 			BAD_REQUEST,
 			NOT_IMPLEMENTED,
@@ -27,13 +28,35 @@ namespace ws
 		void feed(const char *data, size_t n);
 
 		// Пытается распарсить запрос. При OK — HttpRequest заполнен и тело декодировано.
+		// Если у запроса есть тело, сначала один раз возвращается HEADERS: можно
+		// маршрутизировать до прихода тела и либо продолжить parse(), либо
+		// забирать тело по частям через readBody().
 		Result parse(HttpRequest &out);
 
+		// Потоковый режим (после HEADERS): дописывает в chunk доступные байты
+		// декодированного тела, не копя их в запросе. NEED_MORE — тело ещё не всё,
+		// OK — дочитано; ENTITY_TOO_LARGE/BAD_REQUEST — ошибка.
+		Result readBody(std::string &chunk);
+
+		// Content-Length тело, которого ещё нет в буфере: его можно забрать из
+		// сокета мимо парсера (splice). 0 — нельзя (chunked, буфер не пуст, конец).
+		size_t rawBodyLeft() const;
+		// n байт такого тела забрано мимо парсера
+		void skipRawBody(size_t n);
+
+		// После HEADERS, когда известен маршрут: лимит тела этого запроса
+		// (client_max_body_size). false — объявленный Content-Length уже больше;
+		// chunked-тело проверяется по мере декодирования.
+		bool setBodyLimit(size_t n);
+
 		// Настройки/лимиты:
 		size_t maxRequestLine; // 8 KB
 		size_t maxHeaderBytes; // 64 KB
-		size_t maxBodyBytes;   // 10 MB (или меньше из конфига позже)
+		size_t maxBodyBytes;   // 10 MB, пока setBodyLimit() не задал лимит запроса
+		static const size_t DEFAULT_MAX_BODY = 10 * 1024 * 1024;
 		void reset();
+		// как reset(), но уже пришедшие байты следующего запроса (pipelining) остаются
+		void nextRequest();
 
 	private:
 		enum State
@@ -47,6 +70,7 @@ namespace ws
 		std::string _buf; // входящий буфер (сырые байты)
 		//size_t _hdrEnd;	  // позиция конца заголовков (\r\n\r\n)
 		size_t _needBody; // для Content-Length
+		size_t _bodySeen; // сколько тела отдано через readBody()
 		ChunkedDecoder _chunked;
 		HttpRequest _req;
 
@@ -0,0 +1,84 @@
+#ifndef WEBSERV_HTTP_PROXY_HPP
+#define WEBSERV_HTTP_PROXY_HPP
+
+#include <string>
+#include "webserv/http/Request.hpp"
+
+namespace ws
+{
+
+	// HTTP/1.1 к upstream: разбор proxy_pass, заголовок запроса, разбор ответа.
+	// Сеть — в net/ProxyPool.
+
+	// proxy_pass http://host[:port][/uri]
+	struct ProxyTarget
+	{
+		std::string host;
+		int port;
+		std::string uri; // пусто — target клиента как есть; иначе заменяет префикс location
+		ProxyTarget() : port(80) {}
+	};
+
+	bool proxyParseTarget(const std::string &spec, ProxyTarget &out, std::string &err);
+
+	enum ProxyBody
+	{
+		PROXY_BODY_NONE,
+		PROXY_BODY_LENGTH, // Content-Length клиента, байты как есть
+		PROXY_BODY_CHUNKED // длина заранее неизвестна: перекодируем в chunked
+	};
+
+	// Строка запроса + сквозные заголовки клиента (hop-by-hop выброшены,
+	// Host клиента сохраняется, без него — upstreamHost; X-Forwarded-For/-Proto
+	// дописываются) + "Connection: keep-alive".
+	std::string proxyRequestHead(const HttpRequest &req, const std::string &target,
+								 const std::string &upstreamHost, const std::string &clientAddr,
+								 ProxyBody &body);
+
+	// Потоковый разбор ответа upstream. Выход — в формате вывода CGI
+	// ("Status: ...", сквозные заголовки, пустая строка, тело без framing),
+	// чтобы Connection отдавал его тем же путём, что и CGI/FastCGI.
+	class ProxyResponseReader
+	{
+	public:
+		ProxyResponseReader() { reset(false); }
+
+		void reset(bool headRequest);
+		// false — протокол нарушен
+		bool feed(const char *data, size_t n, std::string &out);
+		// upstream закрыл соединение: для тела «до закрытия» это его конец
+		void eof();
+
+		bool done() const { return _st == DONE; }
+		bool started() const { return _started; }
+		// после done(): можно ли вернуть соединение в пул
+		bool keepAlive() const { return _keepAlive; }
+
+	private:
+		enum State
+		{
+			S_HEAD,
+			S_LENGTH,
+			S_CHUNK_SIZE,
+			S_CHUNK_DATA,
+			S_CHUNK_CRLF,
+			S_TRAILER,
+			S_CLOSE,
+			DONE,
+			FAILED
+		};
+
+		State _st;
+		bool _head;
+		bool _started;
+		bool _keepAlive;
+		std::string _buf;			// неразобранная строка/заголовки
+		unsigned long long _left;	// байт тела или текущего чанка
+
+		bool parseHead(const std::string &head, std::string &out);
+		// строка до '\n' (без CRLF), возможно из нескольких feed(); false — ещё не вся
+		bool takeLine(const char *data, size_t n, size_t &off, std::string &line);
+	};
+}
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef WEBSERV_HTTP_REGEXSET_HPP
+#define WEBSERV_HTTP_REGEXSET_HPP
+
+#include <string>
+#include <vector>
+
+namespace ws
+{
+
+	// Набор регулярных выражений (location ~ / ~*), скомпилированный в один DFA.
+	// Сопоставление — один линейный проход по пути без откатов; при нескольких
+	// совпадениях выигрывает выражение, добавленное первым (порядок в конфиге).
+	//
+	// Поддерживается: литералы, '.', [классы] и [^...], \d \w \s (+ заглавные),
+	// \-экранирование, (группы), '|', '*', '+', '?', {m}, {m,}, {m,n};
+	// '^' — только в начале выражения или его ветви верхнего уровня, '$' — только
+	// в конце (якорь действует на свою ветвь: "^/a|/b" — "/b" где угодно).
+	class RegexSet
+	{
+	public:
+		RegexSet();
+
+		// false + err при синтаксической ошибке
+		bool add(const std::string &pattern, bool icase, int value, std::string &err);
+		// строит DFA; false + err, если автомат вышел слишком большим
+		bool compile(std::string &err);
+
+		// value первого совпавшего выражения; -1 если ни одно не совпало
+		int match(const char *s, size_t n) const;
+		bool empty() const { return _count == 0; }
+
+	private:
+		// --- NFA (Томпсон) ---
+		struct CharSet
+		{
+			unsigned bits[8];
+			CharSet();
+			void set(unsigned char c) { bits[c >> 5] |= 1u << (c & 31); }
+			bool has(unsigned char c) const { return (bits[c >> 5] >> (c & 31)) & 1u; }
+		};
+		enum NKind
+		{
+			N_CHAR,	 // по байту из set -> out
+			N_SPLIT, // eps -> out, eps -> out2
+			N_EPS,	 // eps -> out
+			N_MATCH	 // принимающее для value
+		};
+		struct NState
+		{
+			NKind kind;
+			int set; // индекс в _sets (N_CHAR)
+			int out, out2;
+			int value; // N_MATCH: порядковый номер выражения
+		};
+		std::vector<NState> _nfa;
+		std::vector<CharSet> _sets;
+		std::vector<int> _starts;	// старт каждого выражения, не привязанного к '^'
+		std::vector<int> _anchored; // старт выражений с '^'
+		std::vector<int> _values;	// порядковый номер -> value
+		int _count;
+
+		// --- DFA ---
+		unsigned char _cls[256];	// байт -> класс эквивалентности
+		int _nclasses;
+		std::vector<int> _trans;	// [state * _nclasses + cls] -> state (-1: тупик)
+		std::vector<int> _accept;	// state -> порядковый номер (-1: не принимает)
+
+		struct Node; // AST разбора (только во время add)
+		friend struct RegexParse;
+		int emit(NKind k, int set, int out, int out2);
+		int build(const Node *n, int next);
+		void closure(std::vector<int> &set) const;
+	};
+
+} // namespace ws
+#endif
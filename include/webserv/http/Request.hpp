@@ -3,12 +3,14 @@
 
 #include <string>
 #include <map>
+#include "webserv/http/Method.hpp"
 
 namespace ws {
 
 struct HttpRequest {
     // request line
     std::string method;
+    Method      method_id;  // разобранный method, для сравнений в горячем пути
     std::string target;     // normalized/used by router
     std::string version;
 
@@ -19,6 +21,8 @@ struct HttpRequest {
     // raw target from the request line (pre-normalization)
     std::string raw_target;
 
+    HttpRequest() : method_id(M_UNKNOWN) {}
+
     // helpers
     bool headerEquals(const std::string &name, const std::string &value) const;
     bool hasHeader(const std::string &name) const;
@@ -0,0 +1,67 @@
+#ifndef WEBSERV_HTTP_ROUTETABLE_HPP
+#define WEBSERV_HTTP_ROUTETABLE_HPP
+
+#include <string>
+#include <vector>
+
+namespace ws
+{
+
+	// Radix-дерево префиксов: ключ -> int (индекс в таблице роутера).
+	// Поиск самого длинного префикса — один проход по входу, без аллокаций.
+	class PrefixTrie
+	{
+	public:
+		PrefixTrie();
+
+		// повторная вставка того же ключа не перезаписывает (первый выигрывает)
+		void insert(const std::string &key, int value);
+		// значение самого длинного ключа, который является префиксом s; -1 если нет
+		int longestPrefix(const char *s, size_t n) const;
+		bool empty() const { return _nodes.size() == 1 && _nodes[0].value < 0; }
+
+	private:
+		struct Node
+		{
+			std::string label;				// ребро от родителя
+			int value;						// -1: не конец ключа
+			std::vector<unsigned char> first; // первые байты рёбер детей (отсортированы)
+			std::vector<int> kids;
+			Node() : value(-1) {}
+		};
+		std::vector<Node> _nodes; // [0] — корень
+
+		int findChild(int node, unsigned char c) const;
+		void setChild(int node, unsigned char c, int child);
+		int newNode(const std::string &label, int value);
+	};
+
+	// Открытая адресация: строка -> int. Для имён хостов — без учёта регистра,
+	// для путей exact-location — с учётом (foldCase = false).
+	class NameHash
+	{
+	public:
+		explicit NameHash(bool foldCase = true);
+
+		void insert(const std::string &name, int value); // первый выигрывает
+		int find(const char *s, size_t n) const;		 // -1 если нет
+
+	private:
+		struct Slot
+		{
+			std::string key; // при _fold — в нижнем регистре
+			int value;		 // -1: пусто
+			unsigned hash;
+			Slot() : value(-1), hash(0) {}
+		};
+		std::vector<Slot> _slots; // размер — степень двойки
+		size_t _used;
+		bool _fold;
+
+		char fold(char c) const;
+		unsigned hashOf(const char *s, size_t n) const;
+		void grow();
+	};
+
+} // namespace ws
+#endif
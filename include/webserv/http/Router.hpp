@@ -2,7 +2,11 @@
 #define WEBSERV_HTTP_ROUTER_HPP
 
 #include "webserv/config/Config.hpp"
+#include "webserv/http/Method.hpp"
+#include "webserv/http/RouteTable.hpp"
+#include "webserv/http/RegexSet.hpp"
 #include <string>
+#include <vector>
 
 namespace ws
 {
@@ -13,9 +17,31 @@ namespace ws
 		const Location *location; // может быть NULL, если не найдено
 	};
 
+	// Скомпилированные таблицы одного слушателя (host:port)
+	struct ListenerRoutes
+	{
+		std::string host;
+		int port;
+		const ServerConfig *def; // первый server для пары (default_server)
+		NameHash exact;			 // server_name -> индекс сервера
+		PrefixTrie wildcard;	 // "*.example.com" (развёрнутый суффикс) -> индекс сервера
+		ListenerRoutes() : port(0), def(0) {}
+	};
+
+	// Скомпилированные location-ы одного сервера (nginx-порядок:
+	// "= /exact" -> "~ regex" по порядку в конфиге -> самый длинный префикс)
+	struct ServerRoutes
+	{
+		NameHash exact;	   // location = /path -> индекс location
+		RegexSet regex;	   // все location ~ / ~* сервера — один DFA
+		PrefixTrie prefix; // location /path -> индекс location
+		ServerRoutes() : exact(false) {}
+	};
+
 	class Router
 	{
 	public:
+		// таблицы строятся один раз здесь; дальше resolve() не зависит от числа vhost-ов
 		Router(const Config *cfg);
 
 		// listenerHost/Port — куда пришёл сокет (из Listener),
@@ -23,23 +49,32 @@ namespace ws
 		RouteMatch resolve(const std::string &listenerHost, int listenerPort,
 						   const std::string &hostHeader,
 						   const std::string &requestTarget) const;
+		// то же, но слушатель уже найден (Connection кэширует его при accept)
+		RouteMatch resolve(const ListenerRoutes *lr,
+						   const std::string &hostHeader,
+						   const std::string &requestTarget) const;
+
+		const ListenerRoutes *listenerRoutes(const std::string &host, int port) const;
+		const ServerConfig *defaultServer(const ListenerRoutes *lr) const;
 
 	private:
 		const Config *_cfg;
+		std::vector<ListenerRoutes> _listeners;
+		std::vector<ServerRoutes> _locations; // по индексу сервера
 
-		const ServerConfig *pickServer(const std::string &lhost, int lport,
+		const ServerConfig *pickServer(const ListenerRoutes *lr,
 									   const std::string &hostHeader) const;
 		const Location *pickLocation(const ServerConfig *srv,
-									 const std::string &path) const;
+									 const std::string &target) const;
+
+		Router(const Router &);
+		Router &operator=(const Router &);
 	};
-	inline bool methodAllowed(const Location *loc, const std::string &m)
+	inline bool methodAllowed(const Location *loc, Method m)
 	{
-		if (!loc || loc->allow_methods.empty())
+		if (!loc || !loc->allow_mask)
 			return true; // по умолчанию всё три
-		for (size_t i = 0; i < loc->allow_methods.size(); ++i)
-			if (loc->allow_methods[i] == m)
-				return true;
-		return false;
+		return (loc->allow_mask & m) != 0;
 	}
 
 } // namespace ws
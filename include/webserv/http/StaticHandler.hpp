@@ -19,10 +19,13 @@ namespace ws
 		size_t contentLength;
 		std::string location;       // для редиректа 3xx
 		std::string extraHeaders;   // "ETag", "Last-Modified", "Allow" и т.п.
+		std::string filePath;       // непусто: тело — contentLength байт этого файла с fileOffset
+		size_t fileOffset;
 
 		StaticResult()
 			: status(200),
-			  contentLength(0)
+			  contentLength(0),
+			  fileOffset(0)
 		{
 		}
 	};
@@ -35,6 +38,12 @@ namespace ws
 							  const HttpRequest &req,
 							  StaticResult &out);
 
+		// обычный файл: 304 по If-None-Match/If-Modified-Since, Range (206/416),
+		// иначе 200; тело не читается — только filePath/fileOffset/contentLength
+		static void serveFile(const std::string &fsPath,
+							  const HttpRequest &req,
+							  StaticResult &out);
+
 		// helpers
 		static std::string pathOnly(const std::string &target);
 		static bool isDir(const std::string &p);
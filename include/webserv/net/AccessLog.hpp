@@ -0,0 +1,99 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <pthread.h>
+
+namespace ws {
+
+struct HttpRequest;
+
+/**
+ * @brief What one access_log line is made of (all owned by the caller).
+ */
+struct AccessEntry {
+  const std::string* peer;   ///< client address
+  const HttpRequest* req;    ///< method/target/version may be empty (parse error)
+  int status;
+  unsigned long long bytes;  ///< sent for this response, headers included
+  unsigned long long totalUs;
+  unsigned long long ttfbUs;
+};
+
+/**
+ * @brief `access_log`: lines go into per-thread rings, a writer thread
+ *        batches them into the files; owned by the EventLoop.
+ *
+ * A thread formats the line on its stack (the timestamp is re-formatted
+ * once per second) and copies it into its own single-producer ring for
+ * that file: no locks, no syscalls. The writer drains every ring with one
+ * writev() per ring each `flush` interval, or sooner once a ring is half
+ * full. A line that does not fit is dropped and counted
+ * (Metrics::ACCESS_LOG_DROPS) — the loop never waits for the disk.
+ * SIGUSR1 makes the writer reopen all files (log rotation).
+ */
+class AccessLog {
+public:
+  enum Format { COMBINED, COMMON, TIMING };
+
+  static const size_t MAX_LINE = 4096;  // длиннее — обрезается
+
+  AccessLog();
+  ~AccessLog();  // дописывает всё накопленное
+
+  /** @brief "combined" | "common" | "timing". */
+  static bool formatFromName(const std::string& name, Format& f);
+
+  /**
+   * @brief Open `path` for appending (once per path) and return its id;
+   *        -1 and `err` on failure. The largest buffer and the shortest
+   *        flush of all users of the path win.
+   */
+  int open(const std::string& path, size_t buffer, size_t flushMs, std::string& err);
+  /** @brief Requests under latency slot `slot` are logged to `file`. */
+  void route(size_t slot, int file, Format f);
+  /** @brief Start the writer thread and the SIGUSR1 handler (if any file). */
+  bool start();
+
+  /** @brief Log a request served under `slot`; a no-op if it has no log. */
+  void log(size_t slot, const AccessEntry& e);
+
+private:
+  struct Ring;
+  struct File {
+    std::string path;
+    int fd;
+    size_t buffer;
+    size_t flushMs;
+    bool failing;               // ошибка записи уже в error log
+    std::vector<Ring*> rings;   // по одному на поток-писатель; под _mu
+  };
+  struct Target {
+    int file;                   // -1: не пишем
+    Format format;
+  };
+
+  static __thread std::vector<Ring*>* _rings;  // кольца потока по id файла; один AccessLog на процесс
+
+  std::vector<File*> _files;
+  std::vector<Target> _routes;  // по stats_slot
+  pthread_mutex_t _mu;          // только регистрация колец и их обход писателем
+  pthread_t _thread;
+  bool _running;
+  int _wakeRd, _wakeWr;
+  int _wake;                    // писатель уже разбужен (__atomic)
+  int _stop;
+
+  Ring* ring(int file);
+  void push(int file, const char* line, size_t n);
+  void wake();
+  static void* threadMain(void* self);
+  void work();
+  void drain(File* f);
+  void reopen();
+
+  AccessLog(const AccessLog&);
+  AccessLog& operator=(const AccessLog&);
+};
+
+} // namespace ws
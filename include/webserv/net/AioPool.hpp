@@ -0,0 +1,112 @@
+#pragma once
+#include <cstddef>
+#include <deque>
+#include <vector>
+#include <pthread.h>
+#include "webserv/net/IoWatcher.hpp"
+
+namespace ws {
+
+class EventLoop;
+class AioTask;
+
+/**
+ * @brief Gets a finished AioTask back on the loop thread.
+ */
+class AioClient {
+public:
+  virtual ~AioClient() {}
+  /** @brief t->run() has finished; the pool deletes t right after this call. */
+  virtual void onAioDone(AioTask* t) = 0;
+};
+
+/**
+ * @brief A blocking filesystem operation (stat/open/write/unlink) that
+ *        runs on a pool thread.
+ *
+ * run() executes on a worker and may touch only the task's own fields and
+ * the (immutable) config; the result is picked up in onAioDone() on the
+ * loop thread.
+ */
+class AioTask {
+public:
+  AioTask() : _client(0), _next(0) {}
+  virtual ~AioTask() {}
+  virtual void run() = 0;
+
+private:
+  friend class AioPool;
+  AioClient* _client;  // 0: клиент ушёл, результат выбрасываем (только поток цикла)
+  AioTask* _next;      // стек завершённых
+};
+
+/**
+ * @brief Pool counters (a snapshot, see AioPool::stats()).
+ */
+struct AioStats {
+  size_t threads;
+  unsigned long queued;        ///< waiting for a worker now
+  unsigned long running;       ///< on a worker now
+  unsigned long peakQueued;    ///< deepest the queue has been
+  unsigned long long completed;
+  unsigned long long inlined;  ///< queue was full: ran on the loop thread instead
+
+  AioStats() : threads(0), queued(0), running(0), peakQueued(0), completed(0), inlined(0) {}
+};
+
+/**
+ * @brief Bounded thread pool for `aio threads` locations; owned by the EventLoop.
+ *
+ * Jobs go to the workers through a mutex-protected queue of at most
+ * MAX_QUEUE entries. Finished jobs are pushed onto a lock-free stack, and
+ * the push that makes it non-empty wakes the loop through an eventfd (a
+ * pipe outside Linux). The loop then takes the whole stack at once, so
+ * workers never wait for it.
+ */
+class AioPool : public IoWatcher {
+public:
+  static const size_t MAX_QUEUE = 1024;
+
+  AioPool();
+  ~AioPool();
+
+  /** @brief Start the workers (once; later calls are no-ops). */
+  bool start(size_t threads, EventLoop* loop);
+  bool started() const { return !_threads.empty(); }
+
+  /**
+   * @brief Queue t; c->onAioDone(t) is called later on the loop thread.
+   * @return false if the pool is not running or the queue is full: the
+   *         caller keeps t and runs it itself.
+   */
+  bool submit(AioTask* t, AioClient* c);
+  /** @brief c went away: t's result is dropped when it finishes. */
+  void cancel(AioTask* t) { t->_client = 0; }
+
+  AioStats stats() const;
+
+  short ioEvents(int fd) const;
+  void onIo(int fd, short revents);
+
+private:
+  EventLoop* _loop;
+  std::vector<pthread_t> _threads;
+  mutable pthread_mutex_t _mu;
+  pthread_cond_t _cv;
+  std::deque<AioTask*> _jobs;  // под _mu
+  bool _stop;                  // под _mu
+  AioStats _st;                // под _mu (кроме inlined — только поток цикла)
+  AioTask* _done;              // стек завершённых: push — CAS воркеров, забирает цикл целиком
+  int _wakeRd;                 // eventfd (или пайп): «стек был пуст, теперь нет»
+  int _wakeWr;
+
+  static void* threadMain(void* self);
+  void work();
+  void post(AioTask* t);
+  AioTask* takeDone();
+
+  AioPool(const AioPool&);
+  AioPool& operator=(const AioPool&);
+};
+
+} // namespace ws
@@ -0,0 +1,83 @@
+#pragma once
+#include <string>
+
+namespace ws {
+
+/**
+ * @brief Owner of a running dynamic request (a Connection) gets progress
+ *        notifications.
+ */
+class CgiClient {
+public:
+  virtual ~CgiClient() {}
+  /**
+   * @brief New output or end of output.
+   *
+   * Called last inside the backend's I/O handler, so the client may delete
+   * the backend from here.
+   */
+  virtual void onCgiEvent() = 0;
+};
+
+/**
+ * @brief What a Connection needs from a dynamic-content backend: a local
+ *        CGI child (CgiProcess) or a request on a FastCGI connection
+ *        (FcgiRequest). Output in CGI format (headers, blank line, body)
+ *        is handled by the same code path for both.
+ */
+class CgiBackend {
+public:
+  virtual ~CgiBackend() {}
+
+  /** @brief Queue request-body bytes for the script's stdin. */
+  virtual void writeStdin(const char* data, size_t n) = 0;
+  void writeStdin(const std::string& data) { writeStdin(data.data(), data.size()); }
+  /** @brief End of request body (after everything queued so far). */
+  virtual void closeStdin() = 0;
+  /** @brief Bytes queued but not yet accepted downstream (backpressure). */
+  virtual size_t stdinBacklog() const = 0;
+
+  /** @brief Nothing beyond output() will arrive. */
+  virtual bool outputDone() const = 0;
+  /** @brief Output received so far and not yet consumed. */
+  virtual const std::string& output() const = 0;
+  /** @brief Drop n forwarded bytes from the front of output(). */
+  virtual void consumeOutput(size_t n) = 0;
+
+  /**
+   * @brief Time is up (cgi_timeout): stop the work. Output ends soon
+   *        after — possibly from inside this call (FastCGI), so the caller
+   *        must not touch the backend afterwards.
+   */
+  virtual void terminate() = 0;
+
+  /**
+   * @brief After outputDone(): the output was cut short (backend failed
+   *        mid-response), so the client must not see a complete reply.
+   */
+  virtual bool outputBroken() const { return false; }
+
+  /**
+   * @name Zero-copy passthrough (splice), only for backends with real pipes.
+   *
+   * After spliceStdin() the client moves the rest of the body from its
+   * socket straight into the returned fd; after spliceOutput() it moves
+   * output from the returned fd to the socket and the backend no longer
+   * reads it. Readiness is still polled by the backend and reported via
+   * CgiClient::onCgiEvent(). Default: unsupported (-1).
+   */
+  ///@{
+  virtual int spliceStdin() { return -1; }
+  virtual bool stdinReady() const { return false; }
+  virtual void stdinFull() {}          ///< pipe full: wait for POLLOUT again
+  virtual int spliceOutput() { return -1; }
+  virtual bool outputReady() const { return false; }
+  virtual void outputDrained() {}      ///< pipe read up: wait for POLLIN again
+  virtual void outputEof() {}          ///< readable but empty: script closed stdout
+  ///@}
+
+  /** Unconsumed output above which the backend stops reading its source. */
+  static const size_t OUT_HIGH = 65536;
+};
+
+} // namespace ws
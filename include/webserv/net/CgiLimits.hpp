@@ -0,0 +1,71 @@
+#pragma once
+#include <deque>
+#include <map>
+#include <sys/resource.h>
+#include "webserv/config/Config.hpp"
+
+namespace ws {
+
+/**
+ * @brief Counters of one dynamic location (CGI, cgi_pool, FastCGI).
+ */
+struct CgiStats {
+  unsigned long running;     ///< requests holding a slot now
+  unsigned long queued;      ///< waiting for a slot now
+  unsigned long rejected;    ///< 503: queue was full (or wait timed out)
+  unsigned long timeouts;    ///< cgi_timeout expired while running
+  unsigned long exited;      ///< reaped children
+  unsigned long long cpuUserUs;  ///< user CPU of reaped children (wait4)
+  unsigned long long cpuSysUs;   ///< system CPU of reaped children
+
+  CgiStats() : running(0), queued(0), rejected(0), timeouts(0), exited(0),
+               cpuUserUs(0), cpuSysUs(0) {}
+
+  /** @brief Add a reaped child's rusage. */
+  void addUsage(const struct rusage& ru);
+};
+
+/**
+ * @brief Waits in a location's queue for a free slot.
+ */
+class CgiWaiter {
+public:
+  virtual ~CgiWaiter() {}
+  /** @brief The slot is now ours (already counted as running). */
+  virtual void onCgiSlot() = 0;
+};
+
+/**
+ * @brief Per-location bulkhead: at most cgi_max_concurrency requests run,
+ *        up to cgi_queue more wait, the rest are rejected.
+ *
+ * Owned by the EventLoop. A released slot passes straight to the first
+ * waiter, so queued requests are served in arrival order.
+ */
+class CgiLimits {
+public:
+  enum Admit { RUN, QUEUED, FULL };
+
+  CgiLimits() {}
+
+  /** @brief RUN: slot taken; QUEUED: w->onCgiSlot() later; FULL: reject. */
+  Admit acquire(const Location* loc, CgiWaiter* w);
+  /** @brief Give the slot back (or to the next waiter). */
+  void release(const Location* loc);
+  /** @brief Leave the queue without ever getting a slot. */
+  void cancel(const Location* loc, CgiWaiter* w);
+
+  CgiStats& stats(const Location* loc) { return _slots[loc].st; }
+
+private:
+  struct Slot {
+    CgiStats st;
+    std::deque<CgiWaiter*> waiting;
+  };
+  std::map<const Location*, Slot> _slots;
+
+  CgiLimits(const CgiLimits&);
+  CgiLimits& operator=(const CgiLimits&);
+};
+
+} // namespace ws
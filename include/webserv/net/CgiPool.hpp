@@ -0,0 +1,140 @@
+#pragma once
+#include <map>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include "webserv/config/Config.hpp"
+#include "webserv/http/Cgi.hpp"
+#include "webserv/net/CgiBackend.hpp"
+#include "webserv/net/IoWatcher.hpp"
+#include "webserv/net/ChildReaper.hpp"
+#include "webserv/net/CgiLimits.hpp"
+#include "webserv/net/Timer.hpp"
+
+namespace ws {
+
+class EventLoop;
+class CgiWorker;
+
+/**
+ * @brief One request handed to a warm cgi_pool worker.
+ *
+ * Owned by the Connection, like CgiProcess. Body bytes become stdin frames
+ * on the worker's pipe; deleting an unfinished request leaves the worker
+ * to drain the rest of the response and return to the pool.
+ */
+class CgiPoolRequest : public CgiBackend {
+public:
+  ~CgiPoolRequest();
+
+  void writeStdin(const char* data, size_t n);
+  using CgiBackend::writeStdin;
+  void closeStdin();
+  size_t stdinBacklog() const;
+
+  bool outputDone() const { return _done; }
+  const std::string& output() const { return _out; }
+  void consumeOutput(size_t n) { _out.erase(0, n); }
+  /** @brief Stops the whole worker (it is respawned for the next request). */
+  void terminate();
+
+private:
+  friend class CgiWorker;
+  friend class CgiPool;
+
+  explicit CgiPoolRequest(CgiClient* client);
+
+  CgiClient* _client;
+  CgiWorker* _worker;  // 0 после конца ответа
+  std::string _out;
+  bool _done;
+
+  void finish();       // конец ответа (кадр нулевой длины или смерть воркера)
+
+  CgiPoolRequest(const CgiPoolRequest&);
+  CgiPoolRequest& operator=(const CgiPoolRequest&);
+};
+
+/**
+ * @brief Long-lived `cgi_bin cgi_pool_worker` process serving requests one
+ *        at a time.
+ *
+ * Framing on both pipes is "<decimal length>\n<bytes>"; a zero-length
+ * frame ends a stream. Per request the server writes the CGI environment
+ * block ("K=V\0..."), then stdin frames, then an empty frame; the worker
+ * answers with output frames (CGI format) and an empty frame. Closing the
+ * worker's stdin asks it to exit.
+ */
+class CgiWorker : public IoWatcher, public ChildListener, public TimerListener {
+public:
+  CgiWorker(EventLoop* loop, const Location* loc, CgiStats* stats);
+  /** Closes the pipes; a live worker is killed (SIGKILL). */
+  ~CgiWorker();
+
+  /** @brief Spawn (or respawn) the process; false if spawn failed. */
+  bool start();
+  bool idle() const { return _inFd >= 0 && !_busy; }
+  bool dead() const { return _inFd < 0 && _outFd < 0; }
+
+  /** @brief Give the idle worker a request; env is its first frame. */
+  void assign(CgiPoolRequest* r, const std::string& env);
+  void sendFrame(const char* data, size_t n);
+  void endStdin();
+  /** @brief Owner of r went away: finish its stdin, discard the rest of the reply. */
+  void abandon(CgiPoolRequest* r);
+  size_t stdinBacklog() const { return _inBuf.size() - _inOff; }
+  /** @brief Request timed out: SIGTERM, then SIGKILL like CgiProcess. */
+  void terminate();
+
+  short ioEvents(int fd) const;
+  void onIo(int fd, short revents);
+  void onChildExit(pid_t pid, int status, const struct rusage& ru);
+  void onTimer();
+
+private:
+  EventLoop* _loop;
+  const Location* _loc;
+  CgiStats* _stats;
+  pid_t _pid;
+  int _inFd, _outFd;
+  std::string _inBuf;
+  size_t _inOff;
+  std::string _rd;        // неразобранный вывод
+  size_t _frameLeft;      // байт текущего кадра ещё впереди (0 — ждём заголовок)
+  CgiPoolRequest* _req;   // 0: свободен или ответ выбрасывается
+  bool _busy;
+  bool _reqStdinDone;
+  size_t _served;
+
+  void endOfResponse();
+  void die();
+  void closeFds();
+
+  CgiWorker(const CgiWorker&);
+  CgiWorker& operator=(const CgiWorker&);
+};
+
+/**
+ * @brief Warm workers of every cgi_pool location; owned by the EventLoop.
+ */
+class CgiPool {
+public:
+  CgiPool() {}
+  ~CgiPool();
+
+  /** @brief Pre-spawn loc->cgi_pool workers (failures are logged, not fatal). */
+  void add(const Location* loc, EventLoop* loop, CgiStats* stats);
+  /**
+   * @brief Hand the request to an idle worker of loc.
+   * @return 0 when every worker is busy — caller falls back to one-shot exec.
+   */
+  CgiPoolRequest* open(const Location* loc, const std::string& env, CgiClient* client);
+
+private:
+  std::map<const Location*, std::vector<CgiWorker*> > _workers;
+
+  CgiPool(const CgiPool&);
+  CgiPool& operator=(const CgiPool&);
+};
+
+} // namespace ws
@@ -0,0 +1,93 @@
+#pragma once
+#include <string>
+#include <sys/types.h>
+#include "webserv/http/Cgi.hpp"
+#include "webserv/net/IoWatcher.hpp"
+#include "webserv/net/CgiBackend.hpp"
+#include "webserv/net/ChildReaper.hpp"
+#include "webserv/net/CgiLimits.hpp"
+#include "webserv/net/Timer.hpp"
+
+namespace ws {
+
+class EventLoop;
+
+/**
+ * @brief One CGI child with non-blocking stdin/stdout pipes driven by the
+ *        EventLoop.
+ *
+ * The request body is queued with writeStdin() as it arrives from the
+ * socket and flushed when the pipe is writable. stdout is read only while
+ * less than OUT_HIGH bytes wait to be consumed, so a slow client stalls
+ * the script instead of growing memory. Exit status arrives via
+ * ChildReaper (SIGCHLD), never via a blocking waitpid(); its CPU time
+ * (wait4 rusage) is added to the location's CgiStats.
+ */
+class CgiProcess : public CgiBackend, public IoWatcher, public ChildListener, public TimerListener {
+public:
+  CgiProcess(EventLoop* loop, CgiClient* client, CgiStats* stats = 0);
+  /** Unregisters the pipes; an unfinished child is killed (SIGKILL). */
+  ~CgiProcess();
+
+  /**
+   * @brief Spawn the script (CgiHandler::spawn), register pipes and pid with the loop.
+   * @return false if pipes/spawn failed (nothing left registered).
+   */
+  bool start(const CgiLaunch& launch);
+
+  void writeStdin(const char* data, size_t n);
+  using CgiBackend::writeStdin;
+  /** @brief Close stdin once everything queued so far is written. */
+  void closeStdin();
+  size_t stdinBacklog() const { return _inBuf.size() - _inOff; }
+
+  /** @brief EOF on stdout. */
+  bool outputDone() const { return _outFd < 0; }
+  const std::string& output() const { return _out; }
+  void consumeOutput(size_t n) { _out.erase(0, n); }
+
+  int spliceStdin();
+  bool stdinReady() const { return _inSplice && _inReady && _inFd >= 0; }
+  void stdinFull() { _inReady = false; }
+  int spliceOutput();
+  bool outputReady() const { return _outSplice && _outReady; }
+  void outputDrained() { _outReady = false; }
+  void outputEof() { closeOut(); }
+
+  /** @brief SIGTERM now, SIGKILL if still alive after KILL_GRACE_MS. */
+  void terminate();
+
+  bool exited() const { return _exited; }
+  int exitStatus() const { return _status; }
+
+  short ioEvents(int fd) const;
+  void onIo(int fd, short revents);
+  void onChildExit(pid_t pid, int status, const struct rusage& ru);
+  void onTimer();
+
+  static const long long KILL_GRACE_MS = 3000;
+
+private:
+  EventLoop* _loop;
+  CgiClient* _client;
+  CgiStats* _stats;    // не владеем; 0 — без учёта
+  pid_t _pid;
+  int _inFd, _outFd;
+  std::string _inBuf;  // очередь для stdin
+  size_t _inOff;       // сколько из _inBuf уже записано
+  bool _inEof;         // после сброса очереди закрыть stdin
+  bool _inSplice, _inReady;    // тело пишет клиент (splice); пайп готов к записи
+  bool _outSplice, _outReady;  // вывод забирает клиент (splice); в пайпе есть данные
+  std::string _out;
+  bool _exited;
+  int _status;
+
+  void flushStdin();
+  void closeIn();
+  void closeOut();
+
+  CgiProcess(const CgiProcess&);
+  CgiProcess& operator=(const CgiProcess&);
+};
+
+} // namespace ws
@@ -0,0 +1,62 @@
+#pragma once
+#include <map>
+#include <sys/types.h>
+#include <sys/resource.h>
+#include "webserv/net/IoWatcher.hpp"
+
+namespace ws {
+
+/**
+ * @brief Receives the exit status of a child started by the server.
+ */
+class ChildListener {
+public:
+  virtual ~ChildListener() {}
+  /**
+   * @param pid    reaped child.
+   * @param status raw status as returned by wait4().
+   * @param ru     the child's resource usage (CPU time, max RSS).
+   */
+  virtual void onChildExit(pid_t pid, int status, const struct rusage& ru) = 0;
+};
+
+/**
+ * @brief SIGCHLD -> self-pipe -> wait4(WNOHANG) inside the event loop.
+ *
+ * The signal handler only writes a byte into a non-blocking pipe; the
+ * actual reaping happens when the loop polls the read end, so listeners
+ * run in normal (non-signal) context. Children nobody listens for
+ * (e.g. CGI of a dropped client) are still reaped — no zombies.
+ */
+class ChildReaper : public IoWatcher {
+public:
+  ChildReaper();
+  ~ChildReaper();
+
+  /**
+   * @brief Create the self-pipe and install the SIGCHLD handler.
+   * @return false on failure.
+   */
+  bool open();
+
+  int fd() const { return _rd; }
+
+  /** @brief Deliver pid's exit status to l (once). */
+  void watch(pid_t pid, ChildListener* l) { _listeners[pid] = l; }
+  /** @brief Stop delivering for pid (listener is going away). */
+  void forget(pid_t pid) { _listeners.erase(pid); }
+
+  short ioEvents(int fd) const;
+  void onIo(int fd, short revents);
+
+private:
+  int _rd;
+  std::map<pid_t, ChildListener*> _listeners;
+
+  void reap();
+
+  ChildReaper(const ChildReaper&);
+  ChildReaper& operator=(const ChildReaper&);
+};
+
+} // namespace ws
@@ -1,12 +1,29 @@
 #ifndef WEBSERV_NET_CONNECTION_HPP
 #define WEBSERV_NET_CONNECTION_HPP
 #include <string>
+#include <sys/types.h>
 #include "webserv/http/Parser.hpp"
 #include "webserv/http/Request.hpp"
 #include "webserv/http/Router.hpp"
+#include "webserv/net/ErrorPages.hpp"
+#include "webserv/net/CgiBackend.hpp"
+#include "webserv/net/CgiLimits.hpp"
+#include "webserv/net/Timer.hpp"
+#include "webserv/net/ResponseCache.hpp"
+#include "webserv/net/AioPool.hpp"
+#include "webserv/net/GroupCommit.hpp"
+#include "webserv/utils/Metrics.hpp"
 namespace ws
 {
-	class Connection
+	class EventLoop;
+	struct StaticResult;
+	struct CgiResult;
+	struct FsTask;
+	class MultipartUpload;
+	struct UploadSession;
+
+	class Connection : public CgiClient, public CgiWaiter, public TimerListener, public CacheWaiter, public AioClient,
+					   public DurableClient
 	{
 	public:
 		enum State
@@ -14,32 +31,57 @@ namespace ws
 			READ,
 			PROCESS,
 			WRITE,
+			CGI, // ждём слот/скрипт (и, возможно, льём ему тело запроса)
+			UPLOAD, // тело multipart пишется в файлы upload_store по мере прихода
+			// PROCESS также: ждём, пока другое соединение получит тот же ответ (кэш),
+			// или операцию ФС в пуле aio threads, или fsync загрузки (upload_durability)
 			CLOSED
 		};
-		Connection(int fd) : _fd(fd), _state(READ), _curKeepAlive(false), _reqsOnConn(0) {}
+		Connection(int fd) : _fd(fd), _state(READ), _router(0), _routes(0), _defSrv(0), _errorPages(0), _lport(0),
+							 _curKeepAlive(false), _reqsOnConn(0), _loop(0), _cgi(0), _cgiSrv(0), _cgiLoc(0), _cgiBody(false), _cgiHeaders(false),
+							 _cgiStreaming(false), _cgiSlot(false), _cgiQueued(false), _cgiTimedOut(false), _cgiDeadline(0),
+							 _spliceInFd(-1), _spliceOutFd(-1), _spliceLeft(0),
+							 _fileFd(-1), _fileOff(0), _fileLeft(0),
+							 _cacheLeader(false), _cacheWait(false), _cacheTtl(0), _aio(0),
+							 _upload(0), _uploadSrv(0), _uploadLoc(0), _uploadLeft(0), _patch(0), _patchFd(-1), _patchSaved(0), _interim(0), _durable(0), _status(0), _idle(true),
+							 _reqStartUs(0), _ttfbUs(0), _latSrv(0), _latLoc(0), _sentBytes(0)
+		{
+			_out.reserve(OUT_RESERVE);
+			Metrics::gauge(Metrics::CONN_ACTIVE, 1);
+			Metrics::gauge(Metrics::CONN_IDLE, 1);
+		}
 		~Connection();
 		int fd() const { return _fd; }
 		short wantEvents() const;
 		void onReadable();
 		void onWritable();
+		void onHangup(); // POLLERR/POLLHUP: ответ уже не доставить
 		bool isClosed() const { return _state == CLOSED; }
-		void setRouter(const Router *r) { _router = r; }
+		void setRouter(const Router *r)
+		{
+			_router = r;
+			bindRoutes();
+		}
+		void setLoop(EventLoop *l) { _loop = l; }
+		void setPeer(const std::string &addr) { _peer = addr; }
+		void setErrorPages(const ErrorPages *p) { _errorPages = p; }
 		void setLocalBind(const std::string &host, int port)
 		{
 			_lhost = host;
 			_lport = port;
+			bindRoutes();
 		}
 
 	private:
 		bool handlePostUpload(const RouteMatch &m);
-		void makeChunkedResponse(int code, const std::string &reason,
-								 const std::string &ctype,
-								 const std::string &body,
-								 const std::string &extra = "");
 		int _fd;
 		State _state;
 		std::string _in, _out;
 		const Router *_router;
+		const ListenerRoutes *_routes; // таблица нашего слушателя (ищется один раз)
+		const ServerConfig *_defSrv;   // default_server слушателя
+		const ErrorPages *_errorPages; // кэш ответов об ошибках (владеет EventLoop)
+		void bindRoutes();
 
 		std::string _lhost;
 		int _lport; // ← сюда EventLoop проставит host:port слушателя
@@ -48,9 +90,107 @@ namespace ws
 		bool _curKeepAlive; // текущий ответ: держим соединение?
 		int _reqsOnConn;	// сколько запросов обработали в этом TCP
 		static const int MAX_KEEPALIVE = 100;
+		static const size_t OUT_RESERVE = 4096; // заголовки + небольшое тело без перераспределений
+
+		EventLoop *_loop;			   // для регистрации пайпов CGI
+		CgiBackend *_cgi;			   // владеем; != 0 в состоянии CGI
+		const ServerConfig *_cgiSrv;   // для error_page ответов CGI
+		const Location *_cgiLoc;	   // чей слот (cgi_max_concurrency) держим/ждём
+		bool _cgiBody;				   // тело запроса ещё течёт в stdin скрипта
+		bool _cgiHeaders;			   // заголовки ответа CGI уже в _out, дальше — чанки
+		bool _cgiStreaming;			   // тело читается после запуска (HEADERS)
+		bool _cgiSlot;				   // держим слот location
+		bool _cgiQueued;			   // ждём слот в очереди location
+		bool _cgiTimedOut;			   // cgi_timeout истёк, скрипт останавливается
+		long long _cgiDeadline;		   // monotonicMs конца cgi_timeout для ждавших в очереди (0 — нет)
+		int _spliceInFd;			   // >= 0: тело идёт из сокета в stdin скрипта через splice
+		int _spliceOutFd;			   // >= 0: вывод скрипта идёт в сокет через splice
+		size_t _spliceLeft;			   // байт текущего чанка ещё в пайпе
+		int _fileFd;				   // тело ответа — файл (sendfile), -1 если нет
+		off_t _fileOff;
+		size_t _fileLeft;
+		std::string _cacheKey;		   // ключ микрокэша текущего запроса
+		bool _cacheLeader;			   // мы производим ответ для _cacheKey, другие ждут
+		bool _cacheWait;			   // ждём чужой ответ на _cacheKey
+		long long _cacheTtl;		   // > 0: копим ответ CGI в _cacheFill
+		CachedResponse _cacheFill;
+		AioTask *_aio;				   // наша задача в пуле aio (владеет пул), 0 — нет
+		MultipartUpload *_upload;	   // владеем; != 0 в состоянии UPLOAD
+		const ServerConfig *_uploadSrv;
+		const Location *_uploadLoc;	   // multipart/PATCH: чей upload_durability
+		size_t _uploadLeft;			   // сколько ещё тела разрешает client_max_body_size
+		UploadSession *_patch;		   // != 0: PATCH пишет в эту сессию (состояние UPLOAD)
+		int _patchFd;
+		std::string _patchDir, _patchId;
+		unsigned long long _patchSaved; // offset на момент последней записи индекса
+		size_t _interim;			   // начало _out — ещё не досланный 100 Continue
+		DurableWait *_durable;		   // ответ о загрузке готов в _out, ждёт fsync (владеет GroupCommit)
+		int _status;				   // код текущего ответа (метрики по классам)
+		bool _idle;					   // ждём следующий запрос (метрика CONN_IDLE)
+		long long _reqStartUs;		   // monotonicUs первого байта запроса (0 — запроса нет)
+		long long _ttfbUs;			   // первого байта ответа (0 — ещё не ушёл)
+		const ServerConfig *_latSrv;   // чьи гистограммы задержек (0 — сервер по умолчанию)
+		const Location *_latLoc;
+		std::string _peer;			   // адрес клиента (access_log, X-Forwarded-For)
+		unsigned long long _sentBytes; // ушло в ответ на текущий запрос
+		static const size_t CGI_STDIN_BACKLOG = 65536;	// выше — не читаем сокет
+		static const size_t CGI_SOCKET_BACKLOG = 65536; // выше — не берём вывод скрипта
+
+		void onCgiEvent();
+		void onCgiSlot();
+		void onTimer();
+		void onCacheReady();
+		void onAioDone(AioTask *t);
+		void onDurable(bool ok);
+		void processInput();
+		bool admitBody(const RouteMatch &m);
+		void setIdle(bool idle);
+		void noteRoute(const RouteMatch &m);
+		void requestDone();
+		void sendStatus();
+		void handleRequest();
+		bool isCgiRoute(const RouteMatch &m) const;
+		void startCgi(const RouteMatch &m, bool streaming);
+		void admitCgi(bool cacheLock);
+		void launchCgi();
+		ResponseCache::Lookup cacheLookup(const Location *loc, bool lock);
+		void serveCached(const CachedResponse &c);
+		void cacheRelease();
+		void pumpCgiBody();
+		void forwardCgiOutput();
+		void spliceCgiBody();
+		void spliceCgiOutput();
+		void finishCgiResponse();
+		void dropCgi();
+		void serveAccel(const CgiResult &cgi);
+		bool flushOut();
+		void offload(FsTask *t);
+		void staticDone(const StaticResult &res, const RouteMatch &m, int fd);
+		void sendUploaded(const std::string &locationHdr);
+		void awaitDurable(const Location *loc, const std::vector<std::string> &files, const std::string &dir);
+		bool isUploadStream(const RouteMatch &m, std::string &boundary) const;
+		void startUpload(const RouteMatch &m, const std::string &boundary);
+		void pumpUpload();
+		void failUpload(int code);
+		void dropUpload();
+		bool sessionTarget(const RouteMatch &m, std::string &id) const;
+		int patchCheck(const UploadSession *u) const;
+		bool handleResumable(const RouteMatch &m);
+		bool isPatchStream(const RouteMatch &m, std::string &id) const;
+		void startPatch(const RouteMatch &m, const std::string &id);
+		void pumpPatch();
+		void sendPatched(const Location *loc, const std::string &dir, const std::string &id, UploadSession *u);
+		void failPatch(int code);
+		void endPatch();
+		bool sendDeleted(int code, const ServerConfig *srv);
+		void sendEcho();
+		void sendStatic(const StaticResult &res, const ServerConfig *srv, int fd = -1);
+		bool sendFileBody();
+		void closeFile();
 
 		bool shouldKeepAlive(const HttpRequest &r) const;
-		void makeErrorWithPages(int code, const ServerConfig *srv);
+		void makeErrorWithPages(int code, const ServerConfig *srv, const char *extra = 0);
+		void makeMethodNotAllowed(const Location *loc);
 		void makeResponse(int code, const std::string &reason,
 						  const std::string &ctype,
 						  const std::string &body,
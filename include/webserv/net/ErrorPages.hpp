@@ -0,0 +1,72 @@
+#pragma once
+#include <map>
+#include <string>
+#include "webserv/config/Config.hpp"
+#include "webserv/net/ResponseBuilder.hpp"
+
+namespace ws {
+
+/**
+ * @brief Error response prepared at config load: body + header templates.
+ *
+ * Immutable after ErrorPages::load; emitting it touches neither the
+ * filesystem nor the allocator (given enough capacity in the output buffer).
+ */
+struct CannedResponse {
+  int code;
+  std::string body;
+  HeaderTemplate full;  ///< Content-Length = body size
+  HeaderTemplate head;  ///< Content-Length: 0 (ответ на HEAD)
+};
+
+/**
+ * @brief Reason phrase for the status codes the server emits.
+ * @return e.g. "Not Found"; "Error" for unknown codes.
+ */
+const char* reasonPhrase(int code);
+
+/**
+ * @brief Cache of error responses for every server of the config.
+ *
+ * Built-in plain-text bodies for 400/403/404/405/411/413/500/501/502/503/504 plus
+ * every configured error_page file, read once at load. An error_page file
+ * that cannot be read falls back to the built-in body (как и раньше при
+ * чтении на каждый запрос).
+ */
+class ErrorPages {
+public:
+  ErrorPages() {}
+
+  /**
+   * @brief (Re)build the cache from config.
+   * @param cfg parsed config; ServerConfig addresses must stay valid.
+   */
+  void load(const Config& cfg);
+
+  /**
+   * @brief Find the response for code on server srv.
+   * @param srv server (nullable: only built-ins).
+   * @param code HTTP status code.
+   * @return canned response or 0 if the code is not cached.
+   */
+  const CannedResponse* find(const ServerConfig* srv, int code) const;
+
+  /**
+   * @brief Append a complete canned response (headers + body) to out.
+   * @param isHead omit body and send Content-Length: 0.
+   * @param extra  additional header lines ("Name: value\r\n"), may be 0.
+   */
+  static void append(std::string& out, const CannedResponse& r,
+                     bool keepAlive, bool isHead, const char* extra = 0);
+
+private:
+  typedef std::map<int, CannedResponse> ByCode;
+
+  ByCode _builtin;
+  std::map<const ServerConfig*, ByCode> _perServer;  // только переопределённые коды
+
+  ErrorPages(const ErrorPages&);
+  ErrorPages& operator=(const ErrorPages&);
+};
+
+} // namespace ws
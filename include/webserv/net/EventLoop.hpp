@@ -10,6 +10,19 @@
 #include "webserv/net/Listener.hpp"
 #include "webserv/config/Config.hpp"
 #include "webserv/http/Router.hpp"
+#include "webserv/net/ErrorPages.hpp"
+#include "webserv/net/IoWatcher.hpp"
+#include "webserv/net/Timer.hpp"
+#include "webserv/net/ChildReaper.hpp"
+#include "webserv/net/FcgiPool.hpp"
+#include "webserv/net/CgiPool.hpp"
+#include "webserv/net/ProxyPool.hpp"
+#include "webserv/net/CgiLimits.hpp"
+#include "webserv/net/ResponseCache.hpp"
+#include "webserv/net/AioPool.hpp"
+#include "webserv/net/ResumableUpload.hpp"
+#include "webserv/net/GroupCommit.hpp"
+#include "webserv/net/AccessLog.hpp"
 
 namespace ws {
 
@@ -23,20 +36,62 @@ public:
     bool initFromConfig(const Config& cfg);
     int  run();
 
+    // доп. fd (пайпы CGI и т.п.): опрашиваются наравне с сокетами
+    void watch(int fd, IoWatcher* w);
+    void unwatch(int fd);
+    ChildReaper& reaper() { return _reaper; }
+
+    // таймауты: один срок на слушателя, повторный вызов переносит его
+    void setTimer(TimerListener* l, long long delayMs);
+    void cancelTimer(TimerListener* l);
+    FcgiPool& fastcgi() { return _fcgi; }
+    ProxyPool& proxy() { return _proxy; }
+    CgiPool& cgiPool() { return _cgiPool; }
+    CgiLimits& cgiLimits() { return _cgiLimits; }
+    ResponseCache& cache() { return _cache; }
+    AioPool& aio() { return _aio; }
+    ResumableUploads& uploads() { return _uploads; }
+    GroupCommit& commits() { return _commits; }
+    AccessLog& accessLog() { return _accessLog; }
+    const Config* config() const { return _cfgRef; }
+
 private:
     Poller _poller;
     std::vector<Listener*> _listeners;
     std::map<int, Connection*> _conns;
+    struct Watch {
+        IoWatcher* w;                    // не владеем
+        unsigned long seq;               // номер регистрации (watch())
+    };
+    std::map<int, Watch> _watchers;
+    unsigned long _watchSeq;             // последний выданный номер регистрации
+    unsigned long _pollSeq;              // _watchSeq на момент сборки набора poll
+    typedef std::multimap<long long, TimerListener*> TimerQueue;
+    TimerQueue _timers;                                  // срок (monotonicMs) -> слушатель
+    std::map<TimerListener*, TimerQueue::iterator> _timerOf;
+    ChildReaper _reaper;                 // SIGCHLD -> wait4(WNOHANG)
+    FcgiPool _fcgi;                      // fastcgi_pass; после _watchers: снимается с них в деструкторе
+    ProxyPool _proxy;                    // proxy_pass: keep-alive соединения к backend'ам
+    CgiLimits _cgiLimits;                // cgi_max_concurrency/cgi_queue + счётчики location
+    CgiPool _cgiPool;                    // cgi_pool: тёплые воркеры cgi_bin
+    ResponseCache _cache;                // cache_valid: микрокэш ответов CGI/autoindex
+    AioPool _aio;                        // aio threads: блокирующие операции ФС вне цикла
+    ResumableUploads _uploads;           // сессии возобновляемых загрузок (tus) по upload_store
+    GroupCommit _commits;                // upload_durability group: общий fsync загрузок; после _aio
+    AccessLog _accessLog;                // access_log: кольца потоков + поток записи в файлы
 
     // fd слушателя -> (host,port)
     std::map<int, std::pair<std::string,int> > _listenerBind;
 
     Router* _router;           // владеем
+    ErrorPages _errorPages;    // error_page + встроенные ответы, готовые при загрузке
     const Config* _cfgRef;     // не владеем
 
     void rebuildPollSet();
     void acceptReady(int lfd);
     void gcClosed();
+    int  pollTimeout() const;
+    void runTimers();
 };
 
 } // namespace ws
@@ -0,0 +1,166 @@
+#pragma once
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+#include <sys/socket.h>
+#include "webserv/http/FastCgi.hpp"
+#include "webserv/net/CgiBackend.hpp"
+#include "webserv/net/IoWatcher.hpp"
+
+namespace ws {
+
+class EventLoop;
+class FcgiConn;
+class FcgiUpstream;
+
+/**
+ * @brief One HTTP request forwarded to a FastCGI application server.
+ *
+ * Owned by the Connection (like CgiProcess). Until a pooled connection has
+ * a free slot the request waits in its upstream's queue with params and
+ * body buffered locally; once attached, stdin goes straight into
+ * FCGI_STDIN records. Deleting an in-flight request sends
+ * FCGI_ABORT_REQUEST and keeps the id reserved until FCGI_END_REQUEST.
+ */
+class FcgiRequest : public CgiBackend {
+public:
+  ~FcgiRequest();
+
+  void writeStdin(const char* data, size_t n);
+  using CgiBackend::writeStdin;
+  void closeStdin();
+  size_t stdinBacklog() const;
+
+  bool outputDone() const { return _done; }
+  const std::string& output() const { return _out; }
+  void consumeOutput(size_t n) { _out.erase(0, n); }
+  /** @brief FCGI_ABORT_REQUEST and end the output right away. */
+  void terminate();
+
+private:
+  friend class FcgiConn;
+  friend class FcgiUpstream;
+
+  FcgiRequest(FcgiUpstream* up, CgiClient* client, const std::string& env);
+
+  FcgiUpstream* _up;
+  CgiClient* _client;
+  FcgiConn* _conn;       // 0: ждёт в очереди или уже завершён
+  unsigned _id;
+  std::string _params;   // закодированные пары (до привязки)
+  std::string _stdin;    // тело до привязки
+  bool _stdinClosed;
+  std::string _out;      // FCGI_STDOUT
+  bool _done;
+
+  void finish();         // конец вывода (END_REQUEST или обрыв)
+
+  FcgiRequest(const FcgiRequest&);
+  FcgiRequest& operator=(const FcgiRequest&);
+};
+
+/**
+ * @brief Persistent connection to an application server (FCGI_KEEP_CONN).
+ *
+ * Carries one request at a time unless the server answers FCGI_GET_VALUES
+ * with FCGI_MPXS_CONNS=1, then up to FCGI_MAX_REQS (capped) multiplexed
+ * requests. Survives being closed by the peer: the next attach reconnects.
+ */
+class FcgiConn : public IoWatcher {
+public:
+  FcgiConn(FcgiUpstream* up, EventLoop* loop);
+  ~FcgiConn();
+
+  bool hasSlot() const;
+  /** @brief Assign an id, connect if needed, queue BEGIN/PARAMS/STDIN. */
+  bool attach(FcgiRequest* r);
+  /** @brief Owner dropped r: abort on the wire, keep the id until END_REQUEST. */
+  void abort(FcgiRequest* r);
+  void queue(int type, unsigned id, const char* data, size_t n);
+  size_t pendingOut() const { return _out.size() - _outOff; }
+
+  short ioEvents(int fd) const;
+  void onIo(int fd, short revents);
+
+private:
+  enum State { CLOSED, CONNECTING, READY };
+
+  FcgiUpstream* _up;
+  EventLoop* _loop;
+  int _fd;
+  State _state;
+  std::string _out;
+  size_t _outOff;
+  FcgiReader _rd;
+  std::map<unsigned, FcgiRequest*> _reqs; // id -> запрос (0: брошен владельцем)
+  size_t _maxReqs;
+
+  bool connect();
+  void fail();
+  void onRecord(const FcgiRecord& rec);
+
+  FcgiConn(const FcgiConn&);
+  FcgiConn& operator=(const FcgiConn&);
+};
+
+/**
+ * @brief All connections to one fastcgi_pass address + queue of requests
+ *        waiting for a free slot.
+ */
+class FcgiUpstream {
+public:
+  FcgiUpstream(const FcgiAddress& addr, EventLoop* loop);
+  ~FcgiUpstream();
+
+  /** @brief Resolve the address once (host name lookup for TCP). */
+  bool resolve(std::string& err);
+
+  FcgiRequest* open(const std::string& env, CgiClient* client);
+  /** @brief Attach queued requests to free slots (after a slot frees up). */
+  void dispatch();
+  void cancel(FcgiRequest* r);
+
+  const struct sockaddr* sockAddr() const { return reinterpret_cast<const struct sockaddr*>(&_sa); }
+  socklen_t sockLen() const { return _saLen; }
+  int family() const { return _addr.isUnix ? AF_UNIX : AF_INET; }
+
+  static const size_t MAX_CONNS = 16;
+
+private:
+  FcgiAddress _addr;
+  EventLoop* _loop;
+  struct sockaddr_storage _sa;
+  socklen_t _saLen;
+  std::vector<FcgiConn*> _conns;
+  std::deque<FcgiRequest*> _waiting;
+
+  FcgiUpstream(const FcgiUpstream&);
+  FcgiUpstream& operator=(const FcgiUpstream&);
+};
+
+/**
+ * @brief fastcgi_pass address -> upstream; owned by the EventLoop.
+ */
+class FcgiPool {
+public:
+  FcgiPool() {}
+  ~FcgiPool();
+
+  /** @brief Register (and resolve) an address from the config. */
+  bool add(const std::string& spec, EventLoop* loop, std::string& err);
+  /**
+   * @brief Start a request on spec's upstream.
+   * @param env CGI environment block (becomes FCGI_PARAMS).
+   * @return 0 if spec was never registered.
+   */
+  FcgiRequest* open(const std::string& spec, const std::string& env, CgiClient* client);
+
+private:
+  std::map<std::string, FcgiUpstream*> _ups;
+
+  FcgiPool(const FcgiPool&);
+  FcgiPool& operator=(const FcgiPool&);
+};
+
+} // namespace ws
@@ -0,0 +1,97 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "webserv/net/AioPool.hpp"
+#include "webserv/net/Timer.hpp"
+
+namespace ws {
+
+class EventLoop;
+
+/**
+ * @brief Gets told, on the loop thread, that its files reached the disk.
+ */
+class DurableClient {
+public:
+  virtual ~DurableClient() {}
+  /** @brief ok == false: a sync failed, the data may be lost on a crash. */
+  virtual void onDurable(bool ok) = 0;
+};
+
+/**
+ * @brief One client's share of a group commit (owned by GroupCommit).
+ */
+struct DurableWait {
+  DurableClient* client;           ///< 0: client went away, result dropped
+  std::vector<std::string> files;  ///< fdatasync'ed
+  std::string dir;                 ///< fsync'ed with its ancestors: makes new entries stick
+  bool ok;
+
+  DurableWait() : client(0), ok(false) {}
+};
+
+/**
+ * @brief Group commit counters (see GroupCommit::stats()).
+ */
+struct GroupCommitStats {
+  unsigned long long requests;   ///< uploads that waited for a sync
+  unsigned long long batches;    ///< sync jobs run on the aio pool
+  unsigned long long syncfs;     ///< batches synced per filesystem instead of per file
+  unsigned long long failures;
+  size_t largestBatch;
+
+  GroupCommitStats() : requests(0), batches(0), syncfs(0), failures(0), largestBatch(0) {}
+};
+
+/**
+ * @brief `upload_durability group`: batches the fdatasync/fsync calls of
+ *        concurrent uploads; owned by the EventLoop.
+ *
+ * Waits collect until `batch` of them are pending or the oldest has waited
+ * `delay` ms; then the whole group goes to the aio pool as one job. The job
+ * fdatasyncs each file and fsyncs each directory once, or — for a group of
+ * SYNCFS_MIN files and more on Linux — issues a single syncfs() per
+ * filesystem. Besides the upload directory, every ancestor named in its
+ * path is fsync'ed too, so directories created on the fly for the upload
+ * (ensureDirRecursive) survive a crash as well. Each client hears back
+ * only after its own files and directories are on stable storage.
+ */
+class GroupCommit : public TimerListener, public AioClient {
+public:
+  static const size_t SYNCFS_MIN = 16;
+
+  GroupCommit() : _loop(0), _batch(0), _deadline(0) {}
+  ~GroupCommit();
+
+  void init(EventLoop* loop) { _loop = loop; }
+
+  /**
+   * @brief Sync `files` and `dir`, then call c->onDurable() — always
+   *        later from the loop, never from inside this call.
+   * @param delayMs longest time to wait for companions.
+   * @param batch   group size that is synced without waiting.
+   */
+  DurableWait* request(DurableClient* c, const std::vector<std::string>& files,
+                       const std::string& dir, size_t delayMs, size_t batch);
+  /** @brief c went away: the sync still happens, the result is dropped. */
+  void cancel(DurableWait* w) { w->client = 0; }
+
+  const GroupCommitStats& stats() const { return _st; }
+
+  void onTimer();
+  void onAioDone(AioTask* t);
+
+private:
+  EventLoop* _loop;
+  std::vector<DurableWait*> _pending;
+  size_t _batch;         // наименьший batch среди ожидающих
+  long long _deadline;   // monotonicMs: самый ранний срок среди ожидающих
+  GroupCommitStats _st;
+
+  void flush();
+
+  GroupCommit(const GroupCommit&);
+  GroupCommit& operator=(const GroupCommit&);
+};
+
+} // namespace ws
@@ -0,0 +1,28 @@
+#pragma once
+
+namespace ws {
+
+/**
+ * @brief Anything besides client sockets that wants fds polled by the EventLoop
+ *        (CGI pipes, SIGCHLD self-pipe, ...).
+ *
+ * Interest is re-queried every loop iteration, so a watcher applies
+ * backpressure simply by returning 0 from ioEvents().
+ */
+class IoWatcher {
+public:
+  virtual ~IoWatcher() {}
+
+  /**
+   * @brief Events to wait for on fd (POLLIN/POLLOUT; 0 = skip this round).
+   */
+  virtual short ioEvents(int fd) const = 0;
+
+  /**
+   * @brief fd is ready. The watcher may unwatch fd (or be destroyed by
+   *        its owner) from inside this call.
+   */
+  virtual void onIo(int fd, short revents) = 0;
+};
+
+} // namespace ws
@@ -26,6 +26,7 @@ private:
 // вспомогательные функции (реализованы в Listener.cpp)
 bool setNonBlocking(int fd);
 bool setReuseAddr(int fd);
+bool setCloseOnExec(int fd); // чтобы fd не утекали в дочерние CGI
 
 } // namespace ws
 
@@ -1,29 +1,33 @@
 #pragma once
 #include <string>
 #include "webserv/config/Config.hpp"
+#include "webserv/http/Method.hpp"
 
 namespace ws {
 
 /**
  * @brief Is method implemented by server core.
- * @param m method string (e.g. "GET").
+ * @param m parsed method.
  * @return true for GET/POST/DELETE/HEAD.
  */
-bool isImplemented(const std::string& m);
+inline bool isImplemented(Method m) { return (m & METHODS_IMPLEMENTED) != 0; }
 
 /**
- * @brief Check allow_methods (HEAD is allowed if GET is present).
+ * @brief Check allow_methods via the mask compiled at config load
+ *        (HEAD is allowed iff GET is present).
  * @param loc location (nullable).
- * @param method method to check ("GET" for HEAD check).
+ * @param m parsed method.
  * @return true if allowed.
  */
-bool isAllowed(const ws::Location* loc, const std::string& method);
+inline bool isAllowed(const ws::Location* loc, Method m) {
+  return ((loc ? loc->allow_mask : METHODS_DEFAULT) & m) != 0;
+}
 
 /**
- * @brief Compute Allow header value from location rules.
+ * @brief Allow header value precomputed for the location.
  * @param loc location (nullable).
  * @return e.g. "GET, POST, DELETE, HEAD".
  */
-std::string buildAllowHeader(const ws::Location* loc);
+const std::string& buildAllowHeader(const ws::Location* loc);
 
-} // namespace ws
\ No newline at end of file
+} // namespace ws
@@ -0,0 +1,181 @@
+#pragma once
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+#include <netinet/in.h>
+#include "webserv/config/Config.hpp"
+#include "webserv/http/Proxy.hpp"
+#include "webserv/net/CgiBackend.hpp"
+#include "webserv/net/IoWatcher.hpp"
+
+namespace ws {
+
+class EventLoop;
+class ProxyConn;
+class ProxyUpstream;
+
+/**
+ * @brief One HTTP request forwarded to a proxy_pass backend.
+ *
+ * Owned by the Connection, like CgiProcess. The upstream response is
+ * decoded into CGI-style output ("Status:", end-to-end headers, raw body),
+ * so the Connection streams it to the client the same way. While all
+ * upstream connections are busy the request waits in its upstream's queue
+ * with the body buffered locally. Deleting an unfinished request closes its
+ * upstream connection (it cannot be reused mid-response).
+ */
+class ProxyRequest : public CgiBackend {
+public:
+  ~ProxyRequest();
+
+  void writeStdin(const char* data, size_t n);
+  using CgiBackend::writeStdin;
+  void closeStdin();
+  size_t stdinBacklog() const;
+
+  bool outputDone() const { return _done; }
+  const std::string& output() const { return _out; }
+  void consumeOutput(size_t n) { _out.erase(0, n); }
+  /** @brief Upstream failed mid-response: the client must see it cut off. */
+  bool outputBroken() const { return _broken; }
+  /** @brief Drop the upstream connection and end the output right away. */
+  void terminate();
+
+private:
+  friend class ProxyConn;
+  friend class ProxyUpstream;
+
+  ProxyRequest(ProxyUpstream* up, CgiClient* client, const std::string& head, ProxyBody body,
+               bool headRequest);
+
+  ProxyUpstream* _up;
+  CgiClient* _client;
+  ProxyConn* _conn;      // 0: в очереди upstream или уже завершён
+  std::string _head;     // строка запроса + заголовки (для повтора на свежем соединении)
+  ProxyBody _body;
+  bool _headRequest;
+  std::string _stdin;    // тело до привязки (уже в framing upstream)
+  bool _stdinClosed;
+  bool _retried;
+  std::string _out;
+  bool _done;
+  bool _broken;
+
+  void encode(std::string& dst, const char* data, size_t n) const;
+  void finish();
+
+  ProxyRequest(const ProxyRequest&);
+  ProxyRequest& operator=(const ProxyRequest&);
+};
+
+/**
+ * @brief Keep-alive HTTP/1.1 connection to a backend; one request at a time.
+ *
+ * Between requests it stays in the upstream's pool and is watched for the
+ * backend closing it. A reused connection that dies before any response
+ * byte retries a body-less request once on a fresh connection.
+ */
+class ProxyConn : public IoWatcher {
+public:
+  ProxyConn(ProxyUpstream* up, EventLoop* loop);
+  ~ProxyConn();
+
+  bool idle() const { return _state != CLOSED && !_req; }
+  bool closed() const { return _state == CLOSED; }
+  /** @brief Connect if needed and queue r's head and buffered body. */
+  bool attach(ProxyRequest* r);
+  void queue(const std::string& data);
+  /** @brief Owner dropped r mid-request: the connection is closed. */
+  void abandon(ProxyRequest* r);
+  size_t pendingOut() const { return _out.size() - _outOff; }
+
+  short ioEvents(int fd) const;
+  void onIo(int fd, short revents);
+
+private:
+  enum State { CLOSED, CONNECTING, READY };
+
+  ProxyUpstream* _up;
+  EventLoop* _loop;
+  int _fd;
+  State _state;
+  std::string _out;
+  size_t _outOff;
+  ProxyResponseReader _rd;
+  ProxyRequest* _req;
+  bool _reused;           // запрос ушёл в соединение из пула
+
+  bool connect();
+  void close();
+  void complete();
+  void fail();
+
+  ProxyConn(const ProxyConn&);
+  ProxyConn& operator=(const ProxyConn&);
+};
+
+/**
+ * @brief One proxy_pass backend: resolved address + its connections +
+ *        queue of requests waiting for a free connection.
+ */
+class ProxyUpstream {
+public:
+  ProxyUpstream(const ProxyTarget& t, EventLoop* loop);
+  ~ProxyUpstream();
+
+  bool resolve(std::string& err);
+  const ProxyTarget& target() const { return _t; }
+  /** @return 0 if the backend cannot be reached (connect failed at once). */
+  ProxyRequest* open(const std::string& head, ProxyBody body, bool headRequest, CgiClient* client);
+  /** @brief Re-send r on a fresh connection (stale keep-alive). */
+  bool retry(ProxyRequest* r);
+  /** @brief Attach queued requests to free connections (after one frees up). */
+  void dispatch();
+  void cancel(ProxyRequest* r);
+
+  const struct sockaddr* sockAddr() const { return reinterpret_cast<const struct sockaddr*>(&_sa); }
+  socklen_t sockLen() const { return sizeof(_sa); }
+
+  static const size_t MAX_CONNS = 16; // занятые + простаивающие в пуле
+
+private:
+  ProxyTarget _t;
+  EventLoop* _loop;
+  struct sockaddr_in _sa;
+  std::vector<ProxyConn*> _conns;  // закрытые объекты переиспользуются
+  std::deque<ProxyRequest*> _waiting;
+
+  ProxyConn* freshConn();
+  ProxyConn* freeConn();
+
+  ProxyUpstream(const ProxyUpstream&);
+  ProxyUpstream& operator=(const ProxyUpstream&);
+};
+
+/**
+ * @brief proxy_pass value -> upstream; owned by the EventLoop.
+ */
+class ProxyPool {
+public:
+  ProxyPool() {}
+  ~ProxyPool();
+
+  /** @brief Register (and resolve) a proxy_pass from the config. */
+  bool add(const std::string& spec, EventLoop* loop, std::string& err);
+  /**
+   * @brief Forward req to loc's backend.
+   * @param clientAddr appended to X-Forwarded-For.
+   * @return 0 if the backend is unreachable (or was never registered).
+   */
+  ProxyRequest* open(const Location* loc, const HttpRequest& req,
+                     const std::string& clientAddr, CgiClient* client);
+
+private:
+  std::map<std::string, ProxyUpstream*> _ups;
+
+  ProxyPool(const ProxyPool&);
+  ProxyPool& operator=(const ProxyPool&);
+};
+
+} // namespace ws
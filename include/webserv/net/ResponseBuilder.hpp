@@ -4,19 +4,105 @@
 namespace ws {
 
 /**
- * @brief Build HTTP response start-line + headers.
+ * @brief Append decimal representation of v (no ostringstream, no temporaries).
+ * @param out buffer to append to.
+ * @param v   value.
+ */
+void appendUint(std::string& out, unsigned long long v);
+
+/**
+ * @brief Append lower-case hex representation of v (chunk sizes).
+ * @param out buffer to append to.
+ * @param v   value.
+ */
+void appendHex(std::string& out, unsigned long long v);
+
+/**
+ * @brief Append "HTTP/1.1 <code> <reason>\r\n".
+ *
+ * Status lines of the codes the server emits are precomputed once;
+ * other code/reason pairs are formatted in place.
+ */
+void appendStatusLine(std::string& out, int code, const std::string& reason);
+
+/**
+ * @brief Append "Connection: ..." (and Keep-Alive) header lines.
+ * @param keepAlive true for Connection: keep-alive (+Keep-Alive header).
+ */
+void appendConnection(std::string& out, bool keepAlive);
+
+/**
+ * @brief Append HTTP response start-line + headers into out.
  *
  * Sets: Server, Date, Content-Type, Content-Length, Connection,
  * optional Keep-Alive, optional Location, and appends extra headers.
+ * Date comes from the per-second cache (httpDateCached).
  *
+ * @param out     buffer to append to (its capacity is reused between responses).
  * @param code    HTTP status code.
  * @param reason  Reason phrase.
  * @param ctype   MIME type.
  * @param clen    Content-Length.
  * @param keepAlive true for Connection: keep-alive (+Keep-Alive header).
  * @param location Optional Location header.
- * @param dateStr  Preformatted Date (IMF-fixdate).
  * @param extra   Extra header lines, each ending with "\r\n".
+ */
+void appendHeaders(std::string& out,
+                   int code,
+                   const std::string& reason,
+                   const std::string& ctype,
+                   size_t clen,
+                   bool keepAlive,
+                   const std::string& location,
+                   const std::string& extra);
+
+/**
+ * @brief Same as appendHeaders, but with Transfer-Encoding: chunked
+ *        instead of Content-Length.
+ */
+void appendChunkedHeaders(std::string& out,
+                          int code,
+                          const std::string& reason,
+                          const std::string& ctype,
+                          bool keepAlive,
+                          const std::string& extra);
+
+/**
+ * @brief Header block of a fixed response, pre-rendered once.
+ *
+ * Only Date and Connection vary per response; everything before Date
+ * lives in pre, everything between Date and Connection in post.
+ */
+struct HeaderTemplate {
+  std::string pre;   ///< status-line + Server + "Date: "
+  std::string post;  ///< CRLF after Date + Content-Type + Content-Length
+};
+
+/**
+ * @brief Render a HeaderTemplate for a response with a known body length.
+ * @param tpl    destination template.
+ * @param code   HTTP status code.
+ * @param reason Reason phrase.
+ * @param ctype  MIME type.
+ * @param clen   Content-Length.
+ */
+void renderHeaderTemplate(HeaderTemplate& tpl, int code, const std::string& reason,
+                          const std::string& ctype, size_t clen);
+
+/**
+ * @brief Append headers from a template: pre + cached Date + post +
+ *        Connection + extra + final CRLF.
+ * @param extra additional header lines ("Name: value\r\n"), may be 0.
+ */
+void appendFromTemplate(std::string& out, const HeaderTemplate& tpl, bool keepAlive,
+                        const char* extra = 0);
+
+/**
+ * @brief Build HTTP response start-line + headers.
+ *
+ * Thin wrapper over appendHeaders for callers that want a fresh string.
+ *
+ * @param dateStr  Preformatted Date (IMF-fixdate); empty = cached current date.
  * @return Header block (ending with double CRLF).
  */
 std::string buildHeaders(int code,
@@ -35,4 +121,4 @@ std::string buildHeaders(int code,
  */
 void appendChunked(std::string& out, const std::string& body);
 
-} // namespace ws
\ No newline at end of file
+} // namespace ws
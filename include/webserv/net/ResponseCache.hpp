@@ -0,0 +1,90 @@
+#pragma once
+#include <map>
+#include <string>
+#include <vector>
+
+namespace ws {
+
+/**
+ * @brief A stored response: everything except per-connection headers
+ *        (Date, Connection, Content-Length are written on each hit).
+ */
+struct CachedResponse {
+  int status;
+  std::string reason;
+  std::string contentType;
+  std::string location;   ///< Location of a cached redirect
+  std::string headers;    ///< extra header lines, "K: V\r\n"
+  std::string body;
+
+  CachedResponse() : status(200) {}
+};
+
+/**
+ * @brief Parked on a key that another connection is producing right now.
+ */
+class CacheWaiter {
+public:
+  virtual ~CacheWaiter() {}
+  /**
+   * @brief The producer finished (stored or gave up): look the key up
+   *        again, and on a miss go to the backend without re-locking.
+   */
+  virtual void onCacheReady() = 0;
+};
+
+/**
+ * @brief In-memory microcache of generated responses (CGI, autoindex),
+ *        keyed by method + host + target; owned by the EventLoop.
+ *
+ * A miss with lock=true makes the caller the key's only producer: later
+ * misses for the same key park as waiters instead of running the backend
+ * again, and are woken by store() or unlock(). Entries live for the TTL
+ * of their location's cache_valid; the oldest are evicted above MAX_BYTES.
+ */
+class ResponseCache {
+public:
+  enum Lookup { HIT, MISS, WAIT };
+
+  static const size_t MAX_BYTES = 64u << 20;  ///< all bodies together
+  static const size_t MAX_ENTRY = 1u << 20;   ///< larger responses are not cached
+
+  ResponseCache() : _bytes(0) {}
+
+  static std::string key(const std::string& method, const std::string& host,
+                         const std::string& target);
+
+  /**
+   * @brief HIT: *hit points at the entry (valid until the next call);
+   *        MISS: not cached — with lock the caller must store() or unlock();
+   *        WAIT: someone else is producing it, w->onCacheReady() later.
+   */
+  Lookup lookup(const std::string& key, long long nowMs, bool lock,
+                CacheWaiter* w, const CachedResponse** hit);
+  /** @brief Keep r for ttlMs, release the key and wake its waiters. */
+  void store(const std::string& key, const CachedResponse& r, long long nowMs, long long ttlMs);
+  /** @brief The producer gives up (not cacheable, error, gone): wake the waiters. */
+  void unlock(const std::string& key);
+  /** @brief A parked waiter went away. */
+  void cancel(const std::string& key, CacheWaiter* w);
+
+private:
+  struct Entry {
+    CachedResponse resp;
+    long long expires;
+  };
+  typedef std::multimap<long long, std::string> ExpiryIndex;
+
+  std::map<std::string, Entry> _entries;
+  ExpiryIndex _byExpiry;   // expires -> key: вытесняем с начала
+  size_t _bytes;
+  std::map<std::string, std::vector<CacheWaiter*> > _locks;  // ключ в работе -> ждущие
+
+  void erase(std::map<std::string, Entry>::iterator it);
+  void evict(long long nowMs);
+
+  ResponseCache(const ResponseCache&);
+  ResponseCache& operator=(const ResponseCache&);
+};
+
+} // namespace ws
@@ -0,0 +1,58 @@
+#pragma once
+#include <map>
+#include <string>
+
+namespace ws {
+
+/**
+ * @brief One resumable upload.
+ */
+struct UploadSession {
+  unsigned long long length;  ///< Upload-Length announced at creation
+  unsigned long long offset;  ///< bytes stored so far (durable once saved)
+  long long touched;          ///< last save, unix seconds (expiry)
+  bool busy;                  ///< a PATCH is writing right now (not persisted)
+
+  UploadSession() : length(0), offset(0), touched(0), busy(false) {}
+};
+
+/**
+ * @brief Resumable (tus-style) upload sessions, grouped by upload_store
+ *        directory; owned by the EventLoop.
+ *
+ * A directory keeps its sessions in a small index file, <dir>/.resumable
+ * (one "id length offset touched" line per session), read on first use
+ * and rewritten atomically (temp file + rename) by save(). Data goes to
+ * <dir>/<id>.part at the session's offset and becomes <dir>/<id> once
+ * the last byte is in. Sessions idle for EXPIRE_SEC are dropped with
+ * their data on the next save of the directory.
+ */
+class ResumableUploads {
+public:
+  static const long long EXPIRE_SEC = 24 * 3600;
+
+  ResumableUploads() {}
+
+  /** @brief New empty session (and its .part file); 0 on I/O error. */
+  UploadSession* create(const std::string& dir, const std::string& id,
+                        unsigned long long length);
+  /** @return 0 if there is no such session. */
+  UploadSession* find(const std::string& dir, const std::string& id);
+  /** @brief Persist the directory's index (offsets of all its sessions). */
+  bool save(const std::string& dir);
+  /** @brief All bytes are in: publish <dir>/<id> and forget the session. */
+  bool finish(const std::string& dir, const std::string& id);
+
+  static std::string partPath(const std::string& dir, const std::string& id);
+
+private:
+  typedef std::map<std::string, UploadSession> Sessions;
+  std::map<std::string, Sessions> _dirs;  // upload_store -> сессии (индекс загружен)
+
+  Sessions& load(const std::string& dir);
+
+  ResumableUploads(const ResumableUploads&);
+  ResumableUploads& operator=(const ResumableUploads&);
+};
+
+} // namespace ws
@@ -0,0 +1,45 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "webserv/config/Config.hpp"
+#include "webserv/utils/Metrics.hpp"
+#include "webserv/net/AioPool.hpp"
+#include "webserv/net/GroupCommit.hpp"
+
+namespace ws {
+
+struct HttpRequest;
+
+/**
+ * @brief What a `stub_status` location reports, gathered on the loop thread.
+ */
+struct StatusReport {
+  MetricsSnapshot metrics;
+  AioStats aio;
+  GroupCommitStats commits;
+  std::vector<LatencyHistogram> latency;  ///< Metrics::latencySnapshot()
+  const Config* cfg;                      ///< names of the latency slots
+
+  StatusReport() : cfg(0) {}
+};
+
+/**
+ * @brief Prometheus format if asked for by `?format=prometheus` or by a
+ *        scraper's Accept (text/plain;version=0.0.4 or openmetrics).
+ */
+bool statusWantsPrometheus(const HttpRequest& req);
+
+/**
+ * @brief stub_status body: nginx-like text, or the Prometheus text
+ *        exposition format (counters with _total, gauges as is).
+ *
+ * Latency: the text has p50/p90/p99/p999 per server and per location
+ * that served requests; Prometheus gets the histograms themselves, with
+ * `server` and `location` labels (location="" — matched no location).
+ */
+std::string renderStatus(const StatusReport& r, bool prometheus);
+
+/** @brief Content-Type that goes with renderStatus(). */
+const char* statusContentType(bool prometheus);
+
+} // namespace ws
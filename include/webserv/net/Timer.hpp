@@ -0,0 +1,23 @@
+#pragma once
+
+namespace ws {
+
+/**
+ * @brief One-shot timeout driven by the EventLoop (EventLoop::setTimer).
+ *
+ * Each listener has at most one pending deadline; setting it again moves
+ * the deadline. Deadlines use the monotonic clock and bound the poll()
+ * timeout, so they fire on time even when no fd is active.
+ */
+class TimerListener {
+public:
+  virtual ~TimerListener() {}
+
+  /**
+   * @brief The deadline passed. Already disarmed: the listener may re-arm
+   *        itself or be destroyed by its owner from inside this call.
+   */
+  virtual void onTimer() = 0;
+};
+
+} // namespace ws
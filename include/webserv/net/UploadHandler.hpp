@@ -1,7 +1,9 @@
 #pragma once
 #include <string>
+#include <vector>
 #include "webserv/http/Request.hpp"
 #include "webserv/http/Router.hpp"
+#include "webserv/http/Multipart.hpp"
 
 namespace ws {
 
@@ -21,4 +23,61 @@ std::pair<int,std::string> handleUpload(const ws::RouteMatch& route,
                                         const ws::HttpRequest& req,
                                         std::string& outLocation);
 
-} // namespace ws
\ No newline at end of file
+/**
+ * @brief Streams a multipart/form-data body into upload_store: every part
+ *        goes to its own file <base>_<n> as its bytes arrive.
+ *
+ * The client's filename is only reported back, never used as a path.
+ * Destroying an upload that was not committed removes the files it wrote.
+ */
+class MultipartUpload : public MultipartSink {
+public:
+  /**
+   * @param dir       upload_store directory (created by open()).
+   * @param base      file name prefix, e.g. "up_<time>_<pid>_<rand>".
+   * @param urlPrefix public URL of dir, e.g. "/uploads/".
+   */
+  MultipartUpload(const std::string& boundary, const std::string& dir,
+                  const std::string& base, const std::string& urlPrefix);
+  ~MultipartUpload();
+
+  bool open();
+  /** @brief Next piece of the decoded body; false: malformed or write failed. */
+  bool feed(const char* data, size_t n);
+  /** @brief Closing boundary seen and at least one part stored. */
+  bool complete() const { return _parser.done() && !_parts.empty(); }
+  /** @brief true if feed() failed on the disk, not on the client's data. */
+  bool writeFailed() const { return _writeFailed; }
+
+  /** @brief Keep the files; returns the JSON part list for the 201 body. */
+  std::string commit();
+  /** @brief URL of the first stored part (the Location of the 201). */
+  const std::string& firstUrl() const { return _parts.front().url; }
+  /** @brief Files written so far (for upload_durability). */
+  std::vector<std::string> paths() const;
+  const std::string& dir() const { return _dir; }
+
+  bool partBegin(const MultipartPart& p);
+  bool partData(const char* data, size_t n);
+  bool partEnd();
+
+private:
+  struct Stored {
+    MultipartPart part;
+    std::string path;
+    std::string url;
+    unsigned long long size;
+  };
+
+  MultipartParser _parser;
+  std::string _dir, _base, _urlPrefix;
+  std::vector<Stored> _parts;
+  int _fd;              // файл текущей части, -1 между частями
+  bool _committed;
+  bool _writeFailed;
+
+  MultipartUpload(const MultipartUpload&);
+  MultipartUpload& operator=(const MultipartUpload&);
+};
+
+} // namespace ws
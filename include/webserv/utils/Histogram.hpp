@@ -0,0 +1,55 @@
+#pragma once
+#include <cstddef>
+
+namespace ws {
+
+/**
+ * @brief HDR-style latency histogram in microseconds: fixed log buckets.
+ *
+ * Values below 16 us get a bucket each; above that every power of two is
+ * split into 16 equal sub-buckets, so a bucket is at most 1/16 (6.25%) of
+ * its value wide. Values from 2^36 us (~19 h) up are counted in the last
+ * bucket. record() is a couple of shifts and three adds: no allocation, no
+ * branches on the data besides the small-value case.
+ */
+struct LatencyHistogram {
+  static const unsigned SUB_BITS = 4;
+  static const unsigned SUB = 1u << SUB_BITS;   // под-корзин на степень двойки
+  static const unsigned MAX_BITS = 36;          // 2^36 мкс и больше — в последнюю
+  static const size_t BUCKETS = SUB + (MAX_BITS - SUB_BITS) * SUB;
+
+  unsigned long long counts[BUCKETS];
+  unsigned long long total;  ///< values recorded
+  unsigned long long sum;    ///< of the values, us
+
+  /** @brief Bucket of a value (O(1): one count-leading-zeros). */
+  static size_t bucketOf(unsigned long long us);
+  /** @brief Largest value that falls into bucket i. */
+  static unsigned long long bucketHigh(size_t i);
+
+  void record(unsigned long long us);
+  void merge(const LatencyHistogram& o);
+  /**
+   * @brief Value at quantile q (0.5, 0.99, ...): the upper edge of the
+   *        bucket holding it, as HdrHistogram reports. 0 when empty.
+   */
+  unsigned long long percentile(double q) const;
+  /** @brief Values in buckets lying entirely at or below `us`. */
+  unsigned long long countAtMost(unsigned long long us) const;
+};
+
+inline size_t LatencyHistogram::bucketOf(unsigned long long us) {
+  if (us < SUB) return (size_t)us;
+  if (us >> MAX_BITS) return BUCKETS - 1;
+  const unsigned top = 63u - (unsigned)__builtin_clzll(us);  // старший бит, >= SUB_BITS
+  const unsigned shift = top - SUB_BITS;
+  return SUB + shift * SUB + (size_t)((us >> shift) - SUB);
+}
+
+inline void LatencyHistogram::record(unsigned long long us) {
+  ++counts[bucketOf(us)];
+  ++total;
+  sum += us;
+}
+
+} // namespace ws
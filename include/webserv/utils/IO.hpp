@@ -1,5 +1,7 @@
 #pragma once
 #include <string>
+#include <cstddef>
+#include <sys/types.h>
 
 namespace ws {
 
@@ -26,4 +28,39 @@ bool writeBinary(const std::string& path, const std::string& data);
  */
 bool ensureDirRecursive(const std::string& dir);
 
-} // namespace ws
\ No newline at end of file
+/**
+ * @brief true if the read/write that just returned -1 on a non-blocking fd
+ *        only has to be retried on a later poll event (EAGAIN, EINTR);
+ *        false — the fd is really broken. Call right after the failed call.
+ */
+bool ioTryAgain();
+
+/**
+ * @brief true if spliceBytes() moves data in the kernel on this platform
+ *        (Linux splice(2)); elsewhere callers keep the read/write path.
+ */
+bool haveSplice();
+
+/**
+ * @brief Move up to n bytes from one fd to another without copying them
+ *        into user space. One of the fds must be a pipe. Never blocks.
+ * @return bytes moved; 0 — EOF on from; -1 — nothing can move right now
+ *         (or unsupported).
+ */
+long spliceBytes(int from, int to, size_t n);
+
+/**
+ * @brief Bytes ready to be read from a pipe or socket (FIONREAD).
+ * @return count, or -1 on error.
+ */
+long pendingBytes(int fd);
+
+/**
+ * @brief Send up to n bytes of a regular file from offset off to a socket
+ *        (Linux sendfile(2), else pread + send). Never blocks on a
+ *        non-blocking socket; off advances by the bytes sent.
+ * @return bytes sent; 0 — file ended early; -1 — socket full (or error).
+ */
+long sendFileBytes(int sock, int fd, off_t& off, size_t n);
+
+} // namespace ws
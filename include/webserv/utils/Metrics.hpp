@@ -0,0 +1,120 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "webserv/utils/Histogram.hpp"
+
+namespace ws {
+
+struct MetricsShard;
+struct MetricsSnapshot;
+
+/**
+ * @brief Process-wide counters and gauges with a private shard per thread.
+ *
+ * Each thread writes only its own shard (allocated on first use, aligned
+ * and padded to a cache line), so an update is a plain non-atomic add to
+ * thread-local memory: no locks, no atomics, no shared cache lines.
+ * Readers sum all shards in snapshot(); a shard is never freed, so the
+ * counts of threads that exited stay in the totals. Gauges are kept as
+ * +/- deltas: a connection may go up on one thread and down on another.
+ *
+ * Latency histograms live in the same shard: one pair (whole request,
+ * time to first byte) per slot — a server or location, see
+ * Location::stats_slot. A thread allocates its histograms on its first
+ * latency(); after that recording is allocation-free.
+ */
+class Metrics {
+public:
+  enum Counter {
+    CONN_ACCEPTED,
+    REQUESTS,       ///< responses fully sent
+    RESP_1XX,
+    RESP_2XX,
+    RESP_3XX,
+    RESP_4XX,
+    RESP_5XX,
+    BYTES_IN,
+    BYTES_OUT,
+    CGI_SPAWNS,
+    PARSE_ERRORS,   ///< 400/411/413/501 from the request parser
+    CACHE_HITS,
+    CACHE_MISSES,
+    AIO_TASKS,      ///< run on aio pool threads
+    ACCESS_LOG_DROPS,  ///< access_log lines lost: the writer fell behind
+    COUNTER_COUNT
+  };
+  enum Gauge {
+    CONN_ACTIVE,
+    CONN_IDLE,      ///< waiting for the next request (keep-alive or fresh)
+    GAUGE_COUNT
+  };
+  enum Latency {
+    LAT_TOTAL,      ///< first request byte read -> last response byte sent
+    LAT_TTFB,       ///< first request byte read -> first response byte sent
+    LATENCY_KINDS
+  };
+
+  static void inc(Counter c);
+  static void add(Counter c, unsigned long long n);
+  static void gauge(Gauge g, long long delta);
+  /** @brief RESP_1XX..RESP_5XX for a status code. */
+  static void response(int status);
+
+  /**
+   * @brief Number of latency slots; set once at startup, before any
+   *        thread records. Slots >= n are ignored.
+   */
+  static void setLatencySlots(size_t n);
+  static size_t latencySlots();
+  /** @brief Record one request's times (us) under `slot`. */
+  static void latency(size_t slot, unsigned long long totalUs, unsigned long long ttfbUs);
+
+  static MetricsSnapshot snapshot();
+  /**
+   * @brief All threads' histograms merged: out[slot * LATENCY_KINDS + kind].
+   */
+  static void latencySnapshot(std::vector<LatencyHistogram>& out);
+
+private:
+  static __thread MetricsShard* _shard;  // свой у каждого потока; 0 — ещё не выдан
+
+  static MetricsShard* shard();
+  static MetricsShard* attach();
+  static LatencyHistogram* attachLatency(MetricsShard* s);
+};
+
+/**
+ * @brief One thread's counters; padded so no two shards share a cache line.
+ */
+struct MetricsShard {
+  unsigned long long counters[Metrics::COUNTER_COUNT];
+  long long gauges[Metrics::GAUGE_COUNT];
+  LatencyHistogram* latency;  ///< latencySlots() * LATENCY_KINDS; 0 until first use
+};
+
+/**
+ * @brief Sum of all threads' shards at one moment (see Metrics::snapshot()).
+ */
+struct MetricsSnapshot {
+  unsigned long long counters[Metrics::COUNTER_COUNT];
+  long long gauges[Metrics::GAUGE_COUNT];
+  size_t threads;  ///< threads that have touched a metric so far
+};
+
+// горячий путь: обычное сложение в памяти своего потока
+inline MetricsShard* Metrics::shard() { return _shard ? _shard : attach(); }
+inline void Metrics::inc(Counter c) { shard()->counters[c] += 1; }
+inline void Metrics::add(Counter c, unsigned long long n) { shard()->counters[c] += n; }
+inline void Metrics::gauge(Gauge g, long long delta) { shard()->gauges[g] += delta; }
+inline void Metrics::response(int status) {
+  if (status >= 100 && status < 600) inc((Counter)(RESP_1XX + status / 100 - 1));
+}
+inline void Metrics::latency(size_t slot, unsigned long long totalUs, unsigned long long ttfbUs) {
+  MetricsShard* s = shard();
+  LatencyHistogram* h = s->latency ? s->latency : attachLatency(s);
+  if (!h || slot >= latencySlots()) return;
+  h[slot * LATENCY_KINDS + LAT_TOTAL].record(totalUs);
+  h[slot * LATENCY_KINDS + LAT_TTFB].record(ttfbUs);
+}
+
+} // namespace ws
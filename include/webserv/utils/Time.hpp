@@ -10,6 +10,33 @@ namespace ws {
  */
 std::string httpDateNow();
 
+/**
+ * @brief Cached IMF-fixdate for the current second.
+ *
+ * The string is re-formatted at most once per second (see refreshHttpDate),
+ * so response headers can copy it without calling strftime.
+ * @return Reference valid until the next refresh.
+ */
+const std::string& httpDateCached();
+
+/**
+ * @brief Re-format the cached Date if the wall-clock second has changed.
+ * Called by the event loop on every iteration.
+ * @param now epoch seconds (time(0)).
+ */
+void refreshHttpDate(time_t now);
+
+/**
+ * @brief Monotonic clock for timeouts (not affected by wall-clock jumps).
+ * @return milliseconds since an arbitrary fixed point.
+ */
+long long monotonicMs();
+
+/**
+ * @brief Same clock in microseconds (latency histograms).
+ */
+long long monotonicUs();
+
 /**
  * @brief RFC7231 IMF-fixdate for given time (GMT).
  * @param t epoch seconds (time_t).
@@ -24,4 +24,24 @@ size_t parseSizeWithUnits(const std::string& s, size_t ln, size_t col) {
     return base * mult;
 }
 
-} // namespace ws
\ No newline at end of file
+size_t parseCount(const std::string& s, const char* what, size_t ln, size_t col) {
+    if (s.empty()) throw ConfigError(std::string(what) + " expects a number", ln, col);
+    for (size_t i=0;i<s.size();++i) if (!std::isdigit(s[i])) {
+        throw ConfigError(std::string(what) + " expects a number: " + s, ln, col);
+    }
+    return static_cast<size_t>(std::strtoul(s.c_str(), 0, 10));
+}
+
+size_t parseSeconds(const std::string& s, const char* what, size_t ln, size_t col) {
+    if (endsWith(s, "s")) return parseCount(s.substr(0, s.size()-1), what, ln, col);
+    if (endsWith(s, "m")) return parseCount(s.substr(0, s.size()-1), what, ln, col) * 60;
+    return parseCount(s, what, ln, col);
+}
+
+size_t parseMillis(const std::string& s, const char* what, size_t ln, size_t col) {
+    if (endsWith(s, "ms")) return parseCount(s.substr(0, s.size()-2), what, ln, col);
+    if (endsWith(s, "s")) return parseCount(s.substr(0, s.size()-1), what, ln, col) * 1000;
+    return parseCount(s, what, ln, col);
+}
+
+} // namespace ws
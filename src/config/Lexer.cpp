@@ -6,10 +6,10 @@ Lexer::Lexer(const std::string& input)
 : _s(input), _i(0), _line(1), _col(1) {}
 
 static bool isIdentStart(char c) {
-    return std::isalnum(static_cast<unsigned char>(c)) || c=='_' || c=='.' || c=='/' || c=='-' || c==':';
+    return std::isalnum(static_cast<unsigned char>(c)) || c=='_' || c=='.' || c=='/' || c=='-' || c==':' || c=='*';
 }
 static bool isIdent(char c) {
-    return std::isalnum(static_cast<unsigned char>(c)) || c=='_' || c=='.' || c=='/' || c=='-' || c==':';
+    return std::isalnum(static_cast<unsigned char>(c)) || c=='_' || c=='.' || c=='/' || c=='-' || c==':' || c=='*'; // '*' — для server_name *.example.com
 }
 
 void Lexer::skipSpacesAndComments() {
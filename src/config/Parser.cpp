@@ -1,4 +1,10 @@
 #include "webserv/config/Parser.hpp"
+#include "webserv/http/Method.hpp"
+#include "webserv/http/RegexSet.hpp"
+#include "webserv/http/Cgi.hpp"
+#include "webserv/http/FastCgi.hpp"
+#include "webserv/http/Proxy.hpp"
+#include "webserv/Log.hpp"
 #include <sstream>
 
 namespace ws {
@@ -25,12 +31,27 @@ Config Parser::parse() {
     while (cur.type != T_EOF) {
         if (cur.type == T_IDENTIFIER && cur.text == "server") {
             parseServer(cfg);
+        } else if (cur.type == T_IDENTIFIER && cur.text == "error_log") {
+            // error_log debug|info|notice|warn|error; — один на процесс, вне server
+            next();
+            Log::Level lvl;
+            if (cur.type != T_IDENTIFIER || !Log::levelFromName(cur.text, lvl))
+                throw ConfigError("error_log expects a level (debug, info, warn, error)", cur.line, cur.col);
+            cfg.error_log = cur.text;
+            next(); expect(T_SEMI, "';'");
         } else {
             throw ConfigError("expected 'server' block", cur.line, cur.col);
         }
     }
     if (cfg.servers.empty())
         throw ConfigError("no server blocks found", cur.line, cur.col);
+    // сквозная нумерация серверов и location'ов: индекс гистограмм задержек
+    for (size_t i = 0; i < cfg.servers.size(); ++i) {
+        ServerConfig& srv = cfg.servers[i];
+        srv.stats_slot = cfg.stats_slots++;
+        for (size_t j = 0; j < srv.locations.size(); ++j)
+            srv.locations[j].stats_slot = cfg.stats_slots++;
+    }
     return cfg;
 }
 
@@ -48,8 +69,42 @@ static bool isTokenIdent(const Token& t, const char* s) {
     return t.type==T_IDENTIFIER && t.text==s;
 }
 
+// access_log off; | access_log path [combined|common|timing] [buffer=64k] [flush=1s];
+void Parser::parseAccessLog(AccessLogConfig& al) {
+    next();
+    if (cur.type!=T_IDENTIFIER && cur.type!=T_STRING)
+        throw ConfigError("access_log expects path or off", cur.line, cur.col);
+    al = AccessLogConfig();
+    al.set = true;
+    if (cur.type == T_IDENTIFIER && cur.text == "off") { next(); expect(T_SEMI, "';'"); return; }
+    al.path = cur.text; next();
+    while (cur.type == T_IDENTIFIER) {
+        const std::string key = cur.text;
+        const size_t ln = cur.line, col = cur.col;
+        next();
+        if (!isTokenIdent(cur, "=")) {
+            if (key != "combined" && key != "common" && key != "timing")
+                throw ConfigError("access_log: unknown format " + key, ln, col);
+            al.format = key;
+            continue;
+        }
+        next();
+        if (cur.type != T_IDENTIFIER) throw ConfigError("access_log: " + key + "= expects a value", cur.line, cur.col);
+        if (key == "buffer") al.buffer = parseSizeWithUnits(cur.text, cur.line, cur.col);
+        else if (key == "flush") al.flush_ms = parseMillis(cur.text, "access_log flush", cur.line, cur.col);
+        else throw ConfigError("access_log: unknown parameter " + key, ln, col);
+        next();
+    }
+    expect(T_SEMI, "';'");
+}
+
 void Parser::parseServerBody(ServerConfig& srv) {
+    std::vector<std::pair<size_t, size_t> > locPos; // строка/столбец каждого location — для ошибок ниже
     while (!accept(T_RBRACE)) {
+        if (isTokenIdent(cur, "access_log")) {
+            parseAccessLog(srv.access_log);
+            continue;
+        }
         if (isTokenIdent(cur, "listen")) {
             next();
             // listen 0.0.0.0:8080;
@@ -107,6 +162,7 @@ void Parser::parseServerBody(ServerConfig& srv) {
             continue;
         }
         if (isTokenIdent(cur, "location")) {
+            locPos.push_back(std::make_pair(cur.line, cur.col));
             parseLocation(srv);
             continue;
         }
@@ -116,18 +172,42 @@ void Parser::parseServerBody(ServerConfig& srv) {
         throw ConfigError("unknown directive in server: " + unk, cur.line, cur.col);
     }
 
+    // все regex-location сервера станут одним DFA — проверим, что он строится
+    {
+        RegexSet all;
+        std::string err;
+        for (size_t i = 0; i < srv.locations.size(); ++i)
+            if (srv.locations[i].match == LOC_REGEX
+                && !all.add(srv.locations[i].path, srv.locations[i].regex_icase, (int)i, err))
+                throw ConfigError("bad regex \"" + srv.locations[i].path + "\": " + err,
+                                  locPos[i].first, locPos[i].second);
+        if (!all.compile(err)) throw ConfigError(err, cur.line, cur.col);
+    }
+
     // валидации
     if (srv.host.empty()) throw ConfigError("server: missing listen host", cur.line, cur.col);
     if (srv.port<=0)      throw ConfigError("server: invalid listen port", cur.line, cur.col);
     if (srv.root.empty()) srv.root = "."; // допустим дефолт
+
+    // окружение CGI: постоянная часть — один раз, а не на каждый запуск
+    for (size_t i = 0; i < srv.locations.size(); ++i)
+        if (!srv.locations[i].cgi_bin.empty() || !srv.locations[i].fastcgi_pass.empty())
+            srv.locations[i].cgi_env = CgiHandler::envTemplate(srv, srv.locations[i]);
 }
 
 void Parser::parseLocation(ServerConfig& srv) {
-    // location /path {
+    // location [= | ~ | ~*] /path {
     expect(T_IDENTIFIER, "'location'"); // уже проверено выше, просто сдвигаем
+    Location loc;
+    size_t locLine = cur.line, locCol = cur.col;
+    if (isTokenIdent(cur, "=")) { loc.match = LOC_EXACT; next(); }
+    else if (isTokenIdent(cur, "~")) {
+        loc.match = LOC_REGEX; next();
+        if (isTokenIdent(cur, "*")) { loc.regex_icase = true; next(); }
+    }
     if (cur.type!=T_IDENTIFIER && cur.type!=T_STRING)
         throw ConfigError("location expects path", cur.line, cur.col);
-    Location loc; loc.path = cur.text; next();
+    loc.path = cur.text; next();
     expect(T_LBRACE, "'{' after location");
 
     while (!accept(T_RBRACE)) {
@@ -161,6 +241,35 @@ void Parser::parseLocation(ServerConfig& srv) {
             loc.autoindex = toBool(cur.text); next(); expect(T_SEMI, "';'");
             continue;
         }
+        if (isTokenIdent(cur, "internal")) {
+            next(); expect(T_SEMI, "';'");
+            loc.internal = true;
+            continue;
+        }
+        if (isTokenIdent(cur, "access_log")) {
+            parseAccessLog(loc.access_log);
+            continue;
+        }
+        if (isTokenIdent(cur, "stub_status")) {
+            next(); expect(T_SEMI, "';'");
+            loc.stub_status = true;
+            continue;
+        }
+        if (isTokenIdent(cur, "aio")) {
+            next();
+            if (cur.type!=T_IDENTIFIER || (cur.text != "threads" && cur.text != "off"))
+                throw ConfigError("aio expects threads [N] or off", cur.line, cur.col);
+            bool on = cur.text == "threads";
+            next();
+            loc.aio_threads = on ? 4 : 0; // без числа — 4 потока
+            if (on && cur.type == T_IDENTIFIER) {
+                loc.aio_threads = parseCount(cur.text, "aio threads", cur.line, cur.col);
+                if (loc.aio_threads == 0) throw ConfigError("aio threads must be > 0", cur.line, cur.col);
+                next();
+            }
+            expect(T_SEMI, "';'");
+            continue;
+        }
         if (isTokenIdent(cur, "upload_enable")) {
             next();
             if (cur.type!=T_IDENTIFIER) throw ConfigError("upload_enable expects on/off", cur.line, cur.col);
@@ -173,6 +282,25 @@ void Parser::parseLocation(ServerConfig& srv) {
             loc.upload_store = cur.text; next(); expect(T_SEMI, "';'");
             continue;
         }
+        if (isTokenIdent(cur, "upload_durability")) {
+            // upload_durability off | group [задержка] [размер группы];
+            next();
+            if (cur.type!=T_IDENTIFIER || (cur.text != "group" && cur.text != "off"))
+                throw ConfigError("upload_durability expects group [delay] [batch] or off", cur.line, cur.col);
+            loc.upload_durable = cur.text == "group";
+            next();
+            if (loc.upload_durable && cur.type == T_IDENTIFIER) {
+                loc.upload_sync_delay = parseMillis(cur.text, "upload_durability delay", cur.line, cur.col);
+                next();
+            }
+            if (loc.upload_durable && cur.type == T_IDENTIFIER) {
+                loc.upload_sync_batch = parseCount(cur.text, "upload_durability batch", cur.line, cur.col);
+                if (loc.upload_sync_batch == 0) throw ConfigError("upload_durability batch must be > 0", cur.line, cur.col);
+                next();
+            }
+            expect(T_SEMI, "';'");
+            continue;
+        }
         if (isTokenIdent(cur, "return")) {
             next();
             if (cur.type!=T_IDENTIFIER) throw ConfigError("return expects code", cur.line, cur.col);
@@ -193,6 +321,85 @@ void Parser::parseLocation(ServerConfig& srv) {
             loc.cgi_bin = cur.text; next(); expect(T_SEMI, "';'");
             continue;
         }
+        if (isTokenIdent(cur, "fastcgi_pass")) {
+            next();
+            if (cur.type!=T_IDENTIFIER && cur.type!=T_STRING) throw ConfigError("fastcgi_pass expects address", cur.line, cur.col);
+            FcgiAddress addr; std::string err;
+            if (!fcgiParseAddress(cur.text, addr, err)) throw ConfigError(err, cur.line, cur.col);
+            loc.fastcgi_pass = cur.text; next(); expect(T_SEMI, "';'");
+            continue;
+        }
+        if (isTokenIdent(cur, "proxy_pass")) {
+            next();
+            if (cur.type!=T_IDENTIFIER && cur.type!=T_STRING) throw ConfigError("proxy_pass expects http://host[:port][/uri]", cur.line, cur.col);
+            ProxyTarget t; std::string err;
+            if (!proxyParseTarget(cur.text, t, err)) throw ConfigError(err, cur.line, cur.col);
+            loc.proxy_pass = cur.text; next(); expect(T_SEMI, "';'");
+            continue;
+        }
+        if (isTokenIdent(cur, "cgi_pool")) {
+            next();
+            if (cur.type!=T_IDENTIFIER) throw ConfigError("cgi_pool expects number of workers", cur.line, cur.col);
+            loc.cgi_pool = parseCount(cur.text, "cgi_pool", cur.line, cur.col);
+            next(); expect(T_SEMI, "';'");
+            continue;
+        }
+        if (isTokenIdent(cur, "cgi_pool_worker")) {
+            next();
+            if (cur.type!=T_IDENTIFIER && cur.type!=T_STRING) throw ConfigError("cgi_pool_worker expects path", cur.line, cur.col);
+            loc.cgi_pool_worker = cur.text; next(); expect(T_SEMI, "';'");
+            continue;
+        }
+        if (isTokenIdent(cur, "cgi_pool_max_requests")) {
+            next();
+            if (cur.type!=T_IDENTIFIER) throw ConfigError("cgi_pool_max_requests expects number", cur.line, cur.col);
+            loc.cgi_pool_max_requests = parseCount(cur.text, "cgi_pool_max_requests", cur.line, cur.col);
+            if (loc.cgi_pool_max_requests == 0) throw ConfigError("cgi_pool_max_requests must be > 0", cur.line, cur.col);
+            next(); expect(T_SEMI, "';'");
+            continue;
+        }
+        if (isTokenIdent(cur, "cgi_max_concurrency")) {
+            next();
+            if (cur.type!=T_IDENTIFIER) throw ConfigError("cgi_max_concurrency expects number", cur.line, cur.col);
+            loc.cgi_max_concurrency = parseCount(cur.text, "cgi_max_concurrency", cur.line, cur.col);
+            next(); expect(T_SEMI, "';'");
+            continue;
+        }
+        if (isTokenIdent(cur, "cgi_queue")) {
+            next();
+            if (cur.type!=T_IDENTIFIER) throw ConfigError("cgi_queue expects number", cur.line, cur.col);
+            loc.cgi_queue = parseCount(cur.text, "cgi_queue", cur.line, cur.col);
+            next(); expect(T_SEMI, "';'");
+            continue;
+        }
+        if (isTokenIdent(cur, "cgi_timeout")) {
+            next();
+            if (cur.type!=T_IDENTIFIER) throw ConfigError("cgi_timeout expects seconds", cur.line, cur.col);
+            loc.cgi_timeout = parseSeconds(cur.text, "cgi_timeout", cur.line, cur.col);
+            next(); expect(T_SEMI, "';'");
+            continue;
+        }
+        if (isTokenIdent(cur, "cache_valid")) {
+            // cache_valid [код ...] время;  без кодов — 200 301 302, как в nginx
+            size_t ln = cur.line, cl = cur.col;
+            next();
+            std::vector<std::string> args;
+            while (cur.type==T_IDENTIFIER) { args.push_back(cur.text); next(); }
+            expect(T_SEMI, "';'");
+            if (args.empty()) throw ConfigError("cache_valid expects [codes] time", ln, cl);
+            size_t ttl = parseSeconds(args.back(), "cache_valid", ln, cl);
+            if (args.size() == 1) {
+                loc.cache_valid[200] = ttl;
+                loc.cache_valid[301] = ttl;
+                loc.cache_valid[302] = ttl;
+            }
+            for (size_t i = 0; i + 1 < args.size(); ++i) {
+                size_t code = parseCount(args[i], "cache_valid", ln, cl);
+                if (code < 100 || code > 599) throw ConfigError("cache_valid: bad status code " + args[i], ln, cl);
+                loc.cache_valid[(int)code] = ttl;
+            }
+            continue;
+        }
         if (isTokenIdent(cur, "client_max_body_size")) {
             next();
             if (cur.type!=T_IDENTIFIER) throw ConfigError("client_max_body_size expects size", cur.line, cur.col);
@@ -206,8 +413,30 @@ void Parser::parseLocation(ServerConfig& srv) {
     }
 
     // простые проверки
-    if (loc.path.empty() || loc.path[0] != '/')
+    if (loc.match != LOC_REGEX && (loc.path.empty() || loc.path[0] != '/'))
         throw ConfigError("location path must start with '/'", cur.line, cur.col);
+    if (loc.match == LOC_REGEX && loc.path.empty())
+        throw ConfigError("regex location expects a pattern", cur.line, cur.col);
+    // в regex-location нечего «отрезать» для alias — только root
+    if (loc.match == LOC_REGEX && !loc.alias.empty())
+        throw ConfigError("alias is not supported in regex locations", cur.line, cur.col);
+    if (loc.cgi_pool && (loc.cgi_bin.empty() || loc.cgi_pool_worker.empty()))
+        throw ConfigError("cgi_pool requires cgi_bin and cgi_pool_worker", locLine, locCol);
+    if (!loc.proxy_pass.empty() && (!loc.cgi_bin.empty() || !loc.fastcgi_pass.empty()))
+        throw ConfigError("proxy_pass cannot be combined with cgi_bin or fastcgi_pass", locLine, locCol);
+    // URI в proxy_pass заменяет префикс location; у = и ~ заменять нечего
+    if (!loc.proxy_pass.empty() && loc.match != LOC_PREFIX) {
+        ProxyTarget t; std::string err;
+        proxyParseTarget(loc.proxy_pass, t, err);
+        if (!t.uri.empty())
+            throw ConfigError("proxy_pass with a URI is allowed only in prefix locations", locLine, locCol);
+    }
+    if (loc.match == LOC_REGEX) {
+        RegexSet probe;
+        std::string err;
+        if (!probe.add(loc.path, loc.regex_icase, 0, err))
+            throw ConfigError("bad regex \"" + loc.path + "\": " + err, locLine, locCol);
+    }
 
     // если методов не указано — по умолчанию все три (реализуем на Этапе 7)
     if (loc.allow_methods.empty()) {
@@ -215,6 +444,10 @@ void Parser::parseLocation(ServerConfig& srv) {
         loc.allow_methods.push_back("POST");
         loc.allow_methods.push_back("DELETE");
     }
+    std::string badMethod;
+    if (!compileMethodMask(loc.allow_methods, loc.allow_mask, badMethod))
+        throw ConfigError("unknown method in allow_methods: " + badMethod, cur.line, cur.col);
+    loc.allow_header = allowHeaderValue(loc.allow_mask);
 
     srv.locations.push_back(loc);
 }
@@ -23,14 +23,14 @@ namespace ws
 
 	int App::run(const std::string &configPath)
 	{
-		ws::Log::info(std::string(WEBSERV_NAME) + " " + WEBSERV_VERSION + " starting…");
+		WS_LOG_INFO(std::string(WEBSERV_NAME) + " " + WEBSERV_VERSION + " starting…");
 
 		if (!fileExists(configPath))
 		{
-			ws::Log::error("Config not found: " + configPath);
+			WS_LOG_ERROR("Config not found: " + configPath);
 			return 1;
 		}
-		ws::Log::info("Using config: " + configPath);
+		WS_LOG_INFO("Using config: " + configPath);
 
 		std::ifstream ifs(configPath.c_str());
 		std::stringstream buf;
@@ -42,11 +42,14 @@ namespace ws
 			ws::Lexer lx(text);
 			ws::Parser p(lx);
 			_cfg = p.parse();
-			ws::Log::info("Parsed servers: " + std::string(_cfg.servers.empty() ? "0" : "OK"));
+			ws::Log::Level lvl = ws::Log::INFO;
+			ws::Log::levelFromName(_cfg.error_log, lvl);
+			ws::Log::setLevel(lvl);
+			WS_LOG_INFO("Parsed servers: " + std::string(_cfg.servers.empty() ? "0" : "OK"));
 			ws::EventLoop loop;
 			if (!loop.initFromConfig(_cfg))
 			{
-				ws::Log::error("Network init failed");
+				WS_LOG_ERROR("Network init failed");
 				return 3;
 			}
 			return loop.run();
@@ -55,11 +58,11 @@ namespace ws
 		{
 			std::ostringstream oss;
 			oss << "Config error at " << e.line << ":" << e.col << " - " << e.what();
-			ws::Log::error(oss.str());
+			WS_LOG_ERROR(oss.str());
 			return 2;
 		}
 
-		ws::Log::info("Stage 1 OK (config parsed). Exiting.");
+		WS_LOG_INFO("Stage 1 OK (config parsed). Exiting.");
 		return 0;
 	}
 
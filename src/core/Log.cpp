@@ -1,9 +1,12 @@
 #include "webserv/Log.hpp"
-#include <iostream>
+#include <cstdio>
 #include <ctime>
+#include <unistd.h>
 
 namespace ws {
 
+Log::Level Log::_level = Log::INFO;
+
 const char* Log::levelToStr(Log::Level lvl) {
     switch (lvl) {
         case DEBUG: return "DEBUG";
@@ -14,23 +17,50 @@ const char* Log::levelToStr(Log::Level lvl) {
     return "INFO ";
 }
 
-static std::string nowIso8601() {
+bool Log::levelFromName(const std::string &name, Level &lvl) {
+    if (name == "debug") lvl = DEBUG;
+    else if (name == "info" || name == "notice") lvl = INFO;
+    else if (name == "warn") lvl = WARN;
+    else if (name == "error" || name == "crit" || name == "alert" || name == "emerg") lvl = ERROR;
+    else return false;
+    return true;
+}
+
+std::string Log::num(long long v) {
+    char buf[24];
+    std::snprintf(buf, sizeof(buf), "%lld", v);
+    return buf;
+}
+
+// метка времени своя у каждого потока (aio, access_log) и форматируется раз в секунду
+static __thread std::time_t t_stampSec = (std::time_t)-1;
+static __thread char t_stamp[32];
+
+static const char* nowIso8601() {
     std::time_t t = std::time(0);
-    std::tm tm;
-#if defined(_WIN32)
-    localtime_s(&tm, &t);
-#else
-    localtime_r(&t, &tm);
-#endif
-    char buf[32];
-    std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm);
-    return std::string(buf);
+    if (t != t_stampSec) {
+        std::tm tm;
+        localtime_r(&t, &tm);
+        std::strftime(t_stamp, sizeof(t_stamp), "%Y-%m-%dT%H:%M:%S", &tm);
+        t_stampSec = t;
+    }
+    return t_stamp;
 }
 
 void Log::write(Level lvl, const std::string &msg) {
-    std::cerr << "[" << nowIso8601() << "] "
-              << levelToStr(lvl) << " "
-              << msg << std::endl;
+    if (!enabled(lvl)) return;
+    // строка целиком одним write(): без flush на каждую и без перемешивания между потоками
+    std::string line;
+    line.reserve(msg.size() + 40);
+    line += '[';
+    line += nowIso8601();
+    line += "] ";
+    line += levelToStr(lvl);
+    line += ' ';
+    line += msg;
+    line += '\n';
+    ssize_t r = ::write(2, line.data(), line.size());
+    (void)r;
 }
 
 void Log::info(const std::string &msg)  { write(INFO,  msg); }
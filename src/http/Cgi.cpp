@@ -4,20 +4,13 @@
 #include <vector>
 #include <string>
 #include <cstdlib>
-#include <cstring>
-#include <unistd.h>
-#include <sys/types.h>
-#include <sys/wait.h>
 #include <fcntl.h>
+#include <spawn.h>
+#include <unistd.h>
 
 namespace ws
 {
 
-	static bool endsWith(const std::string &s, const std::string &suf)
-	{
-		return s.size() >= suf.size() && s.compare(s.size() - suf.size(), suf.size(), suf) == 0;
-	}
-
 	// сопоставление HTTP-пути -> относительный путь в ФС (как в статику)
 	static bool mapToFsRel(const ServerConfig &srv, const Location *loc,
 						   const std::string &reqPath, std::string &fsRelOut)
@@ -65,22 +58,41 @@ namespace ws
 		return true;
 	}
 
-	// разбор CGI-вывода: заголовки (до пустой строки) + тело
-	static void parseCgiResponse(const std::string &out, CgiResult &res)
+	bool CgiHandler::headerEnd(const std::string &out, size_t &hdrLen, size_t &bodyOff)
 	{
-		// 1) Найти разделитель заголовков и тела: сначала CRLFCRLF, потом LFLF
-		size_t sep = out.find("\r\n\r\n");
-		size_t off = 4;
-		if (sep == std::string::npos)
+		// разделитель заголовков и тела: CRLFCRLF или LFLF — что встретится раньше
+		size_t crlf = out.find("\r\n\r\n");
+		size_t lf = out.find("\n\n");
+		if (crlf == std::string::npos && lf == std::string::npos)
+			return false;
+		if (lf == std::string::npos || (crlf != std::string::npos && crlf < lf))
 		{
-			sep = out.find("\n\n");
-			off = 2;
+			hdrLen = crlf;
+			bodyOff = crlf + 4;
 		}
+		else
+		{
+			hdrLen = lf;
+			bodyOff = lf + 2;
+		}
+		return true;
+	}
 
-		std::string hdrs = (sep == std::string::npos) ? out : out.substr(0, sep);
-		std::string body = (sep == std::string::npos) ? std::string() : out.substr(sep + off);
+	void CgiHandler::parseOutput(const std::string &out, CgiResult &res)
+	{
+		size_t hdrLen = 0, bodyOff = 0;
+		if (!headerEnd(out, hdrLen, bodyOff))
+		{
+			parseHeaders(out, res);
+			return;
+		}
+		parseHeaders(out.substr(0, hdrLen), res);
+		res.body = out.substr(bodyOff);
+	}
 
-		// 2) Разбить заголовки по строкам: поддерживаем и CRLF, и LF
+	void CgiHandler::parseHeaders(const std::string &hdrs, CgiResult &res)
+	{
+		// 1) Разбить заголовки по строкам: поддерживаем и CRLF, и LF
 		size_t pos = 0;
 		while (pos < hdrs.size())
 		{
@@ -101,12 +113,13 @@ namespace ws
 			if (line.empty())
 				continue;
 
-			// 3) Разобрать "Key: value"
+			// 2) Разобрать "Key: value"
 			size_t c = line.find(':');
 			if (c == std::string::npos)
 				continue;
 
-			std::string k = line.substr(0, c);
+			std::string name = line.substr(0, c);
+			std::string k = name;
 			for (size_t i = 0; i < k.size(); ++i)
 			{
 				char ch = k[i];
@@ -132,180 +145,192 @@ namespace ws
 				else
 					res.reason = "OK";
 			}
+			else if (k == "x-accel-redirect")
+				res.accelRedirect = v;
+			else if (k == "x-sendfile")
+				res.sendfile = v;
 			else
 			{
 				res.headers[k] = v;
+				// framing и соединение — наши; Content-Type пишется отдельно
+				if (k != "content-type" && k != "content-length" && k != "transfer-encoding" &&
+					k != "connection" && k != "keep-alive" && k != "date" && k != "server")
+					res.extraHeaders += name + ": " + v + "\r\n";
 			}
 		}
 
-		// 4) Если CGI не задал Content-Type — поставим дефолт
+		// 3) Если CGI не задал Content-Type — поставим дефолт
 		if (res.headers.find("content-type") == res.headers.end())
 		{
 			res.headers["content-type"] = "text/html; charset=utf-8";
 		}
+	}
 
-		res.body = body;
+	// одна переменная в блок окружения "K=V\0K=V\0..."
+	static void putEnv(std::string &block, const char *k, const char *v, size_t vlen)
+	{
+		block += k;
+		block += '=';
+		block.append(v, vlen);
+		block += '\0';
 	}
 
-	static void setEnvKV(std::vector<std::string> &envs, const std::string &k, const std::string &v)
+	static void putEnv(std::string &block, const char *k, const std::string &v)
 	{
-		std::string kv = k + "=" + v;
-		envs.push_back(kv);
+		putEnv(block, k, v.data(), v.size());
 	}
 
-	static char **buildCStringArray(const std::vector<std::string> &vec, std::vector<char *> &store)
+	// CWD сервера не меняется: узнаём один раз
+	static const std::string &serverCwd()
 	{
-		store.clear();
-		for (size_t i = 0; i < vec.size(); ++i)
-			store.push_back(const_cast<char *>(vec[i].c_str()));
-		store.push_back(NULL);
-		return &store[0];
+		static std::string cwd;
+		if (cwd.empty())
+		{
+			char buf[4096];
+			cwd = ::getcwd(buf, sizeof(buf)) ? buf : ".";
+		}
+		return cwd;
 	}
 
-	bool CgiHandler::handle(const ServerConfig &srv,
-							const Location *loc,
-							const HttpRequest &req,
-							CgiResult &out)
+	std::string CgiHandler::envTemplate(const ServerConfig &srv, const Location &)
 	{
-		// location должен объявлять cgi_ext и cgi_bin
-		if (!(loc && !loc->cgi_ext.empty() && !loc->cgi_bin.empty()))
+		std::string block;
+		putEnv(block, "GATEWAY_INTERFACE", "CGI/1.1");
+		putEnv(block, "SERVER_SOFTWARE", "webserv-dev");
+		putEnv(block, "SERVER_NAME", srv.server_names.empty() ? srv.host : srv.server_names[0]);
+		std::string port;
+		for (int p = srv.port; p > 0; p /= 10)
+			port.insert(port.begin(), char('0' + p % 10));
+		putEnv(block, "SERVER_PORT", port);
+		return block;
+	}
+
+	bool CgiHandler::matches(const Location *loc, const HttpRequest &req)
+	{
+		if (loc && !loc->proxy_pass.empty())
+			return true; // proxy_pass: всё в location уходит на backend
+		if (!(loc && (!loc->cgi_bin.empty() || !loc->fastcgi_pass.empty())))
 			return false;
+		if (loc->cgi_ext.empty())
+			return loc->match == LOC_REGEX || !loc->fastcgi_pass.empty(); // fastcgi_pass: всё в location
+
+		const std::string &t = req.target;
+		size_t end = t.find('?');
+		if (end == std::string::npos)
+			end = t.size();
+		const std::string &ext = loc->cgi_ext;
+		return end >= ext.size() && t.compare(end - ext.size(), ext.size(), ext) == 0;
+	}
 
-		// расширение совпадает?
+	int CgiHandler::prepare(const ServerConfig &srv,
+							const Location *loc,
+							const HttpRequest &req,
+							CgiLaunch &out)
+	{
 		std::string path = req.target;
 		size_t q = path.find('?');
 		if (q != std::string::npos)
 			path = path.substr(0, q);
-		if (!endsWith(path, loc->cgi_ext))
-			return false;
 
 		// мапим в относительный путь ФС
 		std::string fsRel;
 		if (!mapToFsRel(srv, loc, path, fsRel))
+			return 403;
+
+		// статическая часть собрана при загрузке конфига; дописываем только запрос
+		std::string &env = out.env;
+		env.clear();
+		env.reserve(loc->cgi_env.size() + 256 + req.target.size() * 2 + fsRel.size());
+		env += loc->cgi_env;
+		putEnv(env, "SERVER_PROTOCOL", req.version.empty() ? std::string("HTTP/1.1") : req.version);
+		putEnv(env, "REQUEST_METHOD", req.method);
+		putEnv(env, "SCRIPT_NAME", path);	   // логический путь
+		if (loc->fastcgi_pass.empty())
+			putEnv(env, "SCRIPT_FILENAME", fsRel); // относительный к CWD
+		else
+			putEnv(env, "SCRIPT_FILENAME", serverCwd() + "/" + fsRel); // у FastCGI-сервера свой CWD
+		putEnv(env, "REQUEST_URI", req.target);
+		if (q == std::string::npos)
+			putEnv(env, "QUERY_STRING", "", 0);
+		else
+			putEnv(env, "QUERY_STRING", req.target.data() + q + 1, req.target.size() - q - 1);
+		// CONTENT_LENGTH/TYPE, HOST
 		{
-			out.status = 403;
-			out.reason = "Forbidden";
-			out.body = "403 Forbidden\n";
-			return true;
+			std::map<std::string, std::string>::const_iterator it;
+			it = req.headers.find("content-length");
+			if (it != req.headers.end())
+				putEnv(env, "CONTENT_LENGTH", it->second);
+			it = req.headers.find("content-type");
+			if (it != req.headers.end())
+				putEnv(env, "CONTENT_TYPE", it->second);
+			it = req.headers.find("host");
+			if (it != req.headers.end())
+				putEnv(env, "HTTP_HOST", it->second);
 		}
 
-		// Подготовка пайпов
+		out.bin = loc->cgi_bin;
+		out.script = fsRel;
+		return 0;
+	}
+
+	pid_t CgiHandler::spawn(const CgiLaunch &l, int &stdinFd, int &stdoutFd)
+	{
 		int inPipe[2], outPipe[2];
-		if (pipe(inPipe) != 0 || pipe(outPipe) != 0)
+		if (::pipe(inPipe) != 0)
+			return -1;
+		if (::pipe(outPipe) != 0)
 		{
-			out.status = 500;
-			out.reason = "Internal Server Error";
-			out.body = "500 Internal Server Error\n";
-			return true;
+			::close(inPipe[0]);
+			::close(inPipe[1]);
+			return -1;
 		}
-
-		pid_t pid = fork();
-		if (pid < 0)
+		// все четыре конца — close-on-exec: ребёнку достанутся только 0/1 после dup2,
+		// а наши концы не утекут в скрипты, запущенные позже (иначе не будет EOF)
+		for (int k = 0; k < 2; ++k)
 		{
-			close(inPipe[0]);
-			close(inPipe[1]);
-			close(outPipe[0]);
-			close(outPipe[1]);
-			out.status = 500;
-			out.reason = "Internal Server Error";
-			out.body = "500 Internal Server Error\n";
-			return true;
-		}
-
-		if (pid == 0)
-		{
-			// child
-			(void)dup2(inPipe[0], STDIN_FILENO);
-			(void)dup2(outPipe[1], STDOUT_FILENO);
-			close(inPipe[1]);
-			close(outPipe[0]);
-
-			// env
-			std::vector<std::string> envs;
-			setEnvKV(envs, "GATEWAY_INTERFACE", "CGI/1.1");
-			setEnvKV(envs, "SERVER_SOFTWARE", "webserv-dev");
-			setEnvKV(envs, "SERVER_PROTOCOL", req.version.empty() ? "HTTP/1.1" : req.version);
-			setEnvKV(envs, "REQUEST_METHOD", req.method);
-			setEnvKV(envs, "SCRIPT_NAME", path);	  // логический путь
-			setEnvKV(envs, "SCRIPT_FILENAME", fsRel); // относительный к CWD
-			// QUERY_STRING
-			{
-				const std::string &tgt = req.target;
-				size_t qq = tgt.find('?');
-				setEnvKV(envs, "QUERY_STRING", (qq == std::string::npos) ? "" : tgt.substr(qq + 1));
-			}
-			// CONTENT_LENGTH/TYPE
-			{
-				std::map<std::string, std::string>::const_iterator it;
-				it = req.headers.find("content-length");
-				if (it != req.headers.end())
-					setEnvKV(envs, "CONTENT_LENGTH", it->second);
-				it = req.headers.find("content-type");
-				if (it != req.headers.end())
-					setEnvKV(envs, "CONTENT_TYPE", it->second);
-			}
-			// HOST
-			{
-				std::map<std::string, std::string>::const_iterator it = req.headers.find("host");
-				if (it != req.headers.end())
-					setEnvKV(envs, "HTTP_HOST", it->second);
-			}
-
-			// argv: [cgi_bin, script]
-			std::vector<std::string> argv;
-			argv.push_back(loc->cgi_bin);
-			argv.push_back(fsRel);
-
-			std::vector<char *> envpStore, argvStore;
-			char **envp = buildCStringArray(envs, envpStore);
-			char **argvp = buildCStringArray(argv, argvStore);
-
-			execve(loc->cgi_bin.c_str(), argvp, envp);
-			_exit(127); // если execve не удался
+			fcntl(inPipe[k], F_SETFD, FD_CLOEXEC);
+			fcntl(outPipe[k], F_SETFD, FD_CLOEXEC);
 		}
 
-		// parent
-		close(inPipe[0]);  // нам нужен write в stdin ребёнка
-		close(outPipe[1]); // нам нужен read из stdout ребёнка
-
-		// тело запроса -> stdin CGI
-		if (!req.body.empty())
+		// argv/envp — указатели внутрь l: ничего не копируем
+		char *argv[3];
+		argv[0] = const_cast<char *>(l.bin.c_str());
+		argv[1] = const_cast<char *>(l.script.c_str());
+		argv[2] = NULL;
+		std::vector<char *> envp;
+		envp.reserve(16);
+		for (size_t a = 0; a < l.env.size();)
 		{
-			const char *p = req.body.data();
-			size_t left = req.body.size();
-			while (left)
-			{
-				ssize_t n = write(inPipe[1], p, left);
-				if (n <= 0)
-					break;
-				p += n;
-				left -= (size_t)n;
-			}
+			envp.push_back(const_cast<char *>(l.env.data() + a));
+			a = l.env.find('\0', a);
+			if (a == std::string::npos)
+				break;
+			++a;
 		}
-		close(inPipe[1]);
-
-		// читаем stdout CGI
-		std::string cgiOut;
-		char buf[4096];
-		for (;;)
+		envp.push_back(NULL);
+
+		posix_spawn_file_actions_t fa;
+		posix_spawn_file_actions_init(&fa);
+		posix_spawn_file_actions_adddup2(&fa, inPipe[0], STDIN_FILENO);
+		posix_spawn_file_actions_adddup2(&fa, outPipe[1], STDOUT_FILENO);
+
+		// posix_spawn не копирует таблицы страниц родителя (vfork-подобный clone),
+		// так что цена запуска не растёт вместе с кэшами сервера
+		pid_t pid = -1;
+		int rc = posix_spawn(&pid, l.bin.c_str(), &fa, NULL, argv, &envp[0]);
+		posix_spawn_file_actions_destroy(&fa);
+
+		::close(inPipe[0]);
+		::close(outPipe[1]);
+		if (rc != 0)
 		{
-			ssize_t n = read(outPipe[0], buf, sizeof(buf));
-			if (n > 0)
-			{
-				cgiOut.append(buf, (size_t)n);
-				continue;
-			}
-			break;
+			::close(inPipe[1]);
+			::close(outPipe[0]);
+			return -1;
 		}
-		close(outPipe[0]);
-
-		int status = 0;
-		(void)waitpid(pid, &status, 0);
-
-		// парсим CGI-ответ (заголовки + тело)
-		parseCgiResponse(cgiOut, out);
-
-		return true;
+		stdinFd = inPipe[1];
+		stdoutFd = outPipe[0];
+		return pid;
 	}
 
 } // namespace ws
\ No newline at end of file
@@ -0,0 +1,191 @@
+#include "webserv/http/FastCgi.hpp"
+#include <cstdlib>
+#include <cstring>
+
+namespace ws
+{
+
+	static const unsigned char FCGI_VERSION_1 = 1;
+	static const unsigned char FCGI_RESPONDER = 1;
+	static const unsigned char FCGI_KEEP_CONN = 1;
+	static const size_t FCGI_MAX_CONTENT = 65535;
+
+	bool fcgiParseAddress(const std::string &spec, FcgiAddress &out, std::string &err)
+	{
+		out = FcgiAddress();
+		if (spec.compare(0, 5, "unix:") == 0)
+		{
+			out.isUnix = true;
+			out.path = spec.substr(5);
+			if (out.path.empty() || out.path[0] != '/')
+			{
+				err = "fastcgi_pass: unix socket path must be absolute";
+				return false;
+			}
+			return true;
+		}
+		size_t colon = spec.rfind(':');
+		if (colon == std::string::npos || colon == 0 || colon + 1 == spec.size())
+		{
+			err = "fastcgi_pass expects unix:/path or host:port";
+			return false;
+		}
+		out.host = spec.substr(0, colon);
+		char *end = 0;
+		long p = std::strtol(spec.c_str() + colon + 1, &end, 10);
+		if (*end != '\0' || p <= 0 || p > 65535)
+		{
+			err = "fastcgi_pass: invalid port";
+			return false;
+		}
+		out.port = (int)p;
+		return true;
+	}
+
+	static void putHeader(std::string &out, int type, unsigned id, size_t len, size_t pad)
+	{
+		char h[8];
+		h[0] = (char)FCGI_VERSION_1;
+		h[1] = (char)type;
+		h[2] = (char)((id >> 8) & 0xff);
+		h[3] = (char)(id & 0xff);
+		h[4] = (char)((len >> 8) & 0xff);
+		h[5] = (char)(len & 0xff);
+		h[6] = (char)pad;
+		h[7] = 0;
+		out.append(h, 8);
+	}
+
+	void fcgiAppendRecord(std::string &out, int type, unsigned id, const char *data, size_t n)
+	{
+		do
+		{
+			size_t len = n < FCGI_MAX_CONTENT ? n : FCGI_MAX_CONTENT;
+			size_t pad = (8 - (len & 7)) & 7; // выравнивание на 8 байт
+			putHeader(out, type, id, len, pad);
+			out.append(data, len);
+			out.append(pad, '\0');
+			data += len;
+			n -= len;
+		} while (n);
+	}
+
+	void fcgiAppendBeginRequest(std::string &out, unsigned id, bool keepConn)
+	{
+		char body[8];
+		std::memset(body, 0, sizeof(body));
+		body[1] = (char)FCGI_RESPONDER;
+		body[2] = (char)(keepConn ? FCGI_KEEP_CONN : 0);
+		putHeader(out, FCGI_BEGIN_REQUEST, id, sizeof(body), 0);
+		out.append(body, sizeof(body));
+	}
+
+	static void putLength(std::string &out, size_t n)
+	{
+		if (n < 128)
+		{
+			out += (char)n;
+			return;
+		}
+		out += (char)(((n >> 24) & 0x7f) | 0x80);
+		out += (char)((n >> 16) & 0xff);
+		out += (char)((n >> 8) & 0xff);
+		out += (char)(n & 0xff);
+	}
+
+	void fcgiAppendPair(std::string &out, const char *name, size_t nlen, const char *val, size_t vlen)
+	{
+		putLength(out, nlen);
+		putLength(out, vlen);
+		out.append(name, nlen);
+		out.append(val, vlen);
+	}
+
+	void fcgiEnvToParams(const std::string &env, std::string &params)
+	{
+		size_t a = 0;
+		while (a < env.size())
+		{
+			size_t end = env.find('\0', a);
+			if (end == std::string::npos)
+				end = env.size();
+			size_t eq = env.find('=', a);
+			if (eq != std::string::npos && eq < end)
+				fcgiAppendPair(params, env.data() + a, eq - a, env.data() + eq + 1, end - eq - 1);
+			a = end + 1;
+		}
+	}
+
+	static bool getLength(const std::string &in, size_t &off, size_t &n)
+	{
+		if (off >= in.size())
+			return false;
+		unsigned char b = (unsigned char)in[off];
+		if (!(b & 0x80))
+		{
+			n = b;
+			off += 1;
+			return true;
+		}
+		if (off + 4 > in.size())
+			return false;
+		n = ((size_t)(b & 0x7f) << 24) | ((size_t)(unsigned char)in[off + 1] << 16) |
+			((size_t)(unsigned char)in[off + 2] << 8) | (size_t)(unsigned char)in[off + 3];
+		off += 4;
+		return true;
+	}
+
+	bool fcgiParsePairs(const std::string &in, std::map<std::string, std::string> &out)
+	{
+		size_t off = 0;
+		while (off < in.size())
+		{
+			size_t nl = 0, vl = 0;
+			if (!getLength(in, off, nl) || !getLength(in, off, vl))
+				return false;
+			if (in.size() - off < nl + vl)
+				return false;
+			out[in.substr(off, nl)] = in.substr(off + nl, vl);
+			off += nl + vl;
+		}
+		return true;
+	}
+
+	void FcgiReader::feed(const char *data, size_t n)
+	{
+		if (_off == _buf.size())
+		{
+			_buf.clear();
+			_off = 0;
+		}
+		_buf.append(data, n);
+	}
+
+	bool FcgiReader::next(FcgiRecord &rec)
+	{
+		if (_buf.size() - _off < 8)
+			return false;
+		const unsigned char *h = reinterpret_cast<const unsigned char *>(_buf.data() + _off);
+		size_t len = ((size_t)h[4] << 8) | h[5];
+		size_t pad = h[6];
+		if (_buf.size() - _off < 8 + len + pad)
+			return false;
+		rec.type = h[1];
+		rec.id = ((unsigned)h[2] << 8) | h[3];
+		rec.content.assign(_buf, _off + 8, len);
+		_off += 8 + len + pad;
+		if (_off > 65536 && _off * 2 > _buf.size())
+		{
+			_buf.erase(0, _off); // не даём буферу расти бесконечно
+			_off = 0;
+		}
+		return true;
+	}
+
+	void FcgiReader::reset()
+	{
+		_buf.clear();
+		_off = 0;
+	}
+
+} // namespace ws
@@ -0,0 +1,95 @@
+#include "webserv/http/Method.hpp"
+#include <cstring>
+
+namespace ws
+{
+
+	Method methodFromToken(const char *s, size_t n)
+	{
+		// сначала по длине, потом одно сравнение — без временных строк
+		switch (n)
+		{
+		case 3:
+			if (std::memcmp(s, "GET", 3) == 0)
+				return M_GET;
+			if (std::memcmp(s, "PUT", 3) == 0)
+				return M_PUT;
+			break;
+		case 4:
+			if (std::memcmp(s, "HEAD", 4) == 0)
+				return M_HEAD;
+			if (std::memcmp(s, "POST", 4) == 0)
+				return M_POST;
+			break;
+		case 5:
+			if (std::memcmp(s, "PATCH", 5) == 0)
+				return M_PATCH;
+			break;
+		case 6:
+			if (std::memcmp(s, "DELETE", 6) == 0)
+				return M_DELETE;
+			break;
+		}
+		return M_UNKNOWN;
+	}
+
+	const char *methodName(Method m)
+	{
+		switch (m)
+		{
+		case M_GET:
+			return "GET";
+		case M_HEAD:
+			return "HEAD";
+		case M_POST:
+			return "POST";
+		case M_DELETE:
+			return "DELETE";
+		case M_PUT:
+			return "PUT";
+		case M_PATCH:
+			return "PATCH";
+		case M_UNKNOWN:
+			break;
+		}
+		return "";
+	}
+
+	bool compileMethodMask(const std::vector<std::string> &names,
+						   unsigned &mask, std::string &badName)
+	{
+		mask = 0;
+		for (size_t i = 0; i < names.size(); ++i)
+		{
+			Method m = methodFromToken(names[i].data(), names[i].size());
+			if (m == M_UNKNOWN)
+			{
+				badName = names[i];
+				return false;
+			}
+			mask |= (unsigned)m;
+		}
+		// HEAD следует за GET, как и раньше в isAllowed()
+		mask &= ~(unsigned)M_HEAD;
+		if (mask & M_GET)
+			mask |= M_HEAD;
+		return true;
+	}
+
+	std::string allowHeaderValue(unsigned mask)
+	{
+		// порядок фиксированный; нереализованные методы не рекламируем
+		static const Method order[] = {M_GET, M_POST, M_DELETE, M_PATCH, M_HEAD};
+		std::string allow;
+		for (size_t i = 0; i < sizeof(order) / sizeof(order[0]); ++i)
+		{
+			if (!(mask & order[i]))
+				continue;
+			if (!allow.empty())
+				allow += ", ";
+			allow += methodName(order[i]);
+		}
+		return allow;
+	}
+
+} // namespace ws
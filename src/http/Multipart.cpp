@@ -0,0 +1,256 @@
+#include "webserv/http/Multipart.hpp"
+#include <cstring>
+
+namespace ws
+{
+
+	static std::string lower(const std::string &s)
+	{
+		std::string r(s);
+		for (size_t i = 0; i < r.size(); ++i)
+			if (r[i] >= 'A' && r[i] <= 'Z')
+				r[i] = char(r[i] - 'A' + 'a');
+		return r;
+	}
+
+	static std::string trim(const std::string &s)
+	{
+		size_t b = 0, e = s.size();
+		while (b < e && (s[b] == ' ' || s[b] == '\t'))
+			++b;
+		while (e > b && (s[e - 1] == ' ' || s[e - 1] == '\t'))
+			--e;
+		return s.substr(b, e - b);
+	}
+
+	// параметр key=value|"quoted" после первого ';' (Content-Type, Content-Disposition)
+	static bool headerParam(const std::string &h, const char *key, std::string &out)
+	{
+		size_t i = h.find(';');
+		while (i != std::string::npos && i < h.size())
+		{
+			++i; // ';'
+			while (i < h.size() && (h[i] == ' ' || h[i] == '\t'))
+				++i;
+			size_t k = i;
+			while (i < h.size() && h[i] != '=' && h[i] != ';')
+				++i;
+			std::string name = lower(trim(h.substr(k, i - k)));
+			std::string val;
+			if (i < h.size() && h[i] == '=')
+			{
+				++i;
+				if (i < h.size() && h[i] == '"')
+				{
+					for (++i; i < h.size() && h[i] != '"'; ++i)
+					{
+						if (h[i] == '\\' && i + 1 < h.size())
+							++i;
+						val += h[i];
+					}
+					if (i < h.size())
+						++i; // закрывающая кавычка
+					while (i < h.size() && h[i] != ';')
+						++i;
+				}
+				else
+				{
+					size_t v = i;
+					while (i < h.size() && h[i] != ';')
+						++i;
+					val = trim(h.substr(v, i - v));
+				}
+			}
+			if (name == key)
+			{
+				out = val;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool multipartBoundary(const std::string &contentType, std::string &boundary)
+	{
+		std::string type = lower(trim(contentType.substr(0, contentType.find(';'))));
+		if (type != "multipart/form-data")
+			return false;
+		if (!headerParam(contentType, "boundary", boundary))
+			return false;
+		return !boundary.empty() && boundary.size() <= 70; // RFC 2046
+	}
+
+	MultipartParser::MultipartParser(const std::string &boundary)
+		: _st(PREAMBLE), _delim("\r\n--" + boundary), _buf("\r\n"), _inPart(false)
+	{
+		// тело начинается прямо с "--boundary": CRLF перед ним подставлен в _buf
+		const size_t m = _delim.size();
+		for (size_t c = 0; c < 256; ++c)
+			_skip[c] = m;
+		for (size_t j = 0; j + 1 < m; ++j)
+			_skip[(unsigned char)_delim[j]] = m - 1 - j;
+	}
+
+	size_t MultipartParser::find(const char *hay, size_t n) const
+	{
+		const size_t m = _delim.size();
+		const char *p = _delim.data();
+		const unsigned char last = (unsigned char)p[m - 1];
+		for (size_t i = 0; i + m <= n;)
+		{
+			unsigned char c = (unsigned char)hay[i + m - 1];
+			if (c == last && std::memcmp(hay + i, p, m - 1) == 0)
+				return i;
+			i += _skip[c];
+		}
+		return std::string::npos;
+	}
+
+	bool MultipartParser::parsePartHeaders(const std::string &block, MultipartPart &p) const
+	{
+		p.contentType = "text/plain";
+		size_t pos = 0;
+		while (pos < block.size())
+		{
+			size_t eol = block.find("\r\n", pos);
+			if (eol == std::string::npos)
+				eol = block.size();
+			std::string line = block.substr(pos, eol - pos);
+			pos = eol + 2;
+			size_t c = line.find(':');
+			if (c == std::string::npos)
+				return false;
+			std::string k = lower(trim(line.substr(0, c)));
+			std::string v = trim(line.substr(c + 1));
+			if (k == "content-disposition")
+			{
+				headerParam(v, "name", p.name);
+				headerParam(v, "filename", p.filename);
+			}
+			else if (k == "content-type")
+				p.contentType = v;
+		}
+		return true;
+	}
+
+	bool MultipartParser::feed(const char *data, size_t n, MultipartSink &sink)
+	{
+		if (_st == FAILED)
+			return false;
+		if (_st == EPILOGUE)
+			return true; // эпилог игнорируем
+		_buf.append(data, n);
+
+		size_t off = 0;
+		bool more = true;
+		while (more)
+		{
+			switch (_st)
+			{
+			case PREAMBLE:
+			case BODY:
+			{
+				const size_t avail = _buf.size() - off;
+				const size_t at = find(_buf.data() + off, avail);
+				if (at == std::string::npos)
+				{
+					// последние len-1 байт могут оказаться началом разделителя — придержим
+					const size_t keep = _delim.size() - 1;
+					const size_t emit = avail > keep ? avail - keep : 0;
+					if (_st == BODY && emit && !sink.partData(_buf.data() + off, emit))
+						_st = FAILED;
+					off += emit;
+					more = false;
+					break;
+				}
+				if (_st == BODY)
+				{
+					if ((at && !sink.partData(_buf.data() + off, at)) || !sink.partEnd())
+					{
+						_st = FAILED;
+						break;
+					}
+					_inPart = false;
+				}
+				off += at + _delim.size();
+				_st = DELIMITER;
+				break;
+			}
+			case DELIMITER:
+			{
+				// "--" — последний; иначе (после необязательных пробелов) CRLF и часть
+				size_t i = off;
+				if (_buf.size() - i < 2)
+				{
+					more = false;
+					break;
+				}
+				if (_buf[i] == '-' && _buf[i + 1] == '-')
+				{
+					off = _buf.size();
+					_st = EPILOGUE;
+					break;
+				}
+				while (i < _buf.size() && (_buf[i] == ' ' || _buf[i] == '\t'))
+					++i;
+				if (_buf.size() - i < 2)
+				{
+					more = false;
+					break;
+				}
+				if (_buf[i] != '\r' || _buf[i + 1] != '\n')
+				{
+					_st = FAILED;
+					break;
+				}
+				off = i + 2;
+				_st = HEADERS;
+				break;
+			}
+			case HEADERS:
+			{
+				size_t end;
+				size_t skip;
+				if (_buf.compare(off, 2, "\r\n") == 0)
+				{
+					end = off; // часть без заголовков
+					skip = 2;
+				}
+				else
+				{
+					end = _buf.find("\r\n\r\n", off);
+					skip = 4;
+				}
+				if (end == std::string::npos)
+				{
+					if (_buf.size() - off > MAX_PART_HEADERS)
+						_st = FAILED;
+					more = false;
+					break;
+				}
+				MultipartPart p;
+				if (!parsePartHeaders(_buf.substr(off, end - off), p) || !sink.partBegin(p))
+				{
+					_st = FAILED;
+					break;
+				}
+				_inPart = true;
+				off = end + skip;
+				_st = BODY;
+				break;
+			}
+			case EPILOGUE:
+			case FAILED:
+				more = false;
+				break;
+			}
+		}
+		if (_st == FAILED)
+		{
+			std::string().swap(_buf);
+			return false;
+		}
+		_buf.erase(0, off);
+		return true;
+	}
+}
@@ -27,10 +27,11 @@ namespace ws
 	HttpParser::HttpParser()
 		: maxRequestLine(8192),
 		  maxHeaderBytes(65536),
-		  maxBodyBytes(10 * 1024 * 1024),
+		  maxBodyBytes(DEFAULT_MAX_BODY),
 		  _st(S_REQ_LINE),
 		  /* _hdrEnd(0), */
-		  _needBody(0)
+		  _needBody(0),
+		  _bodySeen(0)
 	{
 	}
 
@@ -46,6 +47,7 @@ namespace ws
 		size_t a = 0, b = line.find(' ');
 		if (b == std::string::npos)
 			return false;
+		_req.method_id = methodFromToken(line.data() + a, b - a);
 		_req.method = line.substr(a, b - a);
 
 		a = b + 1;
@@ -67,7 +69,7 @@ namespace ws
 			return false;
 
 		// допустимые методы
-		if (_req.method != "GET" && _req.method != "POST" && _req.method != "DELETE" && _req.method != "HEAD" && _req.method != "PUT")
+		if (_req.method_id == M_UNKNOWN)
 			return false;
 
 		return true;
@@ -143,6 +145,8 @@ namespace ws
 				if (te != "chunked")
 					return NOT_IMPLEMENTED; // другие TE не поддерживаем
 				_st = S_BODY_CHUNKED;
+				out = _req;
+				return HEADERS;
 			}
 			else if (!cl.empty())
 			{
@@ -151,8 +155,7 @@ namespace ws
 				if (endp == cl.c_str() || *endp != '\0')
 					return BAD_REQUEST;
 				_needBody = (size_t)v;
-				if (_needBody > maxBodyBytes)
-					return ENTITY_TOO_LARGE;
+				// с лимитом сверяет setBodyLimit() или начало тела ниже
 				if (_needBody == 0)
 				{
 					_st = S_DONE;
@@ -160,10 +163,12 @@ namespace ws
 					return OK;
 				}
 				_st = S_BODY_IDENTITY;
+				out = _req;
+				return HEADERS;
 			}
 			else
 			{
-				if (_req.method == "POST")
+				if (_req.method_id == M_POST)
 					return LENGTH_REQUIRED; // для POST нужен CL
 				_st = S_DONE;
 				out = _req;
@@ -174,6 +179,8 @@ namespace ws
 		// 3) BODY: Content-Length
 		if (_st == S_BODY_IDENTITY)
 		{
+			if (_needBody > maxBodyBytes)
+				return ENTITY_TOO_LARGE;
 			if (_buf.size() < _needBody)
 				return NEED_MORE;
 			_req.body.assign(_buf.data(), _needBody);
@@ -192,10 +199,11 @@ namespace ws
 			_req.body.append(outBody);
 			_buf.erase(0, consumed);
 
-			if (!done)
-				return NEED_MORE;
+			// по мере прихода, а не после последнего чанка
 			if (_req.body.size() > maxBodyBytes)
 				return ENTITY_TOO_LARGE;
+			if (!done)
+				return NEED_MORE;
 			_st = S_DONE;
 			out = _req;
 			return OK;
@@ -210,13 +218,73 @@ namespace ws
 
 		return NEED_MORE;
 	}
+	HttpParser::Result HttpParser::readBody(std::string &chunk)
+	{
+		if (_st == S_BODY_IDENTITY)
+		{
+			size_t take = _buf.size() < _needBody ? _buf.size() : _needBody;
+			chunk.append(_buf.data(), take);
+			_buf.erase(0, take);
+			_needBody -= take;
+			if (_needBody)
+				return NEED_MORE;
+			_st = S_DONE;
+			return OK;
+		}
+		if (_st == S_BODY_CHUNKED)
+		{
+			size_t consumed = 0;
+			size_t before = chunk.size();
+			bool done = _chunked.feed(_buf, consumed, chunk);
+			_buf.erase(0, consumed);
+			_bodySeen += chunk.size() - before;
+			if (_bodySeen > maxBodyBytes)
+				return ENTITY_TOO_LARGE;
+			if (!done)
+				return NEED_MORE;
+			_st = S_DONE;
+			return OK;
+		}
+		return _st == S_DONE ? OK : NEED_MORE;
+	}
+
+	size_t HttpParser::rawBodyLeft() const
+	{
+		return (_st == S_BODY_IDENTITY && _buf.empty()) ? _needBody : 0;
+	}
+
+	void HttpParser::skipRawBody(size_t n)
+	{
+		if (_st != S_BODY_IDENTITY)
+			return;
+		_needBody -= n < _needBody ? n : _needBody;
+		if (!_needBody)
+			_st = S_DONE;
+	}
+
+	bool HttpParser::setBodyLimit(size_t n)
+	{
+		maxBodyBytes = n;
+		return !(_st == S_BODY_IDENTITY && _needBody > n);
+	}
+
 	void HttpParser::reset()
 	{
 		_buf.clear();
 		_req = HttpRequest();
 		_st = S_REQ_LINE;
 		_needBody = 0;
+		_bodySeen = 0;
+		maxBodyBytes = DEFAULT_MAX_BODY;
 		_chunked = ChunkedDecoder(); // если тип имеет дефолтный конструктор
 	}
 
+	void HttpParser::nextRequest()
+	{
+		std::string rest;
+		rest.swap(_buf);
+		reset();
+		_buf.swap(rest);
+	}
+
 } // namespace ws
\ No newline at end of file
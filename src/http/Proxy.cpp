@@ -0,0 +1,366 @@
+#include "webserv/http/Proxy.hpp"
+
+#include <cstdlib>
+#include <vector>
+
+namespace ws
+{
+
+	static const size_t MAX_HEAD = 65536; // заголовки ответа upstream
+	static const size_t MAX_LINE = 4096;  // строка размера чанка / трейлера
+
+	static std::string lower(const std::string &s)
+	{
+		std::string r = s;
+		for (size_t i = 0; i < r.size(); ++i)
+			if (r[i] >= 'A' && r[i] <= 'Z')
+				r[i] = (char)(r[i] - 'A' + 'a');
+		return r;
+	}
+
+	static std::string trim(const std::string &s)
+	{
+		size_t b = s.find_first_not_of(" \t");
+		if (b == std::string::npos)
+			return std::string();
+		size_t e = s.find_last_not_of(" \t\r");
+		return s.substr(b, e - b + 1);
+	}
+
+	// заголовки одного соединения (RFC 7230 6.1) — дальше не передаются
+	static bool hopByHop(const std::string &k)
+	{
+		return k == "connection" || k == "keep-alive" || k == "proxy-connection" ||
+			   k == "te" || k == "trailer" || k == "transfer-encoding" || k == "upgrade";
+	}
+
+	// имена из "Connection: a, b" — тоже hop-by-hop
+	static void connectionTokens(const std::string &v, std::vector<std::string> &out)
+	{
+		size_t pos = 0;
+		while (pos <= v.size())
+		{
+			size_t c = v.find(',', pos);
+			if (c == std::string::npos)
+				c = v.size();
+			std::string t = lower(trim(v.substr(pos, c - pos)));
+			if (!t.empty())
+				out.push_back(t);
+			pos = c + 1;
+		}
+	}
+
+	static bool listed(const std::vector<std::string> &v, const std::string &k)
+	{
+		for (size_t i = 0; i < v.size(); ++i)
+			if (v[i] == k)
+				return true;
+		return false;
+	}
+
+	bool proxyParseTarget(const std::string &spec, ProxyTarget &out, std::string &err)
+	{
+		out = ProxyTarget();
+		if (spec.compare(0, 7, "http://") != 0)
+		{
+			err = "proxy_pass expects http://host[:port][/uri]";
+			return false;
+		}
+		std::string rest = spec.substr(7);
+		size_t slash = rest.find('/');
+		std::string hp = rest.substr(0, slash);
+		if (slash != std::string::npos)
+			out.uri = rest.substr(slash);
+		size_t colon = hp.rfind(':');
+		out.host = hp.substr(0, colon);
+		if (colon != std::string::npos)
+		{
+			char *end = 0;
+			long p = std::strtol(hp.c_str() + colon + 1, &end, 10);
+			if (colon + 1 == hp.size() || *end != '\0' || p <= 0 || p > 65535)
+			{
+				err = "proxy_pass: invalid port";
+				return false;
+			}
+			out.port = (int)p;
+		}
+		if (out.host.empty())
+		{
+			err = "proxy_pass: missing host";
+			return false;
+		}
+		return true;
+	}
+
+	std::string proxyRequestHead(const HttpRequest &req, const std::string &target,
+								 const std::string &upstreamHost, const std::string &clientAddr,
+								 ProxyBody &body)
+	{
+		std::vector<std::string> drop;
+		connectionTokens(req.getHeader("connection"), drop);
+
+		std::string h;
+		h.reserve(512);
+		h += req.method;
+		h += ' ';
+		h += target;
+		h += " HTTP/1.1\r\n";
+		if (!req.hasHeader("host"))
+			h += "host: " + upstreamHost + "\r\n";
+		for (std::map<std::string, std::string>::const_iterator it = req.headers.begin();
+			 it != req.headers.end(); ++it)
+		{
+			const std::string &k = it->first;
+			// framing тела и 100-continue — наши; XFF пересобираем ниже
+			if (hopByHop(k) || listed(drop, k) || k == "content-length" || k == "expect" ||
+				k == "x-forwarded-for" || k == "x-forwarded-proto")
+				continue;
+			h += k;
+			h += ": ";
+			h += it->second;
+			h += "\r\n";
+		}
+		std::string xff = req.getHeader("x-forwarded-for");
+		if (!clientAddr.empty())
+			xff = xff.empty() ? clientAddr : xff + ", " + clientAddr;
+		if (!xff.empty())
+			h += "x-forwarded-for: " + xff + "\r\n";
+		h += "x-forwarded-proto: http\r\n";
+
+		body = PROXY_BODY_NONE;
+		if (lower(req.getHeader("transfer-encoding")).find("chunked") != std::string::npos)
+		{
+			body = PROXY_BODY_CHUNKED;
+			h += "transfer-encoding: chunked\r\n";
+		}
+		else if (req.hasHeader("content-length"))
+		{
+			body = PROXY_BODY_LENGTH;
+			h += "content-length: " + req.getHeader("content-length") + "\r\n";
+		}
+		h += "connection: keep-alive\r\n\r\n";
+		return h;
+	}
+
+	// ---------------- ProxyResponseReader ----------------
+
+	void ProxyResponseReader::reset(bool headRequest)
+	{
+		_st = S_HEAD;
+		_head = headRequest;
+		_started = false;
+		_keepAlive = false;
+		_buf.clear();
+		_left = 0;
+	}
+
+	bool ProxyResponseReader::takeLine(const char *data, size_t n, size_t &off, std::string &line)
+	{
+		size_t i = off;
+		while (i < n && data[i] != '\n')
+			++i;
+		_buf.append(data + off, i - off);
+		if (i == n)
+		{
+			off = n;
+			return false;
+		}
+		off = i + 1;
+		line.swap(_buf);
+		_buf.clear();
+		if (!line.empty() && line[line.size() - 1] == '\r')
+			line.erase(line.size() - 1);
+		return true;
+	}
+
+	bool ProxyResponseReader::parseHead(const std::string &head, std::string &out)
+	{
+		// "HTTP/1.x SSS reason"
+		size_t eol = head.find("\r\n");
+		std::string sl = head.substr(0, eol);
+		if (sl.size() < 12 || sl.compare(0, 7, "HTTP/1.") != 0 || sl[8] != ' ')
+			return false;
+		int status = std::atoi(sl.c_str() + 9);
+		if (status < 100 || status > 599)
+			return false;
+		if (status == 101)
+			return false; // Upgrade не проксируем
+		if (status < 200)
+			return true;  // 1xx: промежуточный, ждём настоящий
+
+		bool http11 = sl[7] == '1';
+		bool chunked = false, haveLen = false, close = !http11;
+		unsigned long long clen = 0;
+		std::vector<std::string> drop;
+		std::vector<std::pair<std::string, std::string> > keep;
+
+		size_t pos = eol == std::string::npos ? head.size() : eol + 2;
+		while (pos < head.size())
+		{
+			size_t e = head.find("\r\n", pos);
+			if (e == std::string::npos)
+				e = head.size();
+			std::string line = head.substr(pos, e - pos);
+			pos = e + 2;
+			size_t c = line.find(':');
+			if (c == std::string::npos || c == 0)
+				continue;
+			std::string name = line.substr(0, c);
+			std::string k = lower(name);
+			std::string v = trim(line.substr(c + 1));
+			if (k == "content-length")
+			{
+				haveLen = true;
+				clen = std::strtoull(v.c_str(), 0, 10);
+			}
+			else if (k == "transfer-encoding")
+				chunked = lower(v).find("chunked") != std::string::npos;
+			else if (k == "connection")
+			{
+				connectionTokens(v, drop);
+				if (listed(drop, "close"))
+					close = true;
+				else if (listed(drop, "keep-alive"))
+					close = false;
+			}
+			if (hopByHop(k) || k == "content-length" || k == "date" || k == "server")
+				continue;
+			keep.push_back(std::make_pair(k, name + ": " + v + "\r\n"));
+		}
+
+		std::string reason = eol == std::string::npos || sl.size() <= 13 ? std::string() : sl.substr(13);
+		out += "Status: ";
+		out += sl.substr(9, 3);
+		if (!reason.empty())
+		{
+			out += ' ';
+			out += reason;
+		}
+		out += "\r\n";
+		for (size_t i = 0; i < keep.size(); ++i)
+			if (!listed(drop, keep[i].first))
+				out += keep[i].second;
+		out += "\r\n";
+
+		_keepAlive = !close;
+		if (_head || status == 204 || status == 304)
+			_st = DONE;
+		else if (chunked)
+			_st = S_CHUNK_SIZE;
+		else if (haveLen)
+		{
+			_left = clen;
+			_st = clen ? S_LENGTH : DONE;
+		}
+		else
+		{
+			_st = S_CLOSE; // тело до закрытия соединения
+			_keepAlive = false;
+		}
+		return true;
+	}
+
+	bool ProxyResponseReader::feed(const char *data, size_t n, std::string &out)
+	{
+		if (n)
+			_started = true;
+		std::string rest;
+		while (_st == S_HEAD)
+		{
+			_buf.append(data, n);
+			size_t e = _buf.find("\r\n\r\n");
+			if (e == std::string::npos)
+			{
+				if (_buf.size() > MAX_HEAD)
+					_st = FAILED;
+				return _st != FAILED;
+			}
+			rest = _buf.substr(e + 4);
+			std::string head = _buf.substr(0, e + 2);
+			_buf.clear();
+			if (!parseHead(head, out))
+			{
+				_st = FAILED;
+				return false;
+			}
+			data = rest.data();
+			n = rest.size();
+			if (_st == S_HEAD && n == 0)
+				return true;
+		}
+
+		size_t off = 0;
+		std::string line;
+		while (off < n)
+		{
+			switch (_st)
+			{
+			case S_LENGTH:
+			case S_CHUNK_DATA:
+			{
+				size_t take = n - off;
+				if ((unsigned long long)take > _left)
+					take = (size_t)_left;
+				out.append(data + off, take);
+				off += take;
+				_left -= take;
+				if (!_left)
+					_st = _st == S_LENGTH ? DONE : S_CHUNK_CRLF;
+				break;
+			}
+			case S_CLOSE:
+				out.append(data + off, n - off);
+				off = n;
+				break;
+			case S_CHUNK_SIZE:
+				if (!takeLine(data, n, off, line))
+					break;
+				{
+					char *end = 0;
+					_left = std::strtoull(line.c_str(), &end, 16);
+					if (end == line.c_str())
+					{
+						_st = FAILED;
+						return false;
+					}
+					_st = _left ? S_CHUNK_DATA : S_TRAILER;
+				}
+				break;
+			case S_CHUNK_CRLF:
+				if (!takeLine(data, n, off, line))
+					break;
+				if (!line.empty())
+				{
+					_st = FAILED;
+					return false;
+				}
+				_st = S_CHUNK_SIZE;
+				break;
+			case S_TRAILER:
+				if (takeLine(data, n, off, line) && line.empty())
+					_st = DONE;
+				break;
+			case DONE:
+				_keepAlive = false; // лишние байты после ответа: соединение не переиспользуем
+				return true;
+			default:
+				return false;
+			}
+			if (_buf.size() > MAX_LINE)
+			{
+				_st = FAILED;
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void ProxyResponseReader::eof()
+	{
+		_keepAlive = false;
+		if (_st == S_CLOSE)
+			_st = DONE;
+		else if (_st != DONE)
+			_st = FAILED;
+	}
+}
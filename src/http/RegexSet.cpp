@@ -0,0 +1,619 @@
+#include "webserv/http/RegexSet.hpp"
+#include <algorithm>
+#include <map>
+
+namespace ws
+{
+
+	static const size_t MAX_DFA_STATES = 4096;
+	static const int MAX_REPEAT = 255;
+
+	RegexSet::CharSet::CharSet()
+	{
+		for (int i = 0; i < 8; ++i)
+			bits[i] = 0;
+	}
+
+	// ---------------- разбор выражения в AST ----------------
+
+	struct RegexSet::Node
+	{
+		enum Kind
+		{
+			SET,
+			CAT,
+			ALT,
+			REPEAT,
+			EMPTY
+		} kind;
+		CharSet cs;
+		std::vector<Node *> kids;
+		int min, max; // REPEAT; max == -1 — без ограничения
+		Node(Kind k) : kind(k), min(0), max(0) {}
+	};
+
+	struct RegexParse
+	{
+		typedef RegexSet::Node Node;
+		typedef RegexSet::CharSet CharSet;
+
+		const std::string &p;
+		size_t i;
+		bool icase;
+		std::string err;
+		std::vector<Node *> pool;
+
+		RegexParse(const std::string &pat, bool ic) : p(pat), i(0), icase(ic) {}
+		~RegexParse()
+		{
+			for (size_t k = 0; k < pool.size(); ++k)
+				delete pool[k];
+		}
+
+		Node *mk(Node::Kind k)
+		{
+			pool.push_back(new Node(k));
+			return pool.back();
+		}
+		bool fail(const std::string &msg)
+		{
+			if (err.empty())
+				err = msg;
+			return false;
+		}
+		bool more() const { return i < p.size() && err.empty(); }
+
+		void foldCase(CharSet &cs)
+		{
+			if (!icase)
+				return;
+			for (int c = 'a'; c <= 'z'; ++c)
+			{
+				if (cs.has((unsigned char)c))
+					cs.set((unsigned char)(c - 'a' + 'A'));
+				else if (cs.has((unsigned char)(c - 'a' + 'A')))
+					cs.set((unsigned char)c);
+			}
+		}
+
+		// \d \w \s и их отрицания; иначе — литерал
+		static void escapeSet(char e, CharSet &cs)
+		{
+			bool neg = (e == 'D' || e == 'W' || e == 'S');
+			char k = neg ? (char)(e - 'A' + 'a') : e;
+			CharSet tmp;
+			if (k == 'd')
+				for (int c = '0'; c <= '9'; ++c)
+					tmp.set((unsigned char)c);
+			else if (k == 'w')
+			{
+				for (int c = 0; c < 256; ++c)
+					if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_')
+						tmp.set((unsigned char)c);
+			}
+			else if (k == 's')
+			{
+				tmp.set(' ');
+				tmp.set('\t');
+				tmp.set('\r');
+				tmp.set('\n');
+				tmp.set('\f');
+				tmp.set('\v');
+			}
+			else
+			{
+				cs.set((unsigned char)e);
+				return;
+			}
+			for (int c = 0; c < 256; ++c)
+				if (tmp.has((unsigned char)c) != neg)
+					cs.set((unsigned char)c);
+		}
+
+		bool parseClass(CharSet &cs)
+		{
+			// '[' уже съеден
+			bool neg = false;
+			if (i < p.size() && p[i] == '^')
+			{
+				neg = true;
+				++i;
+			}
+			CharSet tmp;
+			bool firstItem = true;
+			for (;;)
+			{
+				if (i >= p.size())
+					return fail("unterminated [class]");
+				char c = p[i];
+				if (c == ']' && !firstItem)
+				{
+					++i;
+					break;
+				}
+				firstItem = false;
+				++i;
+				if (c == '\\')
+				{
+					if (i >= p.size())
+						return fail("trailing '\\' in [class]");
+					escapeSet(p[i++], tmp);
+					continue;
+				}
+				if (i + 1 < p.size() && p[i] == '-' && p[i + 1] != ']')
+				{
+					unsigned char lo = (unsigned char)c, hi = (unsigned char)p[i + 1];
+					if (hi == '\\')
+						return fail("escaped range end is not supported");
+					if (lo > hi)
+						return fail("bad range in [class]");
+					for (int k = lo; k <= hi; ++k)
+						tmp.set((unsigned char)k);
+					i += 2;
+					continue;
+				}
+				tmp.set((unsigned char)c);
+			}
+			foldCase(tmp);
+			for (int c = 0; c < 256; ++c)
+				if (tmp.has((unsigned char)c) != neg)
+					cs.set((unsigned char)c);
+			return true;
+		}
+
+		Node *parseAtom()
+		{
+			char c = p[i++];
+			if (c == '(')
+			{
+				if (i + 1 < p.size() && p[i] == '?' && p[i + 1] == ':')
+					i += 2;
+				Node *n = parseAlt();
+				if (i >= p.size() || p[i] != ')')
+				{
+					fail("missing ')'");
+					return n;
+				}
+				++i;
+				return n;
+			}
+			Node *n = mk(Node::SET);
+			if (c == '[')
+				parseClass(n->cs);
+			else if (c == '.')
+			{
+				for (int k = 0; k < 256; ++k)
+					n->cs.set((unsigned char)k);
+			}
+			else if (c == '\\')
+			{
+				if (i >= p.size())
+					fail("trailing '\\'");
+				else
+				{
+					escapeSet(p[i++], n->cs);
+					foldCase(n->cs);
+				}
+			}
+			else if (c == '*' || c == '+' || c == '?' || c == '{')
+				fail(std::string("nothing to repeat before '") + c + "'");
+			else if (c == ')')
+				fail("unmatched ')'");
+			else if (c == '^' || c == '$')
+				fail("anchors are supported only at the start/end of a top-level branch");
+			else
+			{
+				n->cs.set((unsigned char)c);
+				foldCase(n->cs);
+			}
+			return n;
+		}
+
+		bool parseBound(int &v)
+		{
+			size_t st = i;
+			v = 0;
+			while (i < p.size() && p[i] >= '0' && p[i] <= '9')
+			{
+				v = v * 10 + (p[i++] - '0');
+				if (v > MAX_REPEAT)
+					return fail("repeat count is too large");
+			}
+			return i > st;
+		}
+
+		Node *parseRepeat()
+		{
+			Node *a = parseAtom();
+			while (more())
+			{
+				char c = p[i];
+				int mn, mx;
+				if (c == '*')
+				{
+					mn = 0;
+					mx = -1;
+					++i;
+				}
+				else if (c == '+')
+				{
+					mn = 1;
+					mx = -1;
+					++i;
+				}
+				else if (c == '?')
+				{
+					mn = 0;
+					mx = 1;
+					++i;
+				}
+				else if (c == '{')
+				{
+					++i;
+					if (!parseBound(mn))
+					{
+						fail("bad {m,n} repeat");
+						return a;
+					}
+					mx = mn;
+					if (i < p.size() && p[i] == ',')
+					{
+						++i;
+						if (!parseBound(mx))
+							mx = -1;
+					}
+					if (i >= p.size() || p[i] != '}' || (mx >= 0 && mx < mn))
+					{
+						fail("bad {m,n} repeat");
+						return a;
+					}
+					++i;
+				}
+				else
+					break;
+				Node *r = mk(Node::REPEAT);
+				r->kids.push_back(a);
+				r->min = mn;
+				r->max = mx;
+				a = r;
+			}
+			return a;
+		}
+
+		Node *parseCat()
+		{
+			Node *n = mk(Node::CAT);
+			while (more() && p[i] != '|' && p[i] != ')')
+				n->kids.push_back(parseRepeat());
+			if (n->kids.empty())
+				n->kind = Node::EMPTY;
+			return n;
+		}
+
+		Node *parseAlt()
+		{
+			Node *left = parseCat();
+			if (!more() || p[i] != '|')
+				return left;
+			Node *n = mk(Node::ALT);
+			n->kids.push_back(left);
+			while (more() && p[i] == '|')
+			{
+				++i;
+				n->kids.push_back(parseCat());
+			}
+			return n;
+		}
+	};
+
+	// ---------------- NFA ----------------
+
+	RegexSet::RegexSet() : _count(0), _nclasses(0)
+	{
+		for (int i = 0; i < 256; ++i)
+			_cls[i] = 0;
+	}
+
+	int RegexSet::emit(NKind k, int set, int out, int out2)
+	{
+		NState s;
+		s.kind = k;
+		s.set = set;
+		s.out = out;
+		s.out2 = out2;
+		s.value = -1;
+		_nfa.push_back(s);
+		return (int)_nfa.size() - 1;
+	}
+
+	int RegexSet::build(const Node *n, int next)
+	{
+		switch (n->kind)
+		{
+		case Node::EMPTY:
+			return next;
+		case Node::SET:
+			_sets.push_back(n->cs);
+			return emit(N_CHAR, (int)_sets.size() - 1, next, -1);
+		case Node::CAT:
+			for (size_t k = n->kids.size(); k > 0; --k)
+				next = build(n->kids[k - 1], next);
+			return next;
+		case Node::ALT:
+		{
+			int s = build(n->kids.back(), next);
+			for (size_t k = n->kids.size() - 1; k > 0; --k)
+			{
+				int alt = build(n->kids[k - 1], next);
+				s = emit(N_SPLIT, -1, alt, s);
+			}
+			return s;
+		}
+		case Node::REPEAT:
+		{
+			const Node *c = n->kids[0];
+			int tail;
+			if (n->max < 0)
+			{
+				int loop = emit(N_SPLIT, -1, -1, next);
+				int body = build(c, loop);
+				_nfa[loop].out = body;
+				tail = loop;
+			}
+			else
+			{
+				tail = next;
+				for (int k = n->min; k < n->max; ++k)
+				{
+					int body = build(c, tail);
+					tail = emit(N_SPLIT, -1, body, next);
+				}
+			}
+			for (int k = 0; k < n->min; ++k)
+				tail = build(c, tail);
+			return tail;
+		}
+		}
+		return next;
+	}
+
+	// ветви верхнего уровня: '|' внутри (групп), [классов] и после '\' их не делит
+	static void splitBranches(const std::string &p, std::vector<std::string> &out)
+	{
+		size_t from = 0;
+		int depth = 0;
+		for (size_t i = 0; i < p.size(); ++i)
+		{
+			char c = p[i];
+			if (c == '\\')
+				++i;
+			else if (c == '[')
+			{
+				// как в parseClass: ']' первым (и после '^') — литерал
+				++i;
+				if (i < p.size() && p[i] == '^')
+					++i;
+				for (bool first = true; i < p.size() && (first || p[i] != ']'); ++i, first = false)
+					if (p[i] == '\\')
+						++i;
+			}
+			else if (c == '(')
+				++depth;
+			else if (c == ')')
+				--depth;
+			else if (c == '|' && depth == 0)
+			{
+				out.push_back(p.substr(from, i - from));
+				from = i + 1;
+			}
+		}
+		out.push_back(p.substr(from));
+	}
+
+	bool RegexSet::add(const std::string &pattern, bool icase, int value, std::string &err)
+	{
+		// якоря относятся к своей ветви: "^/a|/b" — это "^/a" или "/b" где угодно
+		std::vector<std::string> bodies;
+		splitBranches(pattern, bodies);
+		std::vector<char> anchorStart(bodies.size(), 0), anchorEnd(bodies.size(), 0);
+		for (size_t k = 0; k < bodies.size(); ++k)
+		{
+			std::string &body = bodies[k];
+			if (!body.empty() && body[0] == '^')
+			{
+				anchorStart[k] = 1;
+				body.erase(0, 1);
+			}
+			if (!body.empty() && body[body.size() - 1] == '$')
+			{
+				// "\$" — литерал, а не якорь
+				size_t bs = 0;
+				for (size_t j = body.size() - 1; j > 0 && body[j - 1] == '\\'; --j)
+					++bs;
+				if (bs % 2 == 0)
+				{
+					anchorEnd[k] = 1;
+					body.erase(body.size() - 1);
+				}
+			}
+		}
+
+		// сначала разбираем все ветви: при ошибке NFA остаётся нетронутым
+		std::string perr;
+		std::vector<RegexParse *> parses;
+		std::vector<Node *> roots;
+		for (size_t k = 0; k < bodies.size() && perr.empty(); ++k)
+		{
+			parses.push_back(new RegexParse(bodies[k], icase));
+			RegexParse &ps = *parses.back();
+			roots.push_back(ps.parseAlt());
+			if (ps.err.empty() && ps.i != bodies[k].size())
+				ps.fail("unexpected ')'");
+			perr = ps.err;
+		}
+		if (perr.empty())
+		{
+			_values.push_back(value);
+			for (size_t k = 0; k < roots.size(); ++k)
+			{
+				int m = emit(N_MATCH, -1, -1, -1);
+				_nfa[m].value = _count; // порядок добавления: меньший выигрывает
+				if (!anchorEnd[k])
+				{
+					// без '$' совпадение «прилипает»: любой хвост остаётся принятым
+					CharSet any;
+					for (int c = 0; c < 256; ++c)
+						any.set((unsigned char)c);
+					_sets.push_back(any);
+					int self = emit(N_CHAR, (int)_sets.size() - 1, m, -1);
+					_nfa[m].out = self;
+				}
+				int start = build(roots[k], m);
+				if (anchorStart[k])
+					_anchored.push_back(start);
+				else
+					_starts.push_back(start);
+			}
+			++_count;
+		}
+		for (size_t k = 0; k < parses.size(); ++k)
+			delete parses[k];
+		if (!perr.empty())
+			err = perr;
+		return perr.empty();
+	}
+
+	// оставляет в наборе только N_CHAR/N_MATCH (eps-состояния не влияют на переходы)
+	void RegexSet::closure(std::vector<int> &set) const
+	{
+		std::vector<int> stack(set);
+		std::vector<char> seen(_nfa.size(), 0);
+		set.clear();
+		while (!stack.empty())
+		{
+			int s = stack.back();
+			stack.pop_back();
+			if (s < 0 || seen[s])
+				continue;
+			seen[s] = 1;
+			const NState &st = _nfa[s];
+			switch (st.kind)
+			{
+			case N_CHAR:
+				set.push_back(s);
+				break;
+			case N_MATCH:
+				set.push_back(s);
+				stack.push_back(st.out);
+				break;
+			case N_SPLIT:
+				stack.push_back(st.out2);
+				stack.push_back(st.out);
+				break;
+			case N_EPS:
+				stack.push_back(st.out);
+				break;
+			}
+		}
+		std::sort(set.begin(), set.end());
+	}
+
+	// ---------------- DFA (построение подмножеств) ----------------
+
+	bool RegexSet::compile(std::string &err)
+	{
+		_trans.clear();
+		_accept.clear();
+		if (_count == 0)
+			return true;
+
+		// классы эквивалентности байтов: байты, неразличимые всеми наборами
+		_nclasses = 1;
+		for (int c = 0; c < 256; ++c)
+			_cls[c] = 0;
+		for (size_t s = 0; s < _sets.size(); ++s)
+		{
+			std::vector<int> remap(_nclasses * 2, -1);
+			int n = 0;
+			for (int c = 0; c < 256; ++c)
+			{
+				int key = _cls[c] * 2 + (_sets[s].has((unsigned char)c) ? 1 : 0);
+				if (remap[key] < 0)
+					remap[key] = n++;
+				_cls[c] = (unsigned char)remap[key];
+			}
+			_nclasses = n;
+		}
+		std::vector<unsigned char> repr(_nclasses, 0);
+		for (int c = 255; c >= 0; --c)
+			repr[_cls[c]] = (unsigned char)c;
+
+		std::map<std::vector<int>, int> ids;
+		std::vector<std::vector<int> > work;
+
+		std::vector<int> start(_starts);
+		start.insert(start.end(), _anchored.begin(), _anchored.end());
+		closure(start);
+		ids[start] = 0;
+		work.push_back(start);
+
+		for (size_t d = 0; d < work.size(); ++d)
+		{
+			if (work.size() > MAX_DFA_STATES)
+			{
+				err = "regex locations produce too many DFA states";
+				return false;
+			}
+			int acc = -1;
+			for (size_t k = 0; k < work[d].size(); ++k)
+			{
+				const NState &st = _nfa[work[d][k]];
+				if (st.kind == N_MATCH && (acc < 0 || st.value < acc))
+					acc = st.value;
+			}
+			_accept.push_back(acc);
+
+			for (int cl = 0; cl < _nclasses; ++cl)
+			{
+				std::vector<int> nxt(_starts); // поиск, а не полное совпадение: можно начать с любого байта
+				for (size_t k = 0; k < work[d].size(); ++k)
+				{
+					const NState &st = _nfa[work[d][k]];
+					if (st.kind == N_CHAR && _sets[st.set].has(repr[cl]))
+						nxt.push_back(st.out);
+				}
+				closure(nxt);
+				int id = -1;
+				if (!nxt.empty())
+				{
+					std::map<std::vector<int>, int>::iterator it = ids.find(nxt);
+					if (it == ids.end())
+					{
+						id = (int)work.size();
+						ids[nxt] = id;
+						work.push_back(nxt);
+					}
+					else
+						id = it->second;
+				}
+				_trans.push_back(id);
+			}
+		}
+		return true;
+	}
+
+	int RegexSet::match(const char *s, size_t n) const
+	{
+		if (_accept.empty())
+			return -1;
+		int st = 0;
+		for (size_t i = 0; i < n; ++i)
+		{
+			st = _trans[(size_t)st * _nclasses + _cls[(unsigned char)s[i]]];
+			if (st < 0)
+				return -1;
+		}
+		return _accept[st] < 0 ? -1 : _values[_accept[st]];
+	}
+
+} // namespace ws
@@ -0,0 +1,195 @@
+#include "webserv/http/RouteTable.hpp"
+#include <cstring>
+
+namespace ws
+{
+
+	static inline char lowerAscii(char c)
+	{
+		return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+	}
+
+	// ---------------- PrefixTrie ----------------
+
+	PrefixTrie::PrefixTrie() : _nodes(1) {}
+
+	int PrefixTrie::newNode(const std::string &label, int value)
+	{
+		Node n;
+		n.label = label;
+		n.value = value;
+		_nodes.push_back(n);
+		return (int)_nodes.size() - 1;
+	}
+
+	int PrefixTrie::findChild(int node, unsigned char c) const
+	{
+		const std::vector<unsigned char> &f = _nodes[node].first;
+		size_t lo = 0, hi = f.size();
+		while (lo < hi)
+		{
+			size_t mid = (lo + hi) / 2;
+			if (f[mid] < c)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		if (lo < f.size() && f[lo] == c)
+			return _nodes[node].kids[lo];
+		return -1;
+	}
+
+	void PrefixTrie::setChild(int node, unsigned char c, int child)
+	{
+		std::vector<unsigned char> &f = _nodes[node].first;
+		std::vector<int> &k = _nodes[node].kids;
+		size_t i = 0;
+		while (i < f.size() && f[i] < c)
+			++i;
+		if (i < f.size() && f[i] == c)
+		{
+			k[i] = child;
+			return;
+		}
+		f.insert(f.begin() + i, c);
+		k.insert(k.begin() + i, child);
+	}
+
+	void PrefixTrie::insert(const std::string &key, int value)
+	{
+		int cur = 0;
+		size_t i = 0;
+		for (;;)
+		{
+			if (i == key.size())
+			{
+				if (_nodes[cur].value < 0)
+					_nodes[cur].value = value;
+				return;
+			}
+			unsigned char c = (unsigned char)key[i];
+			int k = findChild(cur, c);
+			if (k < 0)
+			{
+				int n = newNode(key.substr(i), value);
+				setChild(cur, c, n);
+				return;
+			}
+			std::string lab = _nodes[k].label; // копия: push_back ниже может сдвинуть _nodes
+			size_t j = 0;
+			while (j < lab.size() && i + j < key.size() && lab[j] == key[i + j])
+				++j;
+			if (j == lab.size())
+			{
+				cur = k;
+				i += j;
+				continue;
+			}
+			// расщепляем ребро: cur -> mid(lab[0..j)) -> k(lab[j..))
+			int mid = newNode(lab.substr(0, j), -1);
+			_nodes[k].label = lab.substr(j);
+			setChild(mid, (unsigned char)lab[j], k);
+			setChild(cur, c, mid);
+			cur = mid;
+			i += j;
+		}
+	}
+
+	int PrefixTrie::longestPrefix(const char *s, size_t n) const
+	{
+		int cur = 0;
+		int best = _nodes[0].value;
+		size_t i = 0;
+		while (i < n)
+		{
+			int k = findChild(cur, (unsigned char)s[i]);
+			if (k < 0)
+				break;
+			const std::string &lab = _nodes[k].label;
+			if (n - i < lab.size() || std::memcmp(s + i, lab.data(), lab.size()) != 0)
+				break;
+			i += lab.size();
+			cur = k;
+			if (_nodes[k].value >= 0)
+				best = _nodes[k].value;
+		}
+		return best;
+	}
+
+	// ---------------- NameHash ----------------
+
+	NameHash::NameHash(bool foldCase) : _slots(16), _used(0), _fold(foldCase) {}
+
+	char NameHash::fold(char c) const
+	{
+		return _fold ? lowerAscii(c) : c;
+	}
+
+	unsigned NameHash::hashOf(const char *s, size_t n) const
+	{
+		// FNV-1a
+		unsigned h = 2166136261u;
+		for (size_t i = 0; i < n; ++i)
+		{
+			h ^= (unsigned char)fold(s[i]);
+			h *= 16777619u;
+		}
+		return h;
+	}
+
+	void NameHash::grow()
+	{
+		std::vector<Slot> old;
+		old.swap(_slots);
+		_slots.resize(old.size() * 2);
+		_used = 0;
+		for (size_t i = 0; i < old.size(); ++i)
+			if (old[i].value >= 0)
+				insert(old[i].key, old[i].value);
+	}
+
+	void NameHash::insert(const std::string &name, int value)
+	{
+		if ((_used + 1) * 2 > _slots.size())
+			grow();
+		std::string key(name);
+		for (size_t i = 0; i < key.size(); ++i)
+			key[i] = fold(key[i]);
+		unsigned h = hashOf(key.data(), key.size());
+		size_t mask = _slots.size() - 1;
+		for (size_t i = h & mask;; i = (i + 1) & mask)
+		{
+			Slot &s = _slots[i];
+			if (s.value < 0)
+			{
+				s.key = key;
+				s.value = value;
+				s.hash = h;
+				++_used;
+				return;
+			}
+			if (s.hash == h && s.key == key)
+				return;
+		}
+	}
+
+	int NameHash::find(const char *s, size_t n) const
+	{
+		unsigned h = hashOf(s, n);
+		size_t mask = _slots.size() - 1;
+		for (size_t i = h & mask;; i = (i + 1) & mask)
+		{
+			const Slot &sl = _slots[i];
+			if (sl.value < 0)
+				return -1;
+			if (sl.hash != h || sl.key.size() != n)
+				continue;
+			size_t j = 0;
+			while (j < n && sl.key[j] == fold(s[j]))
+				++j;
+			if (j == n)
+				return sl.value;
+		}
+	}
+
+} // namespace ws
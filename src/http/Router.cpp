@@ -3,77 +3,125 @@
 
 namespace ws {
 
-Router::Router(const Config* cfg) : _cfg(cfg) {}
-
-// Нормализуем host из заголовка: отрезаем порт, приводим к точному сравнению
-static std::string hostFromHeader(const std::string& hostHeader) {
-    if (hostHeader.empty()) return std::string();
-    std::string h = hostHeader;
-    // отрежем :port если есть
-    std::string::size_type colon = h.rfind(':');
-    if (colon != std::string::npos) {
-        // ipv6 не поддерживаем здесь — у нас IPv4; простое правило достаточно
-        h = h.substr(0, colon);
-    }
-    return h;
-}
-
-const ServerConfig* Router::pickServer(const std::string& lhost, int lport,
-                                       const std::string& hostHeader) const
-{
-    // 1) среди серверов, слушающих тот же host:port
-    const ServerConfig* firstForPair = 0;
-    std::string hh = hostFromHeader(hostHeader);
-
+Router::Router(const Config* cfg) : _cfg(cfg) {
+    _locations.resize(_cfg->servers.size());
     for (size_t i=0; i<_cfg->servers.size(); ++i) {
         const ServerConfig& s = _cfg->servers[i];
-        if (s.host == lhost && s.port == lport) {
-            if (!firstForPair) firstForPair = &s;
-            // если Host совпал с одним из server_name — берём его
-            for (size_t j=0; j<s.server_names.size(); ++j) {
-                if (!hh.empty() && s.server_names[j] == hh) return &s;
+
+        // 1) таблица слушателя host:port
+        ListenerRoutes* lr = 0;
+        for (size_t k=0; k<_listeners.size(); ++k) {
+            if (_listeners[k].host == s.host && _listeners[k].port == s.port) { lr = &_listeners[k]; break; }
+        }
+        if (!lr) {
+            _listeners.push_back(ListenerRoutes());
+            lr = &_listeners.back();
+            lr->host = s.host;
+            lr->port = s.port;
+            lr->def = &s;
+        }
+
+        // 2) имена: точные — в хэш, "*.suffix" — в дерево по развёрнутой строке
+        for (size_t j=0; j<s.server_names.size(); ++j) {
+            const std::string& name = s.server_names[j];
+            if (name.size() > 2 && name[0] == '*' && name[1] == '.') {
+                std::string rev;
+                for (size_t c = name.size(); c > 1; --c) {
+                    char ch = name[c-1];
+                    rev.push_back((ch >= 'A' && ch <= 'Z') ? char(ch - 'A' + 'a') : ch);
+                }
+                lr->wildcard.insert(rev, (int)i);
+            } else {
+                lr->exact.insert(name, (int)i);
             }
         }
+
+        // 3) location-ы сервера
+        ServerRoutes& sr = _locations[i];
+        for (size_t j=0; j<s.locations.size(); ++j) {
+            const Location& L = s.locations[j];
+            std::string err;
+            if (L.match == LOC_EXACT) sr.exact.insert(L.path, (int)j);
+            else if (L.match == LOC_PREFIX) sr.prefix.insert(L.path, (int)j);
+            else if (!sr.regex.add(L.path, L.regex_icase, (int)j, err))
+                throw ConfigError("bad regex location \"" + L.path + "\": " + err, 0, 0);
+        }
+        std::string err;
+        if (!sr.regex.compile(err)) throw ConfigError(err, 0, 0);
     }
-    // 2) иначе — первый server для пары (default_server)
-    if (firstForPair) return firstForPair;
+}
 
+const ListenerRoutes* Router::listenerRoutes(const std::string& host, int port) const {
+    for (size_t k=0; k<_listeners.size(); ++k)
+        if (_listeners[k].port == port && _listeners[k].host == host) return &_listeners[k];
+    return 0;
+}
+
+const ServerConfig* Router::defaultServer(const ListenerRoutes* lr) const {
+    if (lr) return lr->def;
     // крайний случай (не должен случиться при валидной конфигурации)
     return _cfg->servers.empty() ? 0 : &_cfg->servers[0];
 }
 
-static std::string pathOnly(const std::string& target) {
-    // отделим путь от ?query
-    std::string::size_type q = target.find('?');
-    return q == std::string::npos ? target : target.substr(0, q);
+const ServerConfig* Router::pickServer(const ListenerRoutes* lr,
+                                       const std::string& hostHeader) const
+{
+    if (!lr) return defaultServer(lr);
+
+    // Host без :port (ipv6 не поддерживаем здесь — у нас IPv4)
+    size_t n = hostHeader.size();
+    std::string::size_type colon = hostHeader.rfind(':');
+    if (colon != std::string::npos) n = colon;
+    if (n == 0) return lr->def;
+
+    // 1) точное имя
+    int idx = lr->exact.find(hostHeader.data(), n);
+    if (idx >= 0) return &_cfg->servers[idx];
+
+    // 2) самый длинный "*.suffix": идём по имени справа налево
+    if (!lr->wildcard.empty() && n <= 255) {
+        char rev[256];
+        for (size_t c = 0; c < n; ++c) {
+            char ch = hostHeader[n - 1 - c];
+            rev[c] = (ch >= 'A' && ch <= 'Z') ? char(ch - 'A' + 'a') : ch;
+        }
+        idx = lr->wildcard.longestPrefix(rev, n);
+        if (idx >= 0) return &_cfg->servers[idx];
+    }
+
+    // 3) иначе — первый server для пары (default_server)
+    return lr->def;
 }
 
 const Location* Router::pickLocation(const ServerConfig* srv,
-                                     const std::string& path) const
+                                     const std::string& target) const
 {
-    const Location* best = 0;
-    size_t bestLen = 0;
-    for (size_t i=0; i<srv->locations.size(); ++i) {
-        const Location& L = srv->locations[i];
-        const std::string& p = L.path;
-        if (p.size() <= path.size() && path.compare(0, p.size(), p) == 0) {
-            if (p.size() > bestLen) { best = &L; bestLen = p.size(); }
-        }
-    }
-    return best;
+    // путь без ?query — без копирования
+    std::string::size_type q = target.find('?');
+    size_t n = (q == std::string::npos) ? target.size() : q;
+
+    const ServerRoutes& sr = _locations[(size_t)(srv - &_cfg->servers[0])];
+    int li = sr.exact.find(target.data(), n);
+    if (li < 0 && !sr.regex.empty()) li = sr.regex.match(target.data(), n);
+    if (li < 0) li = sr.prefix.longestPrefix(target.data(), n);
+    return li < 0 ? 0 : &srv->locations[li];
 }
 
-RouteMatch Router::resolve(const std::string& listenerHost, int listenerPort,
+RouteMatch Router::resolve(const ListenerRoutes* lr,
                            const std::string& hostHeader,
                            const std::string& requestTarget) const
 {
     RouteMatch r; r.server = 0; r.location = 0;
-    r.server = pickServer(listenerHost, listenerPort, hostHeader);
-    if (r.server) {
-        std::string p = pathOnly(requestTarget);
-        r.location = pickLocation(r.server, p);
-    }
+    r.server = pickServer(lr, hostHeader);
+    if (r.server) r.location = pickLocation(r.server, requestTarget);
     return r;
 }
 
-} // namespace ws
\ No newline at end of file
+RouteMatch Router::resolve(const std::string& listenerHost, int listenerPort,
+                           const std::string& hostHeader,
+                           const std::string& requestTarget) const
+{
+    return resolve(listenerRoutes(listenerHost, listenerPort), hostHeader, requestTarget);
+}
+
+} // namespace ws
@@ -10,6 +10,7 @@
 #include <string.h>
 #include <fstream>
 #include <sstream>
+#include <cstdlib>
 #include <ctime>
 #include <time.h>
 
@@ -48,31 +49,22 @@ namespace ws
 			return "OK";
 		case 301:
 			return "Moved Permanently";
+		case 206:
+			return "Partial Content";
 		case 304:
 			return "Not Modified";
 		case 403:
 			return "Forbidden";
 		case 404:
 			return "Not Found";
+		case 416:
+			return "Range Not Satisfiable";
 		case 500:
 			return "Internal Server Error";
 		}
 		return "OK";
 	}
 
-	static std::string httpDateFromTime(std::time_t t)
-	{
-		char buf[64];
-		std::tm gmt;
-#if defined(_WIN32)
-		gmtime_s(&gmt, &t);
-#else
-		gmtime_r(&t, &gmt);
-#endif
-		std::strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &gmt);
-		return std::string(buf);
-	}
-
 	// Поддержим основную форму IMF-fixdate: "Tue, 15 Nov 1994 08:12:31 GMT"
 	// Возврат: -1 если не распарсили
 	static std::time_t parseHttpDate(const std::string &s)
@@ -164,7 +156,9 @@ namespace ws
 				lpath = "/" + lpath;
 
 			// Требуем совпадение по границе: либо точное совпадение, либо следующий символ — '/'
-			const bool hasPrefix = (rest.size() >= lpath.size() &&
+			// (regex-location префикса не имеет — путь берётся целиком)
+			const bool hasPrefix = (loc->match != LOC_REGEX &&
+									rest.size() >= lpath.size() &&
 									rest.compare(0, lpath.size(), lpath) == 0 &&
 									(rest.size() == lpath.size() || rest[lpath.size()] == '/'));
 
@@ -185,8 +179,11 @@ namespace ws
 			}
 			else
 			{
-				// Нет совпадения префикса — fallback к корню сервера
-				base = srv.root.empty() ? "." : srv.root;
+				// Нет совпадения префикса — root location-а (regex) или корень сервера
+				if (loc->match == LOC_REGEX && !loc->root.empty())
+					base = loc->root;
+				else
+					base = srv.root.empty() ? "." : srv.root;
 				if (!rest.empty() && rest[0] == '/')
 					rest.erase(0, 1);
 			}
@@ -231,6 +228,127 @@ namespace ws
 		return false;
 	}
 
+	// "bytes=a-b" | "bytes=a-" | "bytes=-n" → [first, last]; несколько диапазонов
+	// не поддерживаем (отдаём файл целиком, это разрешено RFC 7233).
+	// Возврат: 1 — диапазон, 0 — игнорировать заголовок, -1 — 416
+	static int parseRange(const std::string &h, unsigned long long size,
+						  unsigned long long &first, unsigned long long &last)
+	{
+		if (h.compare(0, 6, "bytes=") != 0 || h.find(',') != std::string::npos)
+			return 0;
+		std::string spec = h.substr(6);
+		size_t dash = spec.find('-');
+		if (dash == std::string::npos)
+			return 0;
+		std::string a = spec.substr(0, dash), b = spec.substr(dash + 1);
+		if (a.find_first_not_of("0123456789") != std::string::npos ||
+			b.find_first_not_of("0123456789") != std::string::npos ||
+			(a.empty() && b.empty()) || a.size() > 18 || b.size() > 18)
+			return 0;
+		if (a.empty())
+		{
+			// последние n байт
+			unsigned long long n = std::strtoull(b.c_str(), 0, 10);
+			if (n == 0 || size == 0)
+				return -1;
+			first = n >= size ? 0 : size - n;
+			last = size - 1;
+			return 1;
+		}
+		first = std::strtoull(a.c_str(), 0, 10);
+		last = b.empty() ? size - 1 : std::strtoull(b.c_str(), 0, 10);
+		if (!b.empty() && last < first)
+			return 0;
+		if (first >= size)
+			return -1;
+		if (last >= size)
+			last = size - 1;
+		return 1;
+	}
+
+	void StaticHandler::serveFile(const std::string &fsPath,
+								  const HttpRequest &req,
+								  StaticResult &out)
+	{
+		out.location.clear();
+		out.extraHeaders.clear();
+		out.body.clear();
+		out.filePath.clear();
+		out.fileOffset = 0;
+
+		struct stat st;
+		if (stat(fsPath.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+		{
+			out.status = 404;
+			out.reason = reasonFor(404);
+			out.body = "404 Not Found\n";
+			out.contentType = "text/plain; charset=utf-8";
+			out.contentLength = out.body.size();
+			return;
+		}
+
+		std::string etag = makeWeakETag(st.st_size, st.st_mtime);
+		std::string lastMod = httpDate(st.st_mtime);
+		out.contentType = mimeByExt(fsPath);
+		out.extraHeaders += "ETag: " + etag + "\r\n";
+		out.extraHeaders += "Last-Modified: " + lastMod + "\r\n";
+
+		// If-None-Match / If-Modified-Since → 304
+		std::string inm = req.getHeader("if-none-match");
+		bool notModified = !inm.empty() && etagMatches(inm, etag);
+		if (inm.empty())
+		{
+			std::string ims = req.getHeader("if-modified-since");
+			std::time_t ims_t = ims.empty() ? (time_t)-1 : parseHttpDate(ims);
+			notModified = ims_t != (time_t)-1 && st.st_mtime <= ims_t;
+		}
+		if (notModified)
+		{
+			out.status = 304;
+			out.reason = reasonFor(304);
+			out.contentLength = 0;
+			return;
+		}
+
+		unsigned long long size = (unsigned long long)st.st_size;
+		unsigned long long first = 0, last = size ? size - 1 : 0;
+		out.extraHeaders += "Accept-Ranges: bytes\r\n";
+		std::string range = req.getHeader("range");
+		std::string ifRange = req.getHeader("if-range");
+		int r = 0;
+		if (!range.empty() && (ifRange.empty() || ifRange == etag || ifRange == lastMod))
+			r = parseRange(range, size, first, last);
+		if (r < 0)
+		{
+			std::ostringstream cr;
+			cr << "Content-Range: bytes */" << size << "\r\n";
+			out.extraHeaders += cr.str();
+			out.status = 416;
+			out.reason = reasonFor(416);
+			out.body = "416 Range Not Satisfiable\n";
+			out.contentType = "text/plain; charset=utf-8";
+			out.contentLength = out.body.size();
+			return;
+		}
+		if (r > 0)
+		{
+			std::ostringstream cr;
+			cr << "Content-Range: bytes " << first << "-" << last << "/" << size << "\r\n";
+			out.extraHeaders += cr.str();
+			out.status = 206;
+			out.reason = reasonFor(206);
+		}
+		else
+		{
+			out.status = 200;
+			out.reason = reasonFor(200);
+		}
+		// тело не читаем: его отдаст Connection прямо из файла (sendfile)
+		out.filePath = fsPath;
+		out.fileOffset = (size_t)first;
+		out.contentLength = size ? (size_t)(last - first + 1) : 0;
+	}
+
 	bool StaticHandler::handleGET(const ServerConfig &srv,
 								  const Location *loc,
 								  const HttpRequest &req,
@@ -269,83 +387,7 @@ namespace ws
 		// ---------- FILE ----------
 		if (isFile(fsPath) && !wantDir)
 		{
-			struct stat st;
-			if (stat(fsPath.c_str(), &st) != 0)
-			{
-				out.status = 500;
-				out.reason = reasonFor(500);
-				out.body = "500 Internal Server Error\n";
-				out.contentType = "text/plain; charset=utf-8";
-				out.contentLength = out.body.size();
-				return true;
-			}
-
-			std::string etag = makeWeakETag(st.st_size, st.st_mtime);
-			std::string lastMod = httpDate(st.st_mtime);
-
-			// If-None-Match → 304
-			{
-				std::string inm = req.getHeader("if-none-match");
-				if (!inm.empty() && etagMatches(inm, etag))
-				{
-					out.status = 304;
-					out.reason = "Not Modified";
-					out.body.clear();
-					out.contentType = mimeByExt(fsPath);
-					out.contentLength = 0;
-					out.extraHeaders.clear();
-					out.extraHeaders += "ETag: " + etag + "\r\n";
-					out.extraHeaders += "Last-Modified: " + lastMod + "\r\n";
-					return true;
-				}
-			}
-
-			// If-Modified-Since → 304
-			{
-				std::string ims = req.getHeader("if-modified-since");
-				if (!ims.empty())
-				{
-					std::time_t ims_t = parseHttpDate(ims);
-					if (ims_t != (time_t)-1 && st.st_mtime <= ims_t)
-					{
-						out.status = 304;
-						out.reason = reasonFor(304);
-						out.body.clear();
-						out.contentType = mimeByExt(fsPath);
-						out.contentLength = 0;
-						out.extraHeaders.clear();
-						out.extraHeaders += "ETag: " + etag + "\r\n";
-						out.extraHeaders += "Last-Modified: " + lastMod + "\r\n";
-						return true;
-					}
-				}
-			}
-
-			std::string body;
-			if (!readFile(fsPath, body))
-			{
-				out.status = 500;
-				out.reason = reasonFor(500);
-				out.body = "500 Internal Server Error\n";
-				out.contentType = "text/plain; charset=utf-8";
-				out.contentLength = out.body.size();
-				return true;
-			}
-
-			out.status = 200;
-			out.reason = reasonFor(200);
-			out.body = body;
-			out.contentType = mimeByExt(fsPath); // ← FIX: fsPath, не cand
-			out.contentLength = out.body.size();
-			out.location.clear();
-			out.extraHeaders.clear();
-			out.extraHeaders += "ETag: " + etag + "\r\n";
-			out.extraHeaders += "Last-Modified: " + lastMod + "\r\n";
-			if (req.method == "HEAD")
-			{
-				out.body.clear();
-				out.contentLength = 0;
-			}
+			serveFile(fsPath, req, out);
 			return true;
 		}
 
@@ -360,79 +402,7 @@ namespace ws
 					std::string cand = pathJoin(fsPath, loc->index[i]);
 					if (isFile(cand))
 					{
-						struct stat st;
-						std::string body;
-						if (stat(cand.c_str(), &st) != 0 || !readFile(cand, body))
-						{
-							out.status = 500;
-							out.reason = reasonFor(500);
-							out.body = "500 Internal Server Error\n";
-							out.contentType = "text/plain; charset=utf-8";
-							out.contentLength = out.body.size();
-							out.location.clear();
-							out.extraHeaders.clear();
-							return true;
-						}
-
-						std::time_t mtime = st.st_mtime;
-						std::string lastMod = httpDateFromTime(mtime);
-						std::string etag = makeWeakETag(st.st_size, st.st_mtime);
-
-						// If-None-Match → 304
-						{
-							std::string inm = req.getHeader("if-none-match");
-							if (!inm.empty() && etagMatches(inm, etag))
-							{
-								out.status = 304;
-								out.reason = "Not Modified";
-								out.body.clear();
-								out.contentType = mimeByExt(cand);
-								out.contentLength = 0;
-								out.location.clear();
-								out.extraHeaders.clear();
-								out.extraHeaders += "ETag: " + etag + "\r\n";
-								out.extraHeaders += "Last-Modified: " + lastMod + "\r\n";
-								return true;
-							}
-						}
-
-						// If-Modified-Since → 304
-						{
-							std::string ims = req.getHeader("if-modified-since");
-							if (!ims.empty())
-							{
-								std::time_t ims_t = parseHttpDate(ims);
-								if (ims_t != (time_t)-1 && mtime <= ims_t)
-								{
-									out.status = 304;
-									out.reason = reasonFor(304);
-									out.body.clear();
-									out.contentType = mimeByExt(cand);
-									out.contentLength = 0;
-									out.location.clear();
-									out.extraHeaders.clear();
-									out.extraHeaders += "ETag: " + etag + "\r\n";
-									out.extraHeaders += "Last-Modified: " + lastMod + "\r\n";
-									return true;
-								}
-							}
-						}
-
-						// 200 OK
-						out.status = 200;
-						out.reason = reasonFor(200);
-						out.body = body;
-						out.contentType = mimeByExt(cand); // ← FIX: cand
-						out.contentLength = out.body.size();
-						out.location.clear();
-						out.extraHeaders.clear();
-						out.extraHeaders += "ETag: " + etag + "\r\n";
-						out.extraHeaders += "Last-Modified: " + lastMod + "\r\n";
-						if (req.method == "HEAD")
-						{
-							out.body.clear();
-							out.contentLength = 0;
-						}
+						serveFile(cand, req, out);
 						return true;
 					}
 				}
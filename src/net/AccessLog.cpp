@@ -0,0 +1,377 @@
+#include "webserv/net/AccessLog.hpp"
+#include "webserv/Log.hpp"
+#include "webserv/http/Request.hpp"
+#include "webserv/net/Listener.hpp"
+#include "webserv/utils/Metrics.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace ws {
+
+/**
+ * Кольцо одного потока-писателя для одного файла: head двигает только он,
+ * tail — только поток записи. Размер — степень двойки, позиции не
+ * заворачиваются (маска берётся при обращении).
+ */
+struct AccessLog::Ring {
+  char* buf;
+  size_t mask;
+  size_t head;  // записано производителем (__atomic, release)
+  size_t tail;  // выписано в файл (__atomic, release)
+};
+
+__thread std::vector<AccessLog::Ring*>* AccessLog::_rings = 0;
+
+// метка времени [18/Oct/2026:22:37:26 +0000] — своя у потока, раз в секунду
+static __thread time_t t_stampSec = (time_t)-1;
+static __thread char t_stamp[48];
+static __thread size_t t_stampLen = 0;
+
+// SIGUSR1: переоткрыть файлы; обработчик только ставит флаг и будит писателя
+static volatile sig_atomic_t g_reopen = 0;
+static volatile int g_wakeWr = -1;
+
+extern "C" void ws_onSigusr1(int) {
+  g_reopen = 1;
+  if (g_wakeWr >= 0) {
+    char b = 1;
+    ssize_t r = ::write(g_wakeWr, &b, 1);
+    (void)r;
+  }
+}
+
+AccessLog::AccessLog()
+    : _thread(), _running(false), _wakeRd(-1), _wakeWr(-1), _wake(0), _stop(0) {
+  pthread_mutex_init(&_mu, 0);
+}
+
+AccessLog::~AccessLog() {
+  if (_running) {
+    __atomic_store_n(&_stop, 1, __ATOMIC_RELEASE);
+    char b = 1;
+    ssize_t r = ::write(_wakeWr, &b, 1);
+    (void)r;
+    pthread_join(_thread, 0);  // последний drain — в work()
+    ::signal(SIGUSR1, SIG_DFL);
+    g_wakeWr = -1;
+  }
+  if (_wakeRd >= 0) ::close(_wakeRd);
+  if (_wakeWr >= 0) ::close(_wakeWr);
+  for (size_t i = 0; i < _files.size(); ++i) {
+    // кольца потоков не освобождаем: _rings их ещё держит
+    if (_files[i]->fd >= 0) ::close(_files[i]->fd);
+    delete _files[i];
+  }
+  pthread_mutex_destroy(&_mu);
+}
+
+bool AccessLog::formatFromName(const std::string& name, Format& f) {
+  if (name == "combined") f = COMBINED;
+  else if (name == "common") f = COMMON;
+  else if (name == "timing") f = TIMING;
+  else return false;
+  return true;
+}
+
+static int openLog(const std::string& path) {
+  return ::open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+}
+
+int AccessLog::open(const std::string& path, size_t buffer, size_t flushMs, std::string& err) {
+  if (flushMs == 0) flushMs = 1;
+  for (size_t i = 0; i < _files.size(); ++i) {
+    File* f = _files[i];
+    if (f->path != path) continue;
+    if (buffer > f->buffer) f->buffer = buffer;
+    if (flushMs < f->flushMs) f->flushMs = flushMs;
+    return (int)i;
+  }
+  int fd = openLog(path);
+  if (fd < 0) {
+    err = "access_log: cannot open " + path + ": " + std::strerror(errno);
+    return -1;
+  }
+  File* f = new File;
+  f->path = path;
+  f->fd = fd;
+  f->buffer = buffer;
+  f->flushMs = flushMs;
+  f->failing = false;
+  _files.push_back(f);
+  return (int)_files.size() - 1;
+}
+
+void AccessLog::route(size_t slot, int file, Format f) {
+  Target none = { -1, COMBINED };
+  if (_routes.size() <= slot) _routes.resize(slot + 1, none);
+  _routes[slot].file = file;
+  _routes[slot].format = f;
+}
+
+bool AccessLog::start() {
+  if (_running || _files.empty()) return true;
+  int p[2];
+  if (::pipe(p) != 0) return false;
+  setNonBlocking(p[0]); setNonBlocking(p[1]);
+  setCloseOnExec(p[0]); setCloseOnExec(p[1]);
+  _wakeRd = p[0];
+  _wakeWr = p[1];
+
+  // сигналы — потоку цикла: писатель стартует с заблокированной маской
+  sigset_t all, old;
+  sigfillset(&all);
+  pthread_sigmask(SIG_BLOCK, &all, &old);
+  const bool ok = pthread_create(&_thread, 0, &AccessLog::threadMain, this) == 0;
+  pthread_sigmask(SIG_SETMASK, &old, 0);
+  if (!ok) {
+    WS_LOG_WARN("access_log: cannot start writer thread");
+    return false;
+  }
+  _running = true;
+
+  g_wakeWr = _wakeWr;
+  struct sigaction sa;
+  std::memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = ws_onSigusr1;
+  sigemptyset(&sa.sa_mask);
+  sa.sa_flags = SA_RESTART;
+  return ::sigaction(SIGUSR1, &sa, 0) == 0;
+}
+
+// ---- производитель -------------------------------------------------------
+
+AccessLog::Ring* AccessLog::ring(int file) {
+  if (!_rings) _rings = new std::vector<Ring*>;
+  if ((size_t)file < _rings->size() && (*_rings)[file]) return (*_rings)[file];
+
+  File* f = _files[file];
+  size_t cap = 4096;
+  while (cap < f->buffer) cap <<= 1;
+  Ring* r = new Ring;
+  r->buf = new char[cap];
+  r->mask = cap - 1;
+  r->head = r->tail = 0;
+  if (_rings->size() <= (size_t)file) _rings->resize(file + 1, (Ring*)0);
+  (*_rings)[file] = r;
+  pthread_mutex_lock(&_mu);
+  f->rings.push_back(r);
+  pthread_mutex_unlock(&_mu);
+  return r;
+}
+
+void AccessLog::wake() {
+  if (__atomic_exchange_n(&_wake, 1, __ATOMIC_ACQ_REL)) return;  // уже будили
+  char b = 1;
+  ssize_t r = ::write(_wakeWr, &b, 1);
+  (void)r;
+}
+
+void AccessLog::push(int file, const char* line, size_t n) {
+  Ring* r = ring(file);
+  const size_t cap = r->mask + 1;
+  const size_t head = r->head;
+  const size_t used = head - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+  if (n > cap - used) {
+    Metrics::inc(Metrics::ACCESS_LOG_DROPS);  // не ждём диск: строку теряем
+    return;
+  }
+  const size_t off = head & r->mask;
+  const size_t first = n < cap - off ? n : cap - off;
+  std::memcpy(r->buf + off, line, first);
+  std::memcpy(r->buf, line + first, n - first);
+  __atomic_store_n(&r->head, head + n, __ATOMIC_RELEASE);
+  if (used + n > cap / 2) wake();
+}
+
+struct LineBuf {
+  char* p;
+  char* end;  // место под '\n' остаётся всегда
+
+  void put(const char* s, size_t n) {
+    if (n > (size_t)(end - p)) n = (size_t)(end - p);
+    std::memcpy(p, s, n);
+    p += n;
+  }
+  void put(const char* s) { put(s, std::strlen(s)); }
+  void put(char c) { if (p < end) *p++ = c; }
+  void put(const std::string& s) { put(s.data(), s.size()); }
+  void uint(unsigned long long v) {
+    char tmp[24];
+    size_t i = sizeof(tmp);
+    do { tmp[--i] = char('0' + v % 10); v /= 10; } while (v);
+    put(tmp + i, sizeof(tmp) - i);
+  }
+  // как nginx: кавычка, обратная косая и непечатаемые — \xHH
+  void escaped(const std::string& s) {
+    static const char hex[] = "0123456789ABCDEF";
+    for (size_t i = 0; i < s.size(); ++i) {
+      const unsigned char c = (unsigned char)s[i];
+      if (c < 0x20 || c >= 0x7f || c == '"' || c == '\\') {
+        put("\\x", 2);
+        put(hex[c >> 4]);
+        put(hex[c & 15]);
+      } else {
+        put((char)c);
+      }
+    }
+  }
+  // заголовок запроса в кавычках; нет его — "-"
+  void header(const HttpRequest& r, const char* name) {
+    std::map<std::string, std::string>::const_iterator it = r.headers.find(name);
+    put('"');
+    if (it == r.headers.end() || it->second.empty()) put('-');
+    else escaped(it->second);
+    put('"');
+  }
+  void seconds(unsigned long long us) {  // 0.123
+    uint(us / 1000000);
+    char ms[4] = { char('0' + us / 100000 % 10), char('0' + us / 10000 % 10), char('0' + us / 1000 % 10), 0 };
+    put('.');
+    put(ms, 3);
+  }
+};
+
+static void timestamp(LineBuf& b) {
+  const time_t now = std::time(0);
+  if (now != t_stampSec) {
+    struct tm tm;
+    localtime_r(&now, &tm);
+    t_stampLen = std::strftime(t_stamp, sizeof(t_stamp), "[%d/%b/%Y:%H:%M:%S %z]", &tm);
+    t_stampSec = now;
+  }
+  b.put(t_stamp, t_stampLen);
+}
+
+void AccessLog::log(size_t slot, const AccessEntry& e) {
+  if (slot >= _routes.size() || _routes[slot].file < 0) return;
+  const Target& t = _routes[slot];
+
+  char line[MAX_LINE];
+  LineBuf b = { line, line + sizeof(line) - 1 };
+  if (e.peer->empty()) b.put('-');
+  else b.put(*e.peer);
+  b.put(" - - ", 5);
+  timestamp(b);
+  b.put(' ');
+  const HttpRequest& r = *e.req;
+  if (r.method.empty()) {
+    b.put("\"-\"", 3);
+  } else {
+    b.put('"');
+    b.escaped(r.method);
+    b.put(' ');
+    b.escaped(r.raw_target.empty() ? r.target : r.raw_target);
+    b.put(' ');
+    b.escaped(r.version);
+    b.put('"');
+  }
+  b.put(' ');
+  b.uint((unsigned long long)e.status);
+  b.put(' ');
+  b.uint(e.bytes);
+  if (t.format != COMMON) {
+    b.put(' ');
+    b.header(r, "referer");
+    b.put(' ');
+    b.header(r, "user-agent");
+  }
+  if (t.format == TIMING) {
+    b.put(" rt=", 4);
+    b.seconds(e.totalUs);
+    b.put(" ttfb=", 6);
+    b.seconds(e.ttfbUs);
+  }
+  *b.p++ = '\n';
+  push(t.file, line, (size_t)(b.p - line));
+}
+
+// ---- писатель ------------------------------------------------------------
+
+void* AccessLog::threadMain(void* self) {
+  static_cast<AccessLog*>(self)->work();
+  return 0;
+}
+
+void AccessLog::work() {
+  int timeout = 1000;
+  for (size_t i = 0; i < _files.size(); ++i)
+    if ((int)_files[i]->flushMs < timeout) timeout = (int)_files[i]->flushMs;
+
+  for (;;) {
+    struct pollfd p;
+    p.fd = _wakeRd;
+    p.events = POLLIN;
+    p.revents = 0;
+    ::poll(&p, 1, timeout);
+    char buf[64];
+    while (::read(_wakeRd, buf, sizeof(buf)) > 0) {}
+    __atomic_store_n(&_wake, 0, __ATOMIC_RELEASE);
+
+    if (g_reopen) {
+      g_reopen = 0;
+      reopen();
+    }
+    for (size_t i = 0; i < _files.size(); ++i) drain(_files[i]);
+    if (__atomic_load_n(&_stop, __ATOMIC_ACQUIRE)) return;
+  }
+}
+
+void AccessLog::drain(File* f) {
+  pthread_mutex_lock(&_mu);
+  const std::vector<Ring*> rings = f->rings;
+  pthread_mutex_unlock(&_mu);
+
+  for (size_t i = 0; i < rings.size(); ++i) {
+    Ring* r = rings[i];
+    const size_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+    size_t tail = r->tail;
+    while (tail != head) {
+      // занятая часть кольца — не больше двух кусков
+      const size_t off = tail & r->mask;
+      const size_t n = head - tail;
+      const size_t first = n < r->mask + 1 - off ? n : r->mask + 1 - off;
+      struct iovec iov[2];
+      iov[0].iov_base = r->buf + off;
+      iov[0].iov_len = first;
+      iov[1].iov_base = r->buf;
+      iov[1].iov_len = n - first;
+      const ssize_t w = ::writev(f->fd, iov, n > first ? 2 : 1);
+      if (w <= 0) {
+        if (!f->failing) WS_LOG_WARN("access_log: write to " + f->path + " failed, dropping lines");
+        f->failing = true;
+        tail = head;  // диск не принимает: выбрасываем, кольцо не должно встать
+        break;
+      }
+      f->failing = false;
+      tail += (size_t)w;
+    }
+    __atomic_store_n(&r->tail, tail, __ATOMIC_RELEASE);
+  }
+}
+
+void AccessLog::reopen() {
+  for (size_t i = 0; i < _files.size(); ++i) {
+    File* f = _files[i];
+    drain(f);  // хвост — ещё в старый файл
+    const int fd = openLog(f->path);
+    if (fd < 0) {
+      WS_LOG_WARN("access_log: cannot reopen " + f->path + ", keeping the old file");
+      continue;
+    }
+    ::close(f->fd);
+    f->fd = fd;
+    f->failing = false;
+  }
+  WS_LOG_INFO("access_log: reopened");
+}
+
+} // namespace ws
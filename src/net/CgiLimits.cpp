@@ -0,0 +1,49 @@
+#include "webserv/net/CgiLimits.hpp"
+
+namespace ws {
+
+void CgiStats::addUsage(const struct rusage& ru) {
+  ++exited;
+  cpuUserUs += (unsigned long long)ru.ru_utime.tv_sec * 1000000ULL + (unsigned long long)ru.ru_utime.tv_usec;
+  cpuSysUs  += (unsigned long long)ru.ru_stime.tv_sec * 1000000ULL + (unsigned long long)ru.ru_stime.tv_usec;
+}
+
+CgiLimits::Admit CgiLimits::acquire(const Location* loc, CgiWaiter* w) {
+  Slot& s = _slots[loc];
+  if (loc->cgi_max_concurrency == 0 || s.st.running < loc->cgi_max_concurrency) {
+    ++s.st.running;
+    return RUN;
+  }
+  if (s.waiting.size() < loc->cgi_queue) {
+    s.waiting.push_back(w);
+    s.st.queued = s.waiting.size();
+    return QUEUED;
+  }
+  ++s.st.rejected;
+  return FULL;
+}
+
+void CgiLimits::release(const Location* loc) {
+  Slot& s = _slots[loc];
+  if (s.waiting.empty()) {
+    if (s.st.running) --s.st.running;
+    return;
+  }
+  CgiWaiter* w = s.waiting.front(); // слот переходит к нему, running не меняется
+  s.waiting.pop_front();
+  s.st.queued = s.waiting.size();
+  w->onCgiSlot();
+}
+
+void CgiLimits::cancel(const Location* loc, CgiWaiter* w) {
+  Slot& s = _slots[loc];
+  for (std::deque<CgiWaiter*>::iterator it = s.waiting.begin(); it != s.waiting.end(); ++it) {
+    if (*it == w) {
+      s.waiting.erase(it);
+      break;
+    }
+  }
+  s.st.queued = s.waiting.size();
+}
+
+} // namespace ws
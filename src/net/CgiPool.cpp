@@ -0,0 +1,270 @@
+#include "webserv/net/CgiPool.hpp"
+#include "webserv/net/EventLoop.hpp"
+#include "webserv/net/Listener.hpp"
+#include "webserv/utils/IO.hpp"
+#include "webserv/net/CgiProcess.hpp"
+#include "webserv/Log.hpp"
+#include "webserv/utils/Metrics.hpp"
+
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+
+namespace ws {
+
+// ---------------- CgiPoolRequest ----------------
+
+CgiPoolRequest::CgiPoolRequest(CgiClient* client)
+  : _client(client), _worker(0), _done(false) {}
+
+CgiPoolRequest::~CgiPoolRequest() {
+  if (_worker) _worker->abandon(this);
+}
+
+void CgiPoolRequest::writeStdin(const char* data, size_t n) {
+  if (_worker && n) _worker->sendFrame(data, n);
+}
+
+void CgiPoolRequest::closeStdin() {
+  if (_worker) _worker->endStdin();
+}
+
+void CgiPoolRequest::terminate() {
+  if (_worker) _worker->terminate();
+}
+
+size_t CgiPoolRequest::stdinBacklog() const {
+  return _worker ? _worker->stdinBacklog() : 0;
+}
+
+void CgiPoolRequest::finish() {
+  _worker = 0;
+  _done = true;
+  _client->onCgiEvent(); // последним: клиент может удалить нас
+}
+
+// ---------------- CgiWorker ----------------
+
+CgiWorker::CgiWorker(EventLoop* loop, const Location* loc, CgiStats* stats)
+  : _loop(loop), _loc(loc), _stats(stats), _pid(-1), _inFd(-1), _outFd(-1), _inOff(0),
+    _frameLeft(0), _req(0), _busy(false), _reqStdinDone(false), _served(0) {}
+
+CgiWorker::~CgiWorker() {
+  _loop->cancelTimer(this);
+  closeFds();
+  if (_pid > 0) {
+    _loop->reaper().forget(_pid);
+    ::kill(_pid, SIGKILL);
+  }
+}
+
+bool CgiWorker::start() {
+  _loop->cancelTimer(this);
+  closeFds();
+  _pid = -1; // прежний процесс (перезапуск после лимита) уже выходит; его rusage всё равно придёт к нам
+  CgiLaunch l;
+  l.bin = _loc->cgi_bin;
+  l.script = _loc->cgi_pool_worker;
+  l.env = _loc->cgi_env;
+  pid_t pid = CgiHandler::spawn(l, _inFd, _outFd);
+  if (pid < 0) return false;
+  Metrics::inc(Metrics::CGI_SPAWNS);
+  _pid = pid;
+  setNonBlocking(_inFd);
+  setNonBlocking(_outFd);
+  _loop->watch(_inFd, this);
+  _loop->watch(_outFd, this);
+  _loop->reaper().watch(_pid, this);
+
+  _inBuf.clear();
+  _inOff = 0;
+  _rd.clear();
+  _frameLeft = 0;
+  _req = 0;
+  _busy = false;
+  _served = 0;
+  return true;
+}
+
+void CgiWorker::assign(CgiPoolRequest* r, const std::string& env) {
+  _busy = true;
+  _req = r;
+  _reqStdinDone = false;
+  ++_served;
+  r->_worker = this;
+  sendFrame(env.data(), env.size());
+}
+
+void CgiWorker::sendFrame(const char* data, size_t n) {
+  if (_inFd < 0) return;
+  if (_inOff == _inBuf.size()) { _inBuf.clear(); _inOff = 0; }
+  char len[24];
+  size_t p = sizeof(len);
+  len[--p] = '\n';
+  size_t v = n;
+  do { len[--p] = char('0' + v % 10); v /= 10; } while (v);
+  _inBuf.append(len + p, sizeof(len) - p);
+  _inBuf.append(data, n);
+}
+
+void CgiWorker::endStdin() {
+  if (_reqStdinDone) return;
+  _reqStdinDone = true;
+  sendFrame(0, 0);
+}
+
+void CgiWorker::abandon(CgiPoolRequest* r) {
+  endStdin(); // недочитанное тело скрипт увидит как конец ввода
+  if (_req == r) _req = 0;
+  r->_worker = 0;
+}
+
+short CgiWorker::ioEvents(int fd) const {
+  if (fd == _inFd) return stdinBacklog() ? POLLOUT : 0;
+  if (fd == _outFd) return (_req && _req->_out.size() >= CgiBackend::OUT_HIGH) ? 0 : POLLIN;
+  return 0;
+}
+
+void CgiWorker::onIo(int fd, short revents) {
+  if (fd == _inFd) {
+    if (!(revents & POLLOUT)) { die(); return; }
+    ssize_t n = ::write(_inFd, _inBuf.data() + _inOff, _inBuf.size() - _inOff);
+    if (n < 0 && ioTryAgain()) return;
+    if (n <= 0) { die(); return; }
+    _inOff += (size_t)n;
+    return;
+  }
+  if (fd != _outFd) return;
+
+  char buf[65536];
+  ssize_t n = ::read(_outFd, buf, sizeof(buf));
+  if (n < 0 && ioTryAgain()) return; // воркер жив, данных просто нет
+  if (n <= 0) { die(); return; }
+  _rd.append(buf, (size_t)n);
+  size_t before = _req ? _req->_out.size() : 0;
+  bool ended = false;
+  size_t off = 0;
+  while (off < _rd.size() && !ended) {
+    if (_frameLeft == 0) {
+      size_t nl = _rd.find('\n', off);
+      if (nl == std::string::npos) {
+        if (_rd.size() - off > 20) { die(); return; } // это не длина кадра
+        break;
+      }
+      size_t len = 0;
+      for (size_t i = off; i < nl; ++i) {
+        if (_rd[i] < '0' || _rd[i] > '9') { die(); return; }
+        len = len * 10 + (size_t)(_rd[i] - '0');
+      }
+      if (nl == off) { die(); return; }
+      off = nl + 1;
+      if (len == 0) ended = true;
+      _frameLeft = len;
+      continue;
+    }
+    size_t take = _rd.size() - off < _frameLeft ? _rd.size() - off : _frameLeft;
+    if (_req) _req->_out.append(_rd, off, take);
+    off += take;
+    _frameLeft -= take;
+  }
+  _rd.erase(0, off);
+
+  if (ended) {
+    endOfResponse();
+    return;
+  }
+  if (_req && _req->_out.size() != before) _req->_client->onCgiEvent(); // последним
+}
+
+void CgiWorker::endOfResponse() {
+  CgiPoolRequest* r = _req;
+  _req = 0;
+  _busy = false;
+  if (_served >= _loc->cgi_pool_max_requests && _inFd >= 0) {
+    // лимит: EOF на stdin — воркер выходит, die() поднимет замену
+    _loop->unwatch(_inFd);
+    ::close(_inFd);
+    _inFd = -1;
+  }
+  if (r) r->finish(); // последним
+}
+
+void CgiWorker::die() {
+  CgiPoolRequest* r = _req;
+  bool recycled = !_busy && _served >= _loc->cgi_pool_max_requests;
+  _req = 0;
+  _busy = false;
+  closeFds();
+  if (recycled) {
+    if (!start()) WS_LOG_WARN("cgi_pool: cannot respawn " + _loc->cgi_pool_worker);
+  } else {
+    // упал сам: поднимем лениво, на следующем запросе (без цикла падений)
+    WS_LOG_WARN("cgi_pool: worker " + _loc->cgi_pool_worker + " exited unexpectedly");
+  }
+  if (r) r->finish(); // что успело прийти — отдаст клиент; пусто -> 502
+}
+
+void CgiWorker::terminate() {
+  if (_pid <= 0) return;
+  ::kill(_pid, SIGTERM);
+  _loop->setTimer(this, CgiProcess::KILL_GRACE_MS);
+}
+
+void CgiWorker::onTimer() {
+  if (_pid > 0) ::kill(_pid, SIGKILL);
+}
+
+void CgiWorker::onChildExit(pid_t pid, int, const struct rusage& ru) {
+  if (_stats) _stats->addUsage(ru); // за всю жизнь воркера
+  if (pid != _pid) return;
+  _pid = -1;
+  _loop->cancelTimer(this);
+}
+
+void CgiWorker::closeFds() {
+  if (_inFd >= 0) {
+    _loop->unwatch(_inFd);
+    ::close(_inFd);
+    _inFd = -1;
+  }
+  if (_outFd >= 0) {
+    _loop->unwatch(_outFd);
+    ::close(_outFd);
+    _outFd = -1;
+  }
+}
+
+// ---------------- CgiPool ----------------
+
+CgiPool::~CgiPool() {
+  for (std::map<const Location*, std::vector<CgiWorker*> >::iterator it = _workers.begin();
+       it != _workers.end(); ++it)
+    for (size_t i = 0; i < it->second.size(); ++i) delete it->second[i];
+}
+
+void CgiPool::add(const Location* loc, EventLoop* loop, CgiStats* stats) {
+  std::vector<CgiWorker*>& v = _workers[loc];
+  for (size_t i = v.size(); i < loc->cgi_pool; ++i) {
+    CgiWorker* w = new CgiWorker(loop, loc, stats);
+    if (!w->start()) WS_LOG_WARN("cgi_pool: cannot spawn " + loc->cgi_pool_worker);
+    v.push_back(w);
+  }
+}
+
+CgiPoolRequest* CgiPool::open(const Location* loc, const std::string& env, CgiClient* client) {
+  std::map<const Location*, std::vector<CgiWorker*> >::iterator it = _workers.find(loc);
+  if (it == _workers.end()) return 0;
+  std::vector<CgiWorker*>& v = it->second;
+  CgiWorker* w = 0;
+  for (size_t i = 0; i < v.size() && !w; ++i)
+    if (v[i]->idle()) w = v[i];
+  for (size_t i = 0; i < v.size() && !w; ++i)
+    if (v[i]->dead() && v[i]->start()) w = v[i];
+  if (!w) return 0; // все заняты: запуск на запрос
+
+  CgiPoolRequest* r = new CgiPoolRequest(client);
+  w->assign(r, env);
+  return r;
+}
+
+} // namespace ws
@@ -0,0 +1,158 @@
+#include "webserv/net/CgiProcess.hpp"
+#include "webserv/net/EventLoop.hpp"
+#include "webserv/net/Listener.hpp"
+#include "webserv/utils/IO.hpp"
+#include "webserv/utils/Metrics.hpp"
+
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+namespace ws {
+
+CgiProcess::CgiProcess(EventLoop* loop, CgiClient* client, CgiStats* stats)
+  : _loop(loop), _client(client), _stats(stats), _pid(-1), _inFd(-1), _outFd(-1),
+    _inOff(0), _inEof(false), _inSplice(false), _inReady(false),
+    _outSplice(false), _outReady(false), _exited(false), _status(0) {}
+
+CgiProcess::~CgiProcess() {
+  _loop->cancelTimer(this);
+  closeIn();
+  closeOut();
+  if (_pid > 0 && !_exited) {
+    if (_loop) _loop->reaper().forget(_pid);
+    ::kill(_pid, SIGKILL); // клиент ушёл раньше скрипта; зомби соберёт ChildReaper
+  }
+}
+
+bool CgiProcess::start(const CgiLaunch& launch) {
+  pid_t pid = CgiHandler::spawn(launch, _inFd, _outFd);
+  if (pid < 0) return false;
+  Metrics::inc(Metrics::CGI_SPAWNS);
+  _pid = pid;
+  setNonBlocking(_inFd);
+  setNonBlocking(_outFd);
+
+  _loop->watch(_inFd, this);
+  _loop->watch(_outFd, this);
+  _loop->reaper().watch(_pid, this);
+  return true;
+}
+
+void CgiProcess::writeStdin(const char* data, size_t n) {
+  if (_inFd < 0 || n == 0) return; // скрипт закрыл stdin — тело ему не нужно
+  if (_inOff == _inBuf.size()) { _inBuf.clear(); _inOff = 0; }
+  _inBuf.append(data, n);
+}
+
+void CgiProcess::closeStdin() {
+  _inEof = true;
+  if (stdinBacklog() == 0) closeIn();
+}
+
+int CgiProcess::spliceStdin() {
+  if (_inFd < 0 || _inEof || stdinBacklog()) return -1; // порядок байт важнее
+  _inSplice = true;
+  _inReady = true; // пайп пуст — пробуем сразу
+  return _inFd;
+}
+
+int CgiProcess::spliceOutput() {
+  if (_outFd < 0 || !_out.empty()) return -1;
+#ifdef F_SETPIPE_SZ
+  ::fcntl(_outFd, F_SETPIPE_SZ, 1 << 20); // крупнее чанк — меньше системных вызовов; не вышло — не страшно
+#endif
+  _outSplice = true;
+  _outReady = false;
+  return _outFd;
+}
+
+short CgiProcess::ioEvents(int fd) const {
+  if (fd == _outFd) {
+    if (_outSplice) return _outReady ? 0 : POLLIN;
+    return _out.size() < OUT_HIGH ? POLLIN : 0;
+  }
+  if (fd == _inFd) {
+    if (_inSplice) return _inReady ? 0 : POLLOUT;
+    return stdinBacklog() ? POLLOUT : 0;
+  }
+  return 0;
+}
+
+void CgiProcess::flushStdin() {
+  ssize_t n = ::write(_inFd, _inBuf.data() + _inOff, _inBuf.size() - _inOff);
+  if (n < 0 && ioTryAgain()) return; // пайп полон: до следующего POLLOUT
+  if (n <= 0) {
+    closeIn(); // EPIPE и т.п.: скрипт не читает stdin
+    return;
+  }
+  _inOff += (size_t)n;
+  if (_inOff == _inBuf.size()) {
+    _inBuf.clear();
+    _inOff = 0;
+    if (_inEof) closeIn();
+  }
+}
+
+void CgiProcess::onIo(int fd, short revents) {
+  if (fd == _inFd && _inSplice) {
+    if (revents & POLLOUT) _inReady = true;
+    else closeIn(); // скрипт закрыл stdin
+    _client->onCgiEvent(); // последним
+    return;
+  }
+  if (fd == _inFd) {
+    if (revents & POLLOUT) flushStdin();
+    else closeIn();
+    return;
+  }
+  if (fd != _outFd) return;
+  if (_outSplice) {
+    _outReady = true; // читать будет клиент
+    _client->onCgiEvent(); // последним
+    return;
+  }
+
+  char buf[65536];
+  ssize_t n = ::read(_outFd, buf, sizeof(buf));
+  if (n < 0 && ioTryAgain()) return; // данных нет: это не EOF
+  if (n > 0) _out.append(buf, (size_t)n);
+  else closeOut();
+  _client->onCgiEvent(); // последним: клиент может удалить нас
+}
+
+void CgiProcess::terminate() {
+  if (_pid <= 0 || _exited) return;
+  ::kill(_pid, SIGTERM);
+  _loop->setTimer(this, KILL_GRACE_MS);
+}
+
+void CgiProcess::onTimer() {
+  if (_pid > 0 && !_exited) ::kill(_pid, SIGKILL); // SIGTERM проигнорирован
+}
+
+void CgiProcess::onChildExit(pid_t, int status, const struct rusage& ru) {
+  _exited = true;
+  _status = status;
+  _loop->cancelTimer(this);
+  if (_stats) _stats->addUsage(ru);
+}
+
+void CgiProcess::closeIn() {
+  if (_inFd < 0) return;
+  _loop->unwatch(_inFd);
+  ::close(_inFd);
+  _inFd = -1;
+  _inBuf.clear();
+  _inOff = 0;
+}
+
+void CgiProcess::closeOut() {
+  if (_outFd < 0) return;
+  _loop->unwatch(_outFd);
+  ::close(_outFd);
+  _outFd = -1;
+}
+
+} // namespace ws
@@ -0,0 +1,75 @@
+#include "webserv/net/ChildReaper.hpp"
+#include "webserv/net/Listener.hpp"
+
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <cstring>
+
+namespace ws {
+
+// write-конец self-pipe: единственное, что трогает обработчик сигнала
+static volatile int g_sigchldWr = -1;
+
+extern "C" void ws_onSigchld(int) {
+  if (g_sigchldWr >= 0) {
+    char b = 1;
+    ssize_t r = ::write(g_sigchldWr, &b, 1); // pipe переполнен — не страшно, байт уже есть
+    (void)r;
+  }
+}
+
+ChildReaper::ChildReaper() : _rd(-1) {}
+
+ChildReaper::~ChildReaper() {
+  if (_rd >= 0) {
+    ::signal(SIGCHLD, SIG_DFL);
+    int wr = g_sigchldWr;
+    g_sigchldWr = -1;
+    ::close(wr);
+    ::close(_rd);
+  }
+}
+
+bool ChildReaper::open() {
+  if (_rd >= 0) return true;
+  int p[2];
+  if (::pipe(p) != 0) return false;
+  setNonBlocking(p[0]); setNonBlocking(p[1]);
+  setCloseOnExec(p[0]); setCloseOnExec(p[1]);
+  _rd = p[0];
+  g_sigchldWr = p[1];
+
+  struct sigaction sa;
+  std::memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = ws_onSigchld;
+  sigemptyset(&sa.sa_mask);
+  sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+  return ::sigaction(SIGCHLD, &sa, 0) == 0;
+}
+
+short ChildReaper::ioEvents(int) const { return POLLIN; }
+
+void ChildReaper::onIo(int, short) {
+  char buf[64];
+  while (::read(_rd, buf, sizeof(buf)) > 0) {}
+  reap();
+}
+
+void ChildReaper::reap() {
+  for (;;) {
+    int status = 0;
+    struct rusage ru;
+    std::memset(&ru, 0, sizeof(ru));
+    pid_t pid = ::wait4(-1, &status, WNOHANG, &ru); // как waitpid, плюс CPU ребёнка
+    if (pid <= 0) return;
+    std::map<pid_t, ChildListener*>::iterator it = _listeners.find(pid);
+    if (it == _listeners.end()) continue;
+    ChildListener* l = it->second;
+    _listeners.erase(it); // до вызова: слушатель может сам себя удалить
+    l->onChildExit(pid, status, ru);
+  }
+}
+
+} // namespace ws
@@ -8,6 +8,7 @@
 #include <map>
 #include <vector>
 #include <unistd.h>
+#include <fcntl.h>
 #include <ctime>
 
 #include "webserv/http/Router.hpp"
@@ -16,24 +17,20 @@
 #include "webserv/http/Cgi.hpp"
 #include "webserv/utils/Time.hpp"
 #include "webserv/utils/IO.hpp"
+#include "webserv/fs/Path.hpp"
 #include "webserv/net/ResponseBuilder.hpp"
 #include "webserv/net/UploadHandler.hpp"
+#include "webserv/http/Multipart.hpp"
 #include "webserv/net/DeleteHandler.hpp"
 #include "webserv/net/MethodGate.hpp"
+#include "webserv/net/CgiProcess.hpp"
+#include "webserv/net/EventLoop.hpp"
+#include "webserv/net/StatusPage.hpp"
 
 namespace ws
 {
-    static std::string itoa10(int x) { std::ostringstream oss; oss << x; return oss.str(); }
 
-    static const ServerConfig* pickDefaultServer(const Router* router,
-                                                 const std::string& lhost, int lport)
-    {
-        if (!router) return 0;
-        RouteMatch tmp = router->resolve(lhost, lport, "", "/");
-        return tmp.server;
-    }
 
-    static std::string hexLower(size_t x) { std::ostringstream oss; oss << std::hex << std::nouppercase << x; return oss.str(); }
 
     static std::string genUploadName()
     {
@@ -44,6 +41,51 @@ namespace ws
         return oss.str();
     }
 
+    // блокирующая работа с ФС для aio threads: run() — в потоке пула,
+    // результат разбирает onAioDone() уже в цикле
+    struct FsTask : public AioTask
+    {
+        enum Kind { STAT, UPLOAD };
+        Kind kind;
+        RouteMatch m;
+        HttpRequest req;             // STAT
+        StaticResult res;            // STAT; UPLOAD: res.location — URL файла
+        bool handled;                // STAT: ответил handleGET
+        int fd;                      // STAT: уже открытое тело ответа
+        std::string dir, path, data; // UPLOAD
+        int code;                    // UPLOAD: 0 — ошибка; DELETE: как у handleDelete
+
+        static const size_t READAHEAD = 2u << 20;
+
+        FsTask(Kind k, const RouteMatch& rm) : kind(k), m(rm), handled(false), fd(-1), code(0) {}
+        ~FsTask() { if (fd >= 0) ::close(fd); }
+
+        void run()
+        {
+            if (kind == UPLOAD)
+            {
+                code = ws::ensureDirRecursive(dir) && ws::writeBinary(path, data) ? 201 : 0;
+                return;
+            }
+            // тот же порядок, что в handleRequest: статика, затем DELETE
+            handled = StaticHandler::handleGET(*m.server, m.location, req, res);
+            if (!handled)
+            {
+                if (req.method_id == M_DELETE) code = ws::handleDelete(m, req);
+                return;
+            }
+            if (res.filePath.empty() || !res.contentLength || req.method_id == M_HEAD || res.status == 404)
+                return;
+            fd = ::open(res.filePath.c_str(), O_RDONLY);
+#ifdef __linux__
+            // начало файла — в page cache здесь, чтобы sendfile() в цикле не ждал диск
+            if (fd >= 0)
+                ::readahead(fd, (off_t)res.fileOffset,
+                            res.contentLength < READAHEAD ? res.contentLength : (size_t)READAHEAD);
+#endif
+        }
+    };
+
     bool Connection::shouldKeepAlive(const HttpRequest& r) const
     {
         std::string ver = r.version;
@@ -55,22 +97,100 @@ namespace ws
         return ka;
     }
 
-    Connection::~Connection() { if (_fd >= 0) ::close(_fd); }
+    void Connection::bindRoutes()
+    {
+        if (!_router) return;
+        _routes = _router->listenerRoutes(_lhost, _lport);
+        _defSrv = _router->defaultServer(_routes);
+    }
+
+    Connection::~Connection()
+    {
+        dropCgi(); // слот/очередь location и таймер тоже
+        closeFile();
+        dropUpload();
+        endPatch(); // дошедшее до обрыва сохраняется в индексе
+        if (_aio) _loop->aio().cancel(_aio); // задача доработает, результат выбросим
+        if (_durable) _loop->commits().cancel(_durable);
+        if (_fd >= 0) ::close(_fd);
+        setIdle(false);
+        Metrics::gauge(Metrics::CONN_ACTIVE, -1);
+    }
+
+    void Connection::noteRoute(const RouteMatch& m)
+    {
+        _latSrv = m.server;
+        _latLoc = m.location;
+    }
+
+    void Connection::requestDone()
+    {
+        if (!_reqStartUs) return;
+        const ServerConfig* srv = _latSrv ? _latSrv : _defSrv;
+        const size_t slot = _latLoc ? _latLoc->stats_slot : srv ? srv->stats_slot : (size_t)-1;
+        const long long now = ws::monotonicUs();
+        const long long ttfb = _ttfbUs ? _ttfbUs : now;
+        AccessEntry e;
+        e.peer = &_peer;
+        e.req = &_req;
+        e.status = _status;
+        e.bytes = _sentBytes;
+        e.totalUs = (unsigned long long)(now - _reqStartUs);
+        e.ttfbUs = (unsigned long long)(ttfb - _reqStartUs);
+        Metrics::latency(slot, e.totalUs, e.ttfbUs);
+        WS_LOG_DEBUG(_req.method + " " + _req.target + " -> " + Log::num(_status) + ", "
+                     + Log::num((long long)e.bytes) + " bytes, " + Log::num((long long)e.totalUs) + " us");
+        _loop->accessLog().log(slot, e);
+        _reqStartUs = _ttfbUs = 0;
+        _sentBytes = 0;
+        _latSrv = 0;
+        _latLoc = 0;
+    }
+
+    void Connection::setIdle(bool idle)
+    {
+        if (idle == _idle) return;
+        _idle = idle;
+        Metrics::gauge(Metrics::CONN_IDLE, idle ? 1 : -1);
+    }
 
     void Connection::closeNow()
     {
+        if (_fd >= 0) WS_LOG_DEBUG("close fd " + Log::num(_fd) + " after " + Log::num(_reqsOnConn) + " requests");
         if (_fd >= 0) { ::close(_fd); _fd = -1; }
+        dropCgi();
+        closeFile();
+        dropUpload();
+        endPatch();
+        if (_durable) { _loop->commits().cancel(_durable); _durable = 0; }
         _state = CLOSED;
     }
 
-    short Connection::wantEvents() const { return _state == READ ? POLLIN : (_state == WRITE ? POLLOUT : 0); }
+    void Connection::onHangup()
+    {
+        if (_state != CLOSED) closeNow();
+    }
+
+    short Connection::wantEvents() const
+    {
+        if (_state == READ || _state == UPLOAD) return _interim ? (POLLIN | POLLOUT) : POLLIN;
+        if (_state == WRITE) return POLLOUT;
+        if (_state != CGI) return 0;
+        // CGI: читаем тело, пока stdin скрипта успевает его забирать,
+        // и пишем уже готовые куски вывода
+        short ev = (_out.empty() && !_spliceLeft) ? 0 : POLLOUT;
+        if (_cgiBody && (_spliceInFd >= 0 ? _cgi->stdinReady()
+                                          : _cgi->stdinBacklog() < CGI_STDIN_BACKLOG))
+            ev |= POLLIN;
+        return ev;
+    }
 
     void Connection::makeResponse(int code, const std::string& reason,
                                   const std::string& ctype,
                                   const std::string& body,
                                   const std::string& location)
     {
-        const bool isHead = (_req.method == "HEAD");
+        const bool isHead = (_req.method_id == M_HEAD);
         const size_t len = isHead ? 0 : body.size();
         makeResponseHeaders(code, reason, ctype, len, location, "");
         if (!isHead) _out += body;
@@ -81,270 +201,1229 @@ namespace ws
                                          const std::string& location,
                                          const std::string& extra)
     {
-        _out.clear();
-        std::ostringstream oss;
-        oss << "HTTP/1.1 " << code << ' ' << reason << "\r\n"
-            << "Server: webserv-dev\r\n"
-            << "Date: " << ws::httpDateNow() << "\r\n"
-            << "Content-Type: " << ctype << "\r\n"
-            << "Content-Length: " << (int)clen << "\r\n"
-            << "Connection: " << (_curKeepAlive ? "keep-alive" : "close") << "\r\n";
-        if (_curKeepAlive) oss << "Keep-Alive: timeout=5, max=100\r\n";
-        if (!location.empty()) oss << "Location: " << location << "\r\n";
-        if (!extra.empty())    oss << extra;
-        oss << "\r\n";
-        _out = oss.str();
+        _out.erase(_interim); // ёмкость буфера сохраняется между ответами; 100 Continue — дослать
+        _status = code;
+        ws::appendHeaders(_out, code, reason, ctype, clen, _curKeepAlive, location, extra);
         _state = WRITE;
     }
 
-    void Connection::makeErrorWithPages(int code, const ServerConfig* srv)
+    void Connection::makeMethodNotAllowed(const Location* loc)
     {
-        std::string reason = (code == 400 ? "Bad Request" : code == 411 ? "Length Required"
-                                   : code == 413 ? "Payload Too Large"
-                                   : code == 501 ? "Not Implemented" : "Error");
-        std::string body;
-        std::string ctype = "text/plain; charset=utf-8";
+        std::string extra = "Allow: ";
+        extra += ws::buildAllowHeader(loc);
+        extra += "\r\n";
+        makeResponseHeaders(405, "Method Not Allowed", "text/plain; charset=utf-8", 0, "", extra);
+    }
 
-        if (srv)
+    void Connection::makeErrorWithPages(int code, const ServerConfig* srv, const char* extra)
+    {
+        const CannedResponse* r = _errorPages ? _errorPages->find(srv, code) : 0;
+        if (r)
         {
-            std::map<int, std::string>::const_iterator it = srv->error_pages.find(code);
-            if (it != srv->error_pages.end())
-            {
-                std::string fs = it->second;
-                if (!srv->root.empty() && (fs.size() < 2 || fs.substr(0, 2) != "./"))
-                    fs = srv->root + "/" + fs;
-                if (ws::readWholeFile(fs, body))
-                {
-                    ctype = "text/html; charset=utf-8";
-                    makeResponse(code, reason, ctype, body);
-                    return;
-                }
-            }
+            _out.erase(_interim);
+            _status = r->code;
+            ErrorPages::append(_out, *r, _curKeepAlive, _req.method_id == M_HEAD, extra);
+            _state = WRITE;
+            return;
         }
-        body = itoa10(code) + " " + reason + "\n";
-        makeResponse(code, reason, ctype, body);
+        // код вне кэша: простой текстовый ответ
+        const std::string reason = ws::reasonPhrase(code);
+        std::string body;
+        ws::appendUint(body, (unsigned long long)code);
+        body += ' ';
+        body += reason;
+        body += '\n';
+        makeResponse(code, reason, "text/plain; charset=utf-8", body);
     }
 
-    void Connection::makeChunkedResponse(int code, const std::string& reason,
-                                         const std::string& ctype,
-                                         const std::string& body,
-                                         const std::string& extra)
+    // лимит тела запроса (client_max_body_size): location > server > 10M
+    static size_t bodyLimit(const RouteMatch& m)
     {
-        std::ostringstream oss;
-        oss << "HTTP/1.1 " << code << ' ' << reason << "\r\n"
-            << "Server: webserv-dev\r\n"
-            << "Content-Type: " << ctype << "\r\n"
-            << "Transfer-Encoding: chunked\r\n"
-            << "Connection: " << (_curKeepAlive ? "keep-alive" : "close") << "\r\n";
-        if (_curKeepAlive) oss << "Keep-Alive: timeout=5, max=100\r\n";
-        if (!extra.empty())  oss << extra;
-        oss << "\r\n";
-        oss << hexLower(body.size()) << "\r\n";
-        oss << body << "\r\n";
-        oss << "0\r\n\r\n";
-        _out = oss.str();
-        _state = WRITE;
+        if (m.location && m.location->client_max_body_size) return m.location->client_max_body_size;
+        if (m.server && m.server->client_max_body_size) return m.server->client_max_body_size;
+        return 10 * 1024 * 1024;
+    }
+
+    static std::string uploadDir(const RouteMatch& m)
+    {
+        std::string serverRoot = (m.server && !m.server->root.empty()) ? m.server->root : std::string(".");
+        std::string updir = m.location->upload_store;
+        if (!updir.empty() && updir[0] != '/')
+            updir = (serverRoot.back() == '/' ? serverRoot + updir : serverRoot + "/" + updir);
+        return updir;
     }
 
     bool Connection::handlePostUpload(const RouteMatch& m)
 {
-    if (_req.method != "POST" || !m.location || !m.location->upload_enable || m.location->upload_store.empty())
+    if (_req.method_id != M_POST || !m.location || !m.location->upload_enable || m.location->upload_store.empty())
         return false;
 
-    size_t limit = 10 * 1024 * 1024;
-    if (m.location->client_max_body_size)                   limit = m.location->client_max_body_size;
-    else if (m.server && m.server->client_max_body_size)    limit = m.server->client_max_body_size;
-
-    if (_req.body.size() > limit) {
+    if (_req.body.size() > bodyLimit(m)) {
         makeErrorWithPages(413, m.server);
         return true;
     }
 
-    std::string serverRoot = (m.server && !m.server->root.empty()) ? m.server->root : std::string(".");
-    std::string updir = m.location->upload_store;
-    if (!updir.empty() && updir[0] != '/')
-        updir = (serverRoot.back() == '/' ? serverRoot + updir : serverRoot + "/" + updir);
+    _uploadSrv = m.server; // для 500, если fsync не удастся
+    const std::string updir = uploadDir(m);
+    const std::string fileName = genUploadName();           // если нужно, замени на ws::genUploadName()
+    const std::string outPath  = updir + "/" + fileName;
+    const std::string locationHdr = "/uploads/" + fileName;
+
+    if (m.location->aio_threads)
+    {
+        FsTask* t = new FsTask(FsTask::UPLOAD, m);
+        t->dir = updir;
+        t->path = outPath;
+        t->data.swap(_req.body);
+        t->res.location = locationHdr;
+        offload(t);
+        return true;
+    }
 
-    if (!ws::ensureDirRecursive(updir)) {
+    if (!ws::ensureDirRecursive(updir) || !ws::writeBinary(outPath, _req.body)) {
         makeResponse(500, "Internal Server Error", "text/plain; charset=utf-8", "500 Internal Server Error\n");
         return true;
     }
+    sendUploaded(locationHdr);
+    awaitDurable(m.location, std::vector<std::string>(1, outPath), updir);
+    return true;
+}
 
-    const std::string fileName = genUploadName();           // если нужно, замени на ws::genUploadName()
-    const std::string outPath  = updir + "/" + fileName;
+    bool Connection::isUploadStream(const RouteMatch& m, std::string& boundary) const
+    {
+        if (!m.server || !m.location || m.location->internal) return false;
+        if (_req.method_id != M_POST || !ws::isAllowed(m.location, M_POST)) return false;
+        if (m.location->return_code >= 300 && m.location->return_code < 400 && !m.location->return_url.empty()) return false;
+        if (!m.location->upload_enable || m.location->upload_store.empty()) return false;
+        return ws::multipartBoundary(_req.getHeader("content-type"), boundary);
+    }
 
-    if (!ws::writeBinary(outPath, _req.body)) {
-        makeResponse(500, "Internal Server Error", "text/plain; charset=utf-8", "500 Internal Server Error\n");
+    void Connection::startUpload(const RouteMatch& m, const std::string& boundary)
+    {
+        _uploadSrv = m.server;
+        _uploadLoc = m.location;
+        _uploadLeft = bodyLimit(m);
+        _upload = new MultipartUpload(boundary, uploadDir(m), genUploadName(), "/uploads/");
+        if (!_upload->open())
+        {
+            failUpload(500);
+            return;
+        }
+        _state = UPLOAD;
+        pumpUpload(); // часть тела могла прийти вместе с заголовками
+    }
+
+    void Connection::pumpUpload()
+    {
+        std::string chunk;
+        HttpParser::Result r = _parser.readBody(chunk);
+        if (chunk.size() > _uploadLeft) { failUpload(413); return; }
+        _uploadLeft -= chunk.size();
+        if (!chunk.empty() && !_upload->feed(chunk.data(), chunk.size()))
+        {
+            failUpload(_upload->writeFailed() ? 500 : 400);
+            return;
+        }
+        if (r == HttpParser::NEED_MORE) return;
+        if (r != HttpParser::OK) { failUpload(r == HttpParser::ENTITY_TOO_LARGE ? 413 : 400); return; }
+        if (!_upload->complete()) { failUpload(400); return; } // нет закрывающего --boundary--
+
+        std::string json = _upload->commit();
+        std::string location = _upload->firstUrl();
+        const std::vector<std::string> files = _upload->paths();
+        const std::string dir = _upload->dir();
+        dropUpload();
+        makeResponseHeaders(201, "Created", "application/json; charset=utf-8", json.size(), location, "");
+        _out += json;
+        awaitDurable(_uploadLoc, files, dir);
+    }
+
+    void Connection::failUpload(int code)
+    {
+        dropUpload(); // уже записанные части удаляются
+        _curKeepAlive = false; // остаток тела (если есть) не дочитан
+        makeErrorWithPages(code, _uploadSrv);
+    }
+
+    void Connection::dropUpload()
+    {
+        delete _upload;
+        _upload = 0;
+    }
+
+    // ---- возобновляемые загрузки (tus 1.0): POST + Upload-Length создаёт сессию
+    // <location>/<id>, HEAD сообщает Upload-Offset, PATCH дописывает с него ----
+
+    static const char kTus[] = "Tus-Resumable: 1.0.0\r\n";
+    static const unsigned long long PATCH_SAVE_EVERY = 4u << 20; // прогресс в индекс
+
+    static bool parseOffset(const std::string& s, unsigned long long& v)
+    {
+        if (s.empty() || s.size() > 19) return false;
+        v = 0;
+        for (size_t i = 0; i < s.size(); ++i)
+        {
+            if (s[i] < '0' || s[i] > '9') return false;
+            v = v * 10 + (unsigned long long)(s[i] - '0');
+        }
         return true;
     }
 
-    const std::string locationHdr = "/uploads/" + fileName;
+    static std::string sessionUrl(const Location* loc, const std::string& id)
+    {
+        std::string url = loc->path;
+        if (url.empty() || url[url.size() - 1] != '/') url += '/';
+        return url + id;
+    }
 
-    makeResponseHeaders(201, "Created", "text/plain; charset=utf-8", 12, locationHdr, "");
-    if (_req.method != "HEAD")
-        _out += "201 Created\n";
-    _state = WRITE;
-    return true;
-}
+    bool Connection::sessionTarget(const RouteMatch& m, std::string& id) const
+    {
+        if (!m.location || m.location->match != LOC_PREFIX || !m.location->upload_enable
+            || m.location->upload_store.empty())
+            return false;
+        std::string path = StaticHandler::pathOnly(_req.getRawTarget().empty() ? _req.target : _req.getRawTarget());
+        std::string base = sessionUrl(m.location, "");
+        if (path.size() <= base.size() || path.compare(0, base.size(), base) != 0) return false;
+        id = path.substr(base.size());
+        for (size_t i = 0; i < id.size(); ++i)
+        {
+            char c = id[i];
+            if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_'))
+                return false;
+        }
+        return true;
+    }
 
-    void Connection::onReadable()
+    int Connection::patchCheck(const UploadSession* u) const
     {
-        if (_state != READ) return;
+        if (!u) return 404;
+        if (u->busy) return 409; // в неё уже пишет другой PATCH
+        if (_req.getHeader("content-type") != "application/offset+octet-stream") return 415;
+        unsigned long long off;
+        if (!parseOffset(_req.getHeader("upload-offset"), off)) return 400;
+        return off == u->offset ? 0 : 409;
+    }
 
-        char buf[8192];
-        for (;;)
+    bool Connection::handleResumable(const RouteMatch& m)
+    {
+        if (!m.location || !m.location->upload_enable || m.location->upload_store.empty()) return false;
+        const std::string dir = uploadDir(m);
+        _uploadSrv = m.server;
+
+        if (_req.method_id == M_POST && _req.hasHeader("upload-length"))
         {
-            ssize_t n = ::recv(_fd, buf, sizeof(buf), 0);
-            if (n > 0)
+            unsigned long long len;
+            if (!parseOffset(_req.getHeader("upload-length"), len)) { makeErrorWithPages(400, m.server); return true; }
+            if (len > bodyLimit(m)) { makeErrorWithPages(413, m.server); return true; }
+            const std::string id = genUploadName();
+            if (!_loop->uploads().create(dir, id, len)) { makeErrorWithPages(500, m.server); return true; }
+            std::string extra = kTus;
+            extra += "Upload-Offset: 0\r\n";
+            makeResponseHeaders(201, "Created", "text/plain; charset=utf-8", 0, sessionUrl(m.location, id), extra);
+            return true;
+        }
+
+        std::string id;
+        if ((_req.method_id != M_HEAD && _req.method_id != M_PATCH) || !sessionTarget(m, id)) return false;
+        UploadSession* u = _loop->uploads().find(dir, id);
+        if (_req.method_id == M_PATCH)
+        {
+            // PATCH без тела; с телом он приходит в startPatch()
+            int code = patchCheck(u);
+            if (code) makeErrorWithPages(code, m.server);
+            else sendPatched(m.location, dir, id, u);
+            return true;
+        }
+        if (!u) { makeErrorWithPages(404, m.server); return true; }
+        std::string extra = kTus;
+        extra += "Upload-Offset: ";
+        ws::appendUint(extra, u->offset);
+        extra += "\r\nUpload-Length: ";
+        ws::appendUint(extra, u->length);
+        extra += "\r\nCache-Control: no-store\r\n";
+        makeResponseHeaders(200, "OK", "text/plain; charset=utf-8", 0, "", extra);
+        return true;
+    }
+
+    bool Connection::isPatchStream(const RouteMatch& m, std::string& id) const
+    {
+        if (!m.server || !m.location || m.location->internal) return false;
+        if (_req.method_id != M_PATCH || !ws::isAllowed(m.location, M_PATCH)) return false;
+        if (m.location->return_code >= 300 && m.location->return_code < 400 && !m.location->return_url.empty()) return false;
+        return sessionTarget(m, id);
+    }
+
+    void Connection::startPatch(const RouteMatch& m, const std::string& id)
+    {
+        _uploadSrv = m.server;
+        _uploadLoc = m.location;
+        _patchDir = uploadDir(m);
+        _patchId = id;
+        UploadSession* u = _loop->uploads().find(_patchDir, id);
+        int code = patchCheck(u);
+        if (code)
+        {
+            _curKeepAlive = false; // тело не читаем
+            makeErrorWithPages(code, m.server);
+            return;
+        }
+        _patchFd = ::open(ResumableUploads::partPath(_patchDir, id).c_str(), O_WRONLY);
+        if (_patchFd < 0)
+        {
+            _curKeepAlive = false;
+            makeErrorWithPages(500, m.server);
+            return;
+        }
+        _patch = u;
+        _patch->busy = true;
+        _patchSaved = u->offset;
+        _state = UPLOAD;
+        pumpPatch();
+    }
+
+    void Connection::pumpPatch()
+    {
+        std::string chunk;
+        HttpParser::Result r = _parser.readBody(chunk);
+        if (chunk.size() > _patch->length - _patch->offset) { failPatch(413); return; }
+        // прямо в файл с текущего смещения; прогресс считается по записанному
+        const char* p = chunk.data();
+        size_t left = chunk.size();
+        while (left)
+        {
+            ssize_t n = ::pwrite(_patchFd, p, left, (off_t)_patch->offset);
+            if (n <= 0) { failPatch(500); return; }
+            p += n;
+            left -= (size_t)n;
+            _patch->offset += (unsigned long long)n;
+        }
+        if (_patch->offset - _patchSaved >= PATCH_SAVE_EVERY)
+        {
+            _patch->touched = (long long)std::time(0);
+            _loop->uploads().save(_patchDir); // обрыв соединения не потеряет больше этого
+            _patchSaved = _patch->offset;
+        }
+        if (r == HttpParser::NEED_MORE) return;
+        if (r != HttpParser::OK) { failPatch(r == HttpParser::ENTITY_TOO_LARGE ? 413 : 400); return; }
+
+        UploadSession* u = _patch;
+        endPatch();
+        sendPatched(_uploadLoc, _patchDir, _patchId, u);
+    }
+
+    void Connection::sendPatched(const Location* loc, const std::string& dir, const std::string& id, UploadSession* u)
+    {
+        std::string extra = kTus;
+        extra += "Upload-Offset: ";
+        ws::appendUint(extra, u->offset);
+        extra += "\r\n";
+        std::string file = ResumableUploads::partPath(dir, id);
+        if (u->offset == u->length)
+        {
+            // последний байт: файл публикуется под своим именем, сессия забывается
+            if (!_loop->uploads().finish(dir, id)) { makeErrorWithPages(500, _uploadSrv); return; }
+            extra += "Content-Location: /uploads/" + id + "\r\n";
+            file = dir + "/" + id;
+        }
+        makeResponseHeaders(204, "No Content", "text/plain; charset=utf-8", 0, "", extra);
+        awaitDurable(loc, std::vector<std::string>(1, file), dir);
+    }
+
+    void Connection::failPatch(int code)
+    {
+        endPatch(); // записанное до ошибки остаётся: клиент продолжит с Upload-Offset
+        _curKeepAlive = false;
+        makeErrorWithPages(code, _uploadSrv);
+    }
+
+    void Connection::endPatch()
+    {
+        if (!_patch) return;
+        ::close(_patchFd);
+        _patchFd = -1;
+        _patch->busy = false;
+        _patch->touched = (long long)std::time(0);
+        _patch = 0;
+        _loop->uploads().save(_patchDir);
+    }
+
+    void Connection::sendUploaded(const std::string& locationHdr)
+    {
+        makeResponseHeaders(201, "Created", "text/plain; charset=utf-8", 12, locationHdr, "");
+        if (_req.method_id != M_HEAD)
+            _out += "201 Created\n";
+    }
+
+    // upload_durability group: готовый ответ (уже в _out) уходит только после
+    // fdatasync файлов и fsync каталога, общих с другими загрузками
+    void Connection::awaitDurable(const Location* loc, const std::vector<std::string>& files,
+                                  const std::string& dir)
+    {
+        if (!loc || !loc->upload_durable || _state != WRITE) return;
+        _state = PROCESS;
+        _durable = _loop->commits().request(this, files, dir, loc->upload_sync_delay, loc->upload_sync_batch);
+    }
+
+    void Connection::onDurable(bool ok)
+    {
+        _durable = 0;
+        if (ok) { _state = WRITE; return; }
+        // подтверждать нечего: данные могут не пережить сбой
+        _curKeepAlive = false;
+        makeErrorWithPages(500, _uploadSrv);
+    }
+
+    void Connection::offload(FsTask* t)
+    {
+        if (_loop->aio().submit(t, this))
+        {
+            _aio = t;
+            _state = PROCESS; // ответ соберёт onAioDone()
+            return;
+        }
+        t->run(); // пул не запущен или его очередь полна — в цикле, как без aio
+        onAioDone(t);
+        delete t;
+    }
+
+    void Connection::onAioDone(AioTask* at)
+    {
+        FsTask* t = static_cast<FsTask*>(at);
+        _aio = 0;
+        if (t->kind == FsTask::UPLOAD)
+        {
+            if (t->code)
+            {
+                sendUploaded(t->res.location);
+                awaitDurable(t->m.location, std::vector<std::string>(1, t->path), t->dir);
+            }
+            else makeResponse(500, "Internal Server Error", "text/plain; charset=utf-8", "500 Internal Server Error\n");
+        }
+        else if (t->handled)
+        {
+            int fd = t->fd;
+            t->fd = -1; // теперь наш
+            staticDone(t->res, t->m, fd);
+        }
+        else if (!(_req.method_id == M_DELETE && sendDeleted(t->code, t->m.server)))
+            sendEcho();
+    }
+
+    bool Connection::isCgiRoute(const RouteMatch& m) const
+    {
+        if (!m.server || !m.location) return false;
+        if (m.location->internal) return false;
+        if (!ws::isImplemented(_req.method_id) || !ws::isAllowed(m.location, _req.method_id)) return false;
+        if (m.location->return_code >= 300 && m.location->return_code < 400 && !m.location->return_url.empty()) return false;
+        if (_req.method_id == M_POST && m.location->upload_enable && !m.location->upload_store.empty()) return false;
+        return CgiHandler::matches(m.location, _req);
+    }
+
+    // Retry-After для 503 из-за переполненной очереди CGI
+    static const char kCgiRetryAfter[] = "Retry-After: 1\r\n";
+
+    void Connection::startCgi(const RouteMatch& m, bool streaming)
+    {
+        _cgiSrv = m.server;
+        _cgiLoc = m.location;
+        _cgiStreaming = streaming;
+        _cgiHeaders = false;
+        _cgiTimedOut = false;
+        _cgiDeadline = 0;
+        admitCgi(true);
+    }
+
+    void Connection::admitCgi(bool cacheLock)
+    {
+        ResponseCache::Lookup c = cacheLookup(_cgiLoc, cacheLock);
+        if (c == ResponseCache::WAIT) return; // onCacheReady()
+        if (c == ResponseCache::HIT)
+        {
+            if (_cgiStreaming) _curKeepAlive = false; // тело осталось непрочитанным
+            return;
+        }
+
+        const Location* loc = _cgiLoc;
+        switch (_loop->cgiLimits().acquire(loc, this))
+        {
+        case CgiLimits::RUN:
+            _cgiSlot = true;
+            launchCgi();
+            return;
+        case CgiLimits::QUEUED:
+            // ждём слот, не читая тело; ожидание тоже ограничено cgi_timeout
+            _cgiQueued = true;
+            _state = CGI;
+            if (loc->cgi_timeout)
             {
-                _parser.feed(buf, (size_t)n);
+                _cgiDeadline = ws::monotonicMs() + (long long)loc->cgi_timeout * 1000;
+                _loop->setTimer(this, (long long)loc->cgi_timeout * 1000);
+            }
+            return;
+        case CgiLimits::FULL:
+            break;
+        }
+        cacheRelease(); // ждущие того же ответа попробуют сами
+        if (_cgiStreaming) _curKeepAlive = false; // тело осталось непрочитанным
+        makeErrorWithPages(503, _cgiSrv, kCgiRetryAfter);
+    }
+
+    void Connection::onCacheReady()
+    {
+        _cacheWait = false;
+        // не попали — ответ не кэшируется (или производитель сорвался):
+        // идём к скрипту сразу, без новой очереди друг за другом
+        admitCgi(false);
+    }
+
+    static long long cacheTtlMs(const Location* loc, int status)
+    {
+        std::map<int, size_t>::const_iterator it = loc->cache_valid.find(status);
+        return it == loc->cache_valid.end() ? 0 : (long long)it->second * 1000;
+    }
+
+    // Cache-Control: no-store/private или Set-Cookie — ответ только этому клиенту
+    static bool cgiCacheable(const CgiResult& cgi)
+    {
+        if (cgi.headers.count("set-cookie")) return false;
+        std::map<std::string, std::string>::const_iterator cc = cgi.headers.find("cache-control");
+        if (cc == cgi.headers.end()) return true;
+        std::string v = cc->second;
+        for (size_t i = 0; i < v.size(); ++i)
+            if (v[i] >= 'A' && v[i] <= 'Z') v[i] = char(v[i] - 'A' + 'a');
+        return v.find("no-store") == std::string::npos && v.find("private") == std::string::npos;
+    }
+
+    ResponseCache::Lookup Connection::cacheLookup(const Location* loc, bool lock)
+    {
+        _cacheKey.clear();
+        if (!loc || loc->cache_valid.empty() || (_req.method_id != M_GET && _req.method_id != M_HEAD))
+            return ResponseCache::MISS;
+        std::string key = ResponseCache::key(_req.method, _req.getHeader("host"),
+                                             _req.getRawTarget().empty() ? _req.target : _req.getRawTarget());
+        const CachedResponse* hit = 0;
+        ResponseCache::Lookup r = _loop->cache().lookup(key, ws::monotonicMs(), lock, this, &hit);
+        if (r == ResponseCache::HIT) { serveCached(*hit); return r; }
+        if (r == ResponseCache::MISS) Metrics::inc(Metrics::CACHE_MISSES);
+        _cacheKey = key;
+        if (r == ResponseCache::WAIT) { _cacheWait = true; _state = PROCESS; }
+        else _cacheLeader = lock;
+        return r;
+    }
+
+    void Connection::serveCached(const CachedResponse& c)
+    {
+        Metrics::inc(Metrics::CACHE_HITS);
+        std::string extra = c.headers;
+        extra += "X-Cache-Status: HIT\r\n";
+        bool head = _req.method_id == M_HEAD;
+        makeResponseHeaders(c.status, c.reason, c.contentType, head ? 0 : c.body.size(), c.location, extra);
+        if (!head) _out += c.body;
+    }
+
+    void Connection::cacheRelease()
+    {
+        if (_cacheWait)
+        {
+            _cacheWait = false;
+            _loop->cache().cancel(_cacheKey, this);
+        }
+        _cacheTtl = 0;
+        std::string().swap(_cacheFill.body);
+        if (_cacheLeader)
+        {
+            _cacheLeader = false;
+            _loop->cache().unlock(_cacheKey); // последним: будит ждущих
+        }
+    }
 
-                for (;;)
+    void Connection::onCgiSlot()
+    {
+        _loop->cancelTimer(this);
+        _cgiQueued = false;
+        _cgiSlot = true;
+        launchCgi();
+    }
+
+    void Connection::launchCgi()
+    {
+        const Location* loc = _cgiLoc;
+        // из очереди: на выполнение остаётся то, что не съело ожидание
+        long long timeoutMs = (long long)loc->cgi_timeout * 1000;
+        if (_cgiDeadline)
+        {
+            timeoutMs = _cgiDeadline - ws::monotonicMs();
+            if (timeoutMs <= 0)
+            {
+                ++_loop->cgiLimits().stats(loc).timeouts;
+                dropCgi(); // вернуть слот
+                if (_cgiStreaming) _curKeepAlive = false; // тело осталось непрочитанным
+                makeErrorWithPages(504, _cgiSrv);
+                return;
+            }
+        }
+        CgiLaunch launch;
+        int code = 0;
+        if (!loc->proxy_pass.empty())
+        {
+            // keep-alive пул EventLoop; backend недоступен — 502
+            _cgi = _loop->proxy().open(loc, _req, _peer, this);
+            if (!_cgi) code = 502;
+        }
+        else if ((code = CgiHandler::prepare(*_cgiSrv, loc, _req, launch)) == 0)
+        {
+            if (!loc->fastcgi_pass.empty())
+            {
+                // пул соединений EventLoop; сервер недоступен — 502
+                _cgi = _loop->fastcgi().open(loc->fastcgi_pass, launch.env, this);
+                if (!_cgi) code = 502;
+            }
+            else
+            {
+                if (loc->cgi_pool) // тёплый воркер; все заняты — запуск на запрос
+                    _cgi = _loop->cgiPool().open(loc, launch.env, this);
+                if (!_cgi)
                 {
-                    HttpRequest req;
-                    HttpParser::Result r = _parser.parse(req);
-                    if (r == HttpParser::NEED_MORE) break;
-
-                    const ServerConfig* defSrv = pickDefaultServer(_router, _lhost, _lport);
-
-                    if (r == HttpParser::OK)
-                    {
-                        _req = req;
-                        _curKeepAlive = shouldKeepAlive(_req);
-
-                        if (_req.version == "HTTP/1.1" && !_req.hasHeader("host"))
-                        {
-                            makeErrorWithPages(400, defSrv);
-                            return;
-                        }
-
-                        RouteMatch m = _router->resolve(_lhost, _lport, _req.getHeader("host"), _req.target);
-
-                        std::string checkMethod = (_req.method == "HEAD") ? "GET" : _req.method;
-
-                        if (!ws::isImplemented(_req.method))
-                        {
-                            if (m.location && m.location->path == "/upload")
-                            {
-                                std::string allow = ws::buildAllowHeader(m.location);
-                                makeResponseHeaders(405, "Method Not Allowed", "text/plain; charset=utf-8", 0, "", "Allow: " + allow + "\r\n");
-                                return;
-                            }
-                            makeErrorWithPages(501, defSrv);
-                            return;
-                        }
-
-                        if (!ws::isAllowed(m.location, checkMethod))
-                        {
-                            std::string allow = ws::buildAllowHeader(m.location);
-                            makeResponseHeaders(405, "Method Not Allowed", "text/plain; charset=utf-8", 0, "", "Allow: " + allow + "\r\n");
-                            return;
-                        }
-
-                        if (m.location && m.location->return_code >= 300 && m.location->return_code < 400 && !m.location->return_url.empty())
-                        {
-                            makeResponse(m.location->return_code, "Moved Permanently", "text/plain; charset=utf-8", "", m.location->return_url);
-                            return;
-                        }
-
-                        if (_req.method == "POST")
-                        {
-                            if (handlePostUpload(m)) return;
-                        }
-
-                        {
-                            CgiResult cgi;
-                            if (m.location && m.server && CgiHandler::handle(*m.server, m.location, _req, cgi))
-                            {
-                                std::string ctype = "text/html; charset=utf-8";
-                                std::map<std::string, std::string>::const_iterator ct = cgi.headers.find("content-type");
-                                if (ct != cgi.headers.end()) ctype = ct->second;
-
-                                bool isHead = (_req.method == "HEAD");
-                                if (isHead)
-                                {
-                                    makeResponseHeaders(cgi.status, cgi.reason, ctype, 0, "", "");
-                                    _state = WRITE;
-                                }
-                                else
-                                {
-                                    makeChunkedResponse(cgi.status, cgi.reason, ctype, cgi.body, "");
-                                }
-                                return;
-                            }
-                        }
-
-                        {
-                            StaticResult res;
-                            if (StaticHandler::handleGET(*m.server, m.location, _req, res))
-                            {
-                                if (res.status == 404) { makeErrorWithPages(404, m.server); return; }
-                                if (_req.method == "HEAD") res.body.clear();
-                                makeResponseHeaders(res.status, res.reason, res.contentType,
-                                                    res.body.size(), res.location, res.extraHeaders);
-                                _out += res.body;
-                                _state = WRITE;
-                                return;
-                            }
-                        }
-
-                        if (_req.method == "DELETE")
-                        {
-                            int code = ws::handleDelete(m, _req);
-                            if (code == 0)   { makeErrorWithPages(500, m.server); return; }
-                            if (code == 204) { _out = ws::buildHeaders(204, "No Content", "text/plain; charset=utf-8", 0, _curKeepAlive, "", ws::httpDateNow(), ""); _state = WRITE; return; }
-                            if (code == 403) { makeResponse(403, "Forbidden", "text/plain; charset=utf-8", "403 Forbidden\n"); return; }
-                            if (code == 404) { makeResponse(404, "Not Found", "text/plain; charset=utf-8", "404 Not Found\n"); return; }
-                            if (code == 500) { makeResponse(500, "Internal Server Error", "text/plain; charset=utf-8", "500 Internal Server Error\n"); return; }
-                        }
-
-                        {
-                            std::string echo = "Method: " + _req.method + "\nTarget: " + _req.target + "\nVersion: " + _req.version + "\n";
-                            if (_req.hasHeader("host")) echo += "Host: " + _req.getHeader("host") + "\n";
-                            if (!_req.body.empty())      echo += "Body-Bytes: " + itoa10((int)_req.body.size()) + "\n";
-                            makeResponse(200, "OK", "text/plain; charset=utf-8", echo);
-                            return;
-                        }
-                    }
-
-                    if (r == HttpParser::BAD_REQUEST)      { makeErrorWithPages(400, defSrv); return; }
-                    if (r == HttpParser::NOT_IMPLEMENTED)  { makeErrorWithPages(501, defSrv); return; }
-                    if (r == HttpParser::LENGTH_REQUIRED)  { makeErrorWithPages(411, defSrv); return; }
-                    if (r == HttpParser::ENTITY_TOO_LARGE) { makeErrorWithPages(413, defSrv); return; }
+                    CgiProcess* p = new CgiProcess(_loop, this, &_loop->cgiLimits().stats(loc));
+                    if (p->start(launch)) _cgi = p;
+                    else { delete p; code = 500; }
                 }
+            }
+        }
+        if (code)
+        {
+            dropCgi(); // вернуть слот
+            if (_cgiStreaming) _curKeepAlive = false; // тело осталось непрочитанным
+            makeErrorWithPages(code, _cgiSrv);
+            return;
+        }
+
+        _state = CGI;
+        if (timeoutMs) _loop->setTimer(this, timeoutMs);
+        if (_cgiStreaming)
+        {
+            _cgiBody = true;
+            pumpCgiBody();
+        }
+        else
+        {
+            _cgi->writeStdin(_req.body);
+            _cgi->closeStdin();
+        }
+    }
+
+    void Connection::onTimer()
+    {
+        if (_cgiQueued)
+        {
+            // слот так и не освободился
+            _loop->cgiLimits().cancel(_cgiLoc, this);
+            ++_loop->cgiLimits().stats(_cgiLoc).rejected;
+            _cgiQueued = false;
+            if (_cgiStreaming) _curKeepAlive = false;
+            makeErrorWithPages(503, _cgiSrv, kCgiRetryAfter);
+            return;
+        }
+        if (!_cgi) return;
+        ++_loop->cgiLimits().stats(_cgiLoc).timeouts;
+        WS_LOG_WARN("cgi_timeout expired: " + _req.target);
+        _cgiTimedOut = true;
+        _cgi->terminate(); // последним: FastCGI завершает вывод прямо отсюда
+    }
+
+    void Connection::pumpCgiBody()
+    {
+        std::string chunk;
+        HttpParser::Result r = _parser.readBody(chunk);
+        _cgi->writeStdin(chunk);
+        if (r == HttpParser::NEED_MORE) return;
+
+        _cgiBody = false;
+        if (r == HttpParser::OK) { _cgi->closeStdin(); return; }
+
+        // битое/слишком большое тело: скрипт больше не нужен
+        if (_cgiHeaders) { closeNow(); return; } // ответ уже пошёл — только обрыв
+        dropCgi();
+        _curKeepAlive = false;
+        makeErrorWithPages(r == HttpParser::ENTITY_TOO_LARGE ? 413 : 400, _cgiSrv);
+    }
+
+    void Connection::spliceCgiBody()
+    {
+        if (!_cgi->stdinReady()) return; // скрипт закрыл stdin — остаток тела не нужен
+        long n = ws::spliceBytes(_fd, _spliceInFd, _parser.rawBodyLeft());
+        if (n == 0) { closeNow(); return; }
+        if (n < 0)
+        {
+            if (ws::pendingBytes(_fd) <= 0) { closeNow(); return; } // ошибка сокета
+            _cgi->stdinFull(); // пайп полон: ждём, пока скрипт прочитает
+            return;
+        }
+        Metrics::add(Metrics::BYTES_IN, (unsigned long long)n);
+        _parser.skipRawBody((size_t)n);
+        if (_parser.rawBodyLeft()) return;
+        _cgiBody = false;
+        _spliceInFd = -1;
+        _cgi->closeStdin();
+    }
+
+    void Connection::spliceCgiOutput()
+    {
+        for (;;)
+        {
+            if (!flushOut() || !_out.empty()) return;
+            if (_spliceLeft)
+            {
+                long n = ws::spliceBytes(_spliceOutFd, _fd, _spliceLeft);
+                if (n <= 0) return; // сокет полон; ошибку сокета увидит следующий send
+                Metrics::add(Metrics::BYTES_OUT, (unsigned long long)n);
+                _sentBytes += (unsigned long long)n;
+                _spliceLeft -= (size_t)n;
+                if (_spliceLeft) continue;
+                _out += "\r\n";
+                if (ws::pendingBytes(_spliceOutFd) > 0) continue; // скрипт уже дописал ещё
+                _cgi->outputDrained();
                 continue;
             }
+            if (!_cgi->outputReady()) return;
+            long avail = ws::pendingBytes(_spliceOutFd);
+            if (avail <= 0)
+            {
+                // пайп читаем, но пуст — скрипт закрыл stdout
+                _spliceOutFd = -1;
+                _cgi->outputEof();
+                finishCgiResponse();
+                return;
+            }
+            // размер чанка известен заранее: всё, что сейчас лежит в пайпе
+            ws::appendHex(_out, (unsigned long long)avail);
+            _out += "\r\n";
+            _spliceLeft = (size_t)avail;
+        }
+    }
+
+    void Connection::dropCgi()
+    {
+        delete _cgi;
+        _cgi = 0;
+        _spliceInFd = -1;
+        _spliceOutFd = -1;
+        _spliceLeft = 0;
+        if (_loop) _loop->cancelTimer(this);
+        if (_cgiQueued)
+        {
+            _cgiQueued = false;
+            _loop->cgiLimits().cancel(_cgiLoc, this);
+        }
+        if (_loop) cacheRelease();
+        if (_cgiSlot)
+        {
+            _cgiSlot = false;
+            _loop->cgiLimits().release(_cgiLoc); // последним: может запустить чужой запрос
+        }
+    }
+
+    void Connection::onCgiEvent()
+    {
+        if (!_cgiHeaders)
+        {
+            const std::string& out = _cgi->output();
+            size_t hdrLen = 0, bodyOff = 0;
+            bool complete = CgiHandler::headerEnd(out, hdrLen, bodyOff);
+            if (!complete && !_cgi->outputDone())
+            {
+                if (out.size() < CgiBackend::OUT_HIGH) return; // ждём пустую строку
+                dropCgi();                                      // заголовки без конца
+                makeErrorWithPages(502, _cgiSrv);
+                return;
+            }
+            if (out.empty() || (_cgiTimedOut && !complete))
+            {
+                dropCgi();
+                makeErrorWithPages(_cgiTimedOut ? 504 : 502, _cgiSrv);
+                return;
+            }
 
-            if (n == 0)
+            CgiResult cgi;
+            CgiHandler::parseHeaders(complete ? out.substr(0, hdrLen) : out, cgi);
+            if (!cgi.accelRedirect.empty() || !cgi.sendfile.empty())
             {
-                if (_state == WRITE && !_out.empty()) return;
-                closeNow();
+                serveAccel(cgi);
+                return;
+            }
+            if (_cacheLeader)
+            {
+                _cacheTtl = cgiCacheable(cgi) ? cacheTtlMs(_cgiLoc, cgi.status) : 0;
+                if (_cacheTtl)
+                {
+                    _cacheFill = CachedResponse();
+                    _cacheFill.status = cgi.status;
+                    _cacheFill.reason = cgi.reason;
+                    _cacheFill.contentType = cgi.headers["content-type"];
+                    _cacheFill.headers = cgi.extraHeaders;
+                }
+                else cacheRelease(); // не кэшируется: ждущие идут к скрипту сами
+            }
+            _cgi->consumeOutput(complete ? bodyOff : out.size());
+            if (_cgiBody) _curKeepAlive = false; // скрипт ответил, не дочитав тело
+
+            const std::string& ctype = cgi.headers["content-type"];
+            _out.erase(_interim);
+            _status = cgi.status;
+            if (_req.method_id == M_HEAD)
+                ws::appendHeaders(_out, cgi.status, cgi.reason, ctype, 0, _curKeepAlive, "", cgi.extraHeaders);
+            else
+                ws::appendChunkedHeaders(_out, cgi.status, cgi.reason, ctype, _curKeepAlive, cgi.extraHeaders);
+            _cgiHeaders = true;
+        }
+        forwardCgiOutput();
+    }
+
+    void Connection::serveAccel(const CgiResult& cgi)
+    {
+        // скрипт только разрешил отдачу: его тело не нужно, файл отдаём сами
+        const ServerConfig* srv = _cgiSrv;
+        const Location* cgiLoc = _cgiLoc;
+        if (_cgiBody) { _cgiBody = false; _curKeepAlive = false; }
+        dropCgi();
+
+        StaticResult res;
+        if (!cgi.accelRedirect.empty())
+        {
+            HttpRequest r = _req;
+            r.raw_target = cgi.accelRedirect;
+            r.target = StaticHandler::pathOnly(cgi.accelRedirect);
+            RouteMatch m = _router->resolve(_routes, _req.getHeader("host"), r.target);
+            if (r.target.empty() || r.target[0] != '/' || !m.server
+                || (m.location && CgiHandler::matches(m.location, r)))
+            {
+                WS_LOG_WARN("X-Accel-Redirect to a non-static location: " + cgi.accelRedirect);
+                makeErrorWithPages(500, srv);
+                return;
+            }
+            StaticHandler::handleGET(*m.server, m.location, r, res);
+            srv = m.server;
+        }
+        else
+        {
+            // X-Sendfile — путь в ФС; только внутри root локации скрипта
+            std::string base = !cgiLoc->root.empty() ? cgiLoc->root : (srv->root.empty() ? "." : srv->root);
+            if (base[base.size() - 1] != '/') base += '/';
+            const std::string& p = cgi.sendfile;
+            if (ws::pathTraversalSuspect(p) || p.compare(0, base.size(), base) != 0)
+            {
+                WS_LOG_WARN("X-Sendfile outside of root: " + p);
+                makeErrorWithPages(403, srv);
+                return;
+            }
+            StaticHandler::serveFile(p, _req, res);
+        }
+        std::map<std::string, std::string>::const_iterator cd = cgi.headers.find("content-disposition");
+        if (cd != cgi.headers.end() && res.status < 300)
+            res.extraHeaders += "Content-Disposition: " + cd->second + "\r\n";
+        sendStatic(res, srv);
+    }
+
+    void Connection::forwardCgiOutput()
+    {
+        if (_spliceOutFd >= 0) { spliceCgiOutput(); return; }
+        // сокет не успевает — не берём больше; пайп встанет сам (OUT_HIGH)
+        if (_out.size() >= CGI_SOCKET_BACKLOG) return;
+
+        const std::string& data = _cgi->output();
+        if (!data.empty() && _cacheTtl && _req.method_id != M_HEAD)
+        {
+            _cacheFill.body += data;
+            if (_cacheFill.body.size() > ResponseCache::MAX_ENTRY) cacheRelease(); // велик для кэша
+        }
+        if (!data.empty())
+        {
+            if (_req.method_id != M_HEAD)
+            {
+                ws::appendHex(_out, (unsigned long long)data.size());
+                _out += "\r\n";
+                _out += data;
+                _out += "\r\n";
+            }
+            _cgi->consumeOutput(data.size());
+        }
+        if (!_cgi->outputDone())
+        {
+            // буфер пуст: дальше пайп -> сокет без копии в user space
+            if (_req.method_id != M_HEAD && !_cacheTtl && ws::haveSplice()
+                && (_spliceOutFd = _cgi->spliceOutput()) >= 0)
+                spliceCgiOutput();
+            return;
+        }
+        finishCgiResponse();
+    }
+
+    void Connection::finishCgiResponse()
+    {
+        if (_cacheTtl && !_cgiTimedOut && !_cgi->outputBroken())
+        {
+            _cacheLeader = false; // store() сам снимает блокировку ключа
+            _loop->cache().store(_cacheKey, _cacheFill, ws::monotonicMs(), _cacheTtl);
+        }
+        // оборванный (таймаут, сбой backend) ответ не завершаем: клиент увидит обрыв, а не «успех»
+        if (_cgiTimedOut || _cgi->outputBroken()) _curKeepAlive = false;
+        else if (_req.method_id != M_HEAD) _out += "0\r\n\r\n";
+        if (_cgiBody) { _cgiBody = false; _curKeepAlive = false; }
+        _state = WRITE;
+        dropCgi();
+    }
+
+    void Connection::handleRequest()
+    {
+        const ServerConfig* defSrv = _defSrv;
+
+        if (_req.version == "HTTP/1.1" && !_req.hasHeader("host"))
+        {
+            makeErrorWithPages(400, defSrv);
+            return;
+        }
+
+        RouteMatch m = _router->resolve(_routes, _req.getHeader("host"), _req.target);
+        noteRoute(m);
+
+        if (m.location && m.location->internal)
+        {
+            makeErrorWithPages(404, m.server); // доступна только через X-Accel-Redirect
+            return;
+        }
+
+        if (!ws::isImplemented(_req.method_id))
+        {
+            if (m.location && m.location->path == "/upload")
+            {
+                makeMethodNotAllowed(m.location);
                 return;
             }
-            ws::Log::warn("recv() error, closing");
+            makeErrorWithPages(501, defSrv);
+            return;
+        }
+
+        if (!ws::isAllowed(m.location, _req.method_id))
+        {
+            makeMethodNotAllowed(m.location);
+            return;
+        }
+
+        if (m.location && m.location->return_code >= 300 && m.location->return_code < 400 && !m.location->return_url.empty())
+        {
+            makeResponse(m.location->return_code, "Moved Permanently", "text/plain; charset=utf-8", "", m.location->return_url);
+            return;
+        }
+
+        if (m.location && m.location->stub_status)
+        {
+            if (_req.method_id != M_GET && _req.method_id != M_HEAD) makeMethodNotAllowed(m.location);
+            else sendStatus();
+            return;
+        }
+
+        if (handleResumable(m)) return;
+
+        if (_req.method_id == M_POST)
+        {
+            if (handlePostUpload(m)) return;
+        }
+
+        if (m.location && m.server && CgiHandler::matches(m.location, _req))
+        {
+            startCgi(m, false);
+            return;
+        }
+
+        if (cacheLookup(m.location, false) == ResponseCache::HIT) return;
+        if (m.location && m.location->aio_threads)
+        {
+            // stat/open (и DELETE ниже) — в пуле потоков: медленный диск не стопорит цикл
+            FsTask* t = new FsTask(FsTask::STAT, m);
+            t->req = _req;
+            offload(t);
+            return;
+        }
+        {
+            StaticResult res;
+            if (StaticHandler::handleGET(*m.server, m.location, _req, res))
+            {
+                staticDone(res, m, -1);
+                return;
+            }
+        }
+
+        if (_req.method_id == M_DELETE && sendDeleted(ws::handleDelete(m, _req), m.server))
+            return;
+
+        sendEcho();
+    }
+
+    void Connection::sendStatus()
+    {
+        StatusReport r;
+        r.metrics = Metrics::snapshot();
+        r.aio = _loop->aio().stats();
+        r.commits = _loop->commits().stats();
+        Metrics::latencySnapshot(r.latency);
+        r.cfg = _loop->config();
+        const bool prom = ws::statusWantsPrometheus(_req);
+        const std::string body = ws::renderStatus(r, prom);
+        const bool isHead = (_req.method_id == M_HEAD);
+        makeResponseHeaders(200, "OK", ws::statusContentType(prom), isHead ? 0 : body.size(), "",
+                            "Cache-Control: no-store\r\n");
+        if (!isHead) _out += body;
+    }
+
+    void Connection::staticDone(const StaticResult& res, const RouteMatch& m, int fd)
+    {
+        // сгенерированное (autoindex, редиректы) — в кэш; файлы и так дёшевы
+        long long ttl = _cacheKey.empty() || !res.filePath.empty() || res.status == 404
+                      ? 0 : cacheTtlMs(m.location, res.status);
+        if (ttl)
+        {
+            CachedResponse c;
+            c.status = res.status;
+            c.reason = res.reason;
+            c.contentType = res.contentType;
+            c.location = res.location;
+            c.headers = res.extraHeaders;
+            c.body = res.body;
+            _loop->cache().store(_cacheKey, c, ws::monotonicMs(), ttl);
+        }
+        sendStatic(res, m.server, fd);
+    }
+
+    bool Connection::sendDeleted(int code, const ServerConfig* srv)
+    {
+        if (code == 0)   { makeErrorWithPages(500, srv); return true; }
+        if (code == 204) { makeResponseHeaders(204, "No Content", "text/plain; charset=utf-8", 0, "", ""); return true; }
+        if (code == 403) { makeResponse(403, "Forbidden", "text/plain; charset=utf-8", "403 Forbidden\n"); return true; }
+        if (code == 404) { makeResponse(404, "Not Found", "text/plain; charset=utf-8", "404 Not Found\n"); return true; }
+        if (code == 500) { makeResponse(500, "Internal Server Error", "text/plain; charset=utf-8", "500 Internal Server Error\n"); return true; }
+        return false;
+    }
+
+    void Connection::sendEcho()
+    {
+        std::string echo = "Method: " + _req.method + "\nTarget: " + _req.target + "\nVersion: " + _req.version + "\n";
+        if (_req.hasHeader("host")) echo += "Host: " + _req.getHeader("host") + "\n";
+        if (!_req.body.empty())      { echo += "Body-Bytes: "; ws::appendUint(echo, _req.body.size()); echo += "\n"; }
+        makeResponse(200, "OK", "text/plain; charset=utf-8", echo);
+    }
+
+    void Connection::processInput()
+    {
+        for (;;)
+        {
+            HttpRequest req;
+            HttpParser::Result r = _parser.parse(req);
+            if (r == HttpParser::NEED_MORE) return;
+
+            if (r == HttpParser::HEADERS)
+            {
+                // тело ещё идёт: CGI запускаем сразу и льём тело в stdin по мере прихода
+                _req = req;
+                _curKeepAlive = shouldKeepAlive(_req);
+                if (_req.version != "HTTP/1.1" || _req.hasHeader("host"))
+                {
+                    RouteMatch m = _router->resolve(_routes, _req.getHeader("host"), _req.target);
+                    noteRoute(m);
+                    if (!admitBody(m)) return;
+                    std::string boundary;
+                    if (isUploadStream(m, boundary)) { startUpload(m, boundary); return; }
+                    std::string id;
+                    if (isPatchStream(m, id)) { startPatch(m, id); return; }
+                    if (isCgiRoute(m)) { startCgi(m, true); return; }
+                }
+                continue; // остальным нужно тело целиком
+            }
+
+            if (r == HttpParser::OK)
+            {
+                _req = req;
+                _curKeepAlive = shouldKeepAlive(_req);
+                handleRequest();
+                return;
+            }
+
+            if (r != HttpParser::NEED_MORE) Metrics::inc(Metrics::PARSE_ERRORS);
+            _req = req; // что успели разобрать — для access_log, не прошлый запрос
+            if (r == HttpParser::BAD_REQUEST)      { makeErrorWithPages(400, _defSrv); return; }
+            if (r == HttpParser::NOT_IMPLEMENTED)  { makeErrorWithPages(501, _defSrv); return; }
+            if (r == HttpParser::LENGTH_REQUIRED)  { makeErrorWithPages(411, _defSrv); return; }
+            if (r == HttpParser::ENTITY_TOO_LARGE) { _curKeepAlive = false; makeErrorWithPages(413, _defSrv); return; }
+            return;
+        }
+    }
+
+    // Заголовки запроса с телом прочитаны, маршрут известен: лишнее тело отклоняется
+    // до первого его байта (413; для Expect — и 405), а ждущему клиенту уходит 100 Continue
+    bool Connection::admitBody(const RouteMatch& m)
+    {
+        if (!_parser.setBodyLimit(bodyLimit(m)))
+        {
+            _curKeepAlive = false; // тело не читаем
+            makeErrorWithPages(413, m.server);
+            return false;
+        }
+        std::string expect = _req.getHeader("expect");
+        for (size_t i = 0; i < expect.size(); ++i)
+            if (expect[i] >= 'A' && expect[i] <= 'Z') expect[i] = char(expect[i] - 'A' + 'a');
+        if (_req.version != "HTTP/1.1" || expect != "100-continue") return true;
+        if (m.location && !ws::isAllowed(m.location, _req.method_id))
+        {
+            _curKeepAlive = false;
+            makeMethodNotAllowed(m.location);
+            return false;
+        }
+        _out += "HTTP/1.1 100 Continue\r\n\r\n";
+        _interim = _out.size();
+        return true;
+    }
+
+    void Connection::onReadable()
+    {
+        if (_state != READ && _state != UPLOAD && !(_state == CGI && _cgiBody)) return;
+
+        if (_state == CGI && _spliceInFd < 0 && ws::haveSplice() && _parser.rawBodyLeft()
+            && _cgi->stdinBacklog() == 0)
+            _spliceInFd = _cgi->spliceStdin(); // остаток тела — сокет -> пайп без копии
+        if (_state == CGI && _spliceInFd >= 0) { spliceCgiBody(); return; }
+
+        // один recv на событие poll: без EAGAIN-цикла (errno не смотрим)
+        char buf[8192];
+        ssize_t n = ::recv(_fd, buf, sizeof(buf), 0);
+        if (n == 0)
+        {
             closeNow();
             return;
         }
+        if (n < 0)
+        {
+            WS_LOG_WARN("recv() error, closing");
+            closeNow();
+            return;
+        }
+        Metrics::add(Metrics::BYTES_IN, (unsigned long long)n);
+        setIdle(false);
+        if (!_reqStartUs) _reqStartUs = ws::monotonicUs();
+        _parser.feed(buf, (size_t)n);
+
+        if (_state == CGI) pumpCgiBody();
+        else if (_state == UPLOAD) { if (_upload) pumpUpload(); else pumpPatch(); }
+        else processInput();
     }
 
-    void Connection::onWritable()
+    void Connection::sendStatic(const StaticResult& res, const ServerConfig* srv, int fd)
+    {
+        // fd — тело, уже открытое в пуле (aio threads); иначе откроем сами
+        if (fd >= 0 && (res.status == 404 || _req.method_id == M_HEAD || res.filePath.empty() || !res.contentLength))
+        {
+            ::close(fd);
+            fd = -1;
+        }
+        if (res.status == 404) { makeErrorWithPages(404, srv); return; }
+        if (_req.method_id == M_HEAD)
+        {
+            makeResponseHeaders(res.status, res.reason, res.contentType, 0, res.location, res.extraHeaders);
+            return;
+        }
+        if (res.filePath.empty())
+        {
+            makeResponseHeaders(res.status, res.reason, res.contentType,
+                                res.body.size(), res.location, res.extraHeaders);
+            _out += res.body;
+            return;
+        }
+
+        if (res.contentLength && fd < 0)
+        {
+            fd = ::open(res.filePath.c_str(), O_RDONLY);
+            if (fd < 0) { makeErrorWithPages(500, srv); return; }
+        }
+        makeResponseHeaders(res.status, res.reason, res.contentType,
+                            res.contentLength, res.location, res.extraHeaders);
+        if (fd < 0) return;
+        _fileFd = fd;
+        _fileOff = (off_t)res.fileOffset;
+        _fileLeft = res.contentLength;
+    }
+
+    bool Connection::sendFileBody()
+    {
+        while (_fileLeft)
+        {
+            long n = ws::sendFileBytes(_fd, _fileFd, _fileOff, _fileLeft);
+            if (n < 0) return true; // сокет полон
+            if (n == 0)
+            {
+                // файл укоротили под нами: Content-Length уже не выполнить
+                WS_LOG_WARN("file shrank while sending, closing");
+                closeNow();
+                return false;
+            }
+            _fileLeft -= (size_t)n;
+            Metrics::add(Metrics::BYTES_OUT, (unsigned long long)n);
+            _sentBytes += (unsigned long long)n;
+        }
+        closeFile();
+        return true;
+    }
+
+    void Connection::closeFile()
+    {
+        if (_fileFd >= 0) ::close(_fileFd);
+        _fileFd = -1;
+        _fileLeft = 0;
+    }
+
+    bool Connection::flushOut()
     {
-        if (_state != WRITE) return;
         while (!_out.empty())
         {
             ssize_t n = ::send(_fd, _out.data(), _out.size(), 0);
-            if (n > 0) { _out.erase(0, (size_t)n); continue; }
-            if (n < 0) return;
-            ws::Log::warn("send() error, closing");
+            if (n > 0)
+            {
+                _out.erase(0, (size_t)n);
+                Metrics::add(Metrics::BYTES_OUT, (unsigned long long)n);
+                _sentBytes += (unsigned long long)n;
+                if ((size_t)n > _interim && !_ttfbUs) _ttfbUs = ws::monotonicUs(); // 100 Continue не в счёт
+                _interim -= (size_t)n < _interim ? (size_t)n : _interim;
+                continue;
+            }
+            if (n < 0) break;
+            WS_LOG_WARN("send() error, closing");
             closeNow();
+            return false;
+        }
+        return true;
+    }
+
+    void Connection::onWritable()
+    {
+        if ((_state == READ || _state == UPLOAD) && _interim) { flushOut(); return; } // 100 Continue
+        if (_state != WRITE && _state != CGI) return;
+        if (!flushOut()) return;
+        if (_state == WRITE && _out.empty() && _fileLeft && !sendFileBody()) return;
+        if (_state == CGI)
+        {
+            // место в сокете освободилось — подбираем вывод скрипта (до его заголовков
+            // здесь уходил только 100 Continue)
+            if (_cgi && _cgiHeaders) forwardCgiOutput();
             return;
         }
+        if (!_out.empty() || _fileLeft) return;
+        Metrics::inc(Metrics::REQUESTS);
+        Metrics::response(_status);
+        requestDone();
         if (_curKeepAlive)
         {
             _reqsOnConn++;
             _parser.reset();
             _out.clear();
             _state = READ;
+            setIdle(true);
             return;
         }
         closeNow();
@@ -52,7 +52,7 @@ static std::string mapFs(const ws::ServerConfig* srv, const ws::Location* loc,
 }
 
 int handleDelete(const ws::RouteMatch& m, const ws::HttpRequest& req) {
-  if (req.method != "DELETE") return 0;
+  if (req.method_id != M_DELETE) return 0;
 
   const std::string raw = req.getRawTarget().empty() ? req.target : req.getRawTarget();
   std::string p = pathOnly(raw);
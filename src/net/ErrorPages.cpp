@@ -0,0 +1,89 @@
+#include "webserv/net/ErrorPages.hpp"
+#include "webserv/utils/IO.hpp"
+#include "webserv/Log.hpp"
+
+namespace ws {
+
+static const int kBuiltinCodes[] = { 400, 403, 404, 405, 409, 411, 413, 415, 500, 501, 502, 503, 504 };
+
+static const char kTextPlain[] = "text/plain; charset=utf-8";
+static const char kTextHtml[]  = "text/html; charset=utf-8";
+
+const char* reasonPhrase(int code) {
+  switch (code) {
+    case 400: return "Bad Request";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 409: return "Conflict";
+    case 411: return "Length Required";
+    case 413: return "Payload Too Large";
+    case 415: return "Unsupported Media Type";
+    case 500: return "Internal Server Error";
+    case 501: return "Not Implemented";
+    case 502: return "Bad Gateway";
+    case 503: return "Service Unavailable";
+    case 504: return "Gateway Timeout";
+    default:  return "Error";
+  }
+}
+
+static void prepare(CannedResponse& r, int code, const std::string& body,
+                    const char* ctype) {
+  const std::string reason = reasonPhrase(code);
+  r.code = code;
+  r.body = body;
+  renderHeaderTemplate(r.full, code, reason, ctype, body.size());
+  renderHeaderTemplate(r.head, code, reason, ctype, 0);
+}
+
+void ErrorPages::load(const Config& cfg) {
+  _builtin.clear();
+  _perServer.clear();
+
+  for (size_t i = 0; i < sizeof(kBuiltinCodes) / sizeof(kBuiltinCodes[0]); ++i) {
+    const int code = kBuiltinCodes[i];
+    std::string body;
+    appendUint(body, (unsigned long long)code);
+    body += ' ';
+    body += reasonPhrase(code);
+    body += '\n';
+    prepare(_builtin[code], code, body, kTextPlain);
+  }
+
+  for (size_t i = 0; i < cfg.servers.size(); ++i) {
+    const ServerConfig& srv = cfg.servers[i];
+    for (std::map<int, std::string>::const_iterator it = srv.error_pages.begin();
+         it != srv.error_pages.end(); ++it) {
+      std::string fs = it->second;
+      if (!srv.root.empty() && (fs.size() < 2 || fs.substr(0, 2) != "./"))
+        fs = srv.root + "/" + fs;
+      std::string body;
+      if (!readWholeFile(fs, body)) {
+        WS_LOG_WARN("error_page not readable, using built-in: " + fs);
+        continue;
+      }
+      prepare(_perServer[&srv][it->first], it->first, body, kTextHtml);
+    }
+  }
+}
+
+const CannedResponse* ErrorPages::find(const ServerConfig* srv, int code) const {
+  if (srv) {
+    std::map<const ServerConfig*, ByCode>::const_iterator s = _perServer.find(srv);
+    if (s != _perServer.end()) {
+      ByCode::const_iterator c = s->second.find(code);
+      if (c != s->second.end()) return &c->second;
+    }
+  }
+  ByCode::const_iterator b = _builtin.find(code);
+  return b != _builtin.end() ? &b->second : 0;
+}
+
+void ErrorPages::append(std::string& out, const CannedResponse& r,
+                        bool keepAlive, bool isHead, const char* extra) {
+  appendFromTemplate(out, isHead ? r.head : r.full, keepAlive, extra);
+  if (!isHead) out += r.body;
+}
+
+} // namespace ws
@@ -4,11 +4,17 @@
 #include "webserv/net/Poller.hpp"
 #include "webserv/http/Router.hpp"
 #include "webserv/Log.hpp"
+#include "webserv/utils/Time.hpp"
+#include "webserv/utils/Metrics.hpp"
 
 #include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
 #include <unistd.h>
 #include <poll.h>
 #include <errno.h>
+#include <signal.h>
+#include <ctime>
 
 #include <map>
 #include <vector>
@@ -18,7 +24,7 @@
 namespace ws {
 
 EventLoop::EventLoop()
-    : _router(0), _cfgRef(0) {}
+    : _watchSeq(0), _pollSeq(0), _router(0), _cfgRef(0) {}
 
 EventLoop::~EventLoop() {
     // закрыть и удалить слушатели
@@ -43,6 +49,62 @@ bool EventLoop::initFromConfig(const Config& cfg) {
     // переcобрать роутер
     if (_router) { delete _router; _router = 0; }
     _router = new Router(_cfgRef);
+    _errorPages.load(cfg);
+
+    // CGI: запись в пайп умершего скрипта не должна убивать сервер
+    ::signal(SIGPIPE, SIG_IGN);
+    if (!_reaper.open()) {
+        WS_LOG_WARN("SIGCHLD self-pipe setup failed");
+        return false;
+    }
+    watch(_reaper.fd(), &_reaper);
+
+    // fastcgi_pass/proxy_pass: адреса разрешаем сейчас, соединения — по первому запросу;
+    // cgi_pool: воркеры поднимаем заранее; aio threads: один пул на всех, по наибольшему N
+    // (upload_durability group синхронизирует в нём же — хотя бы два потока)
+    size_t aioThreads = 0;
+    for (size_t i = 0; i < cfg.servers.size(); ++i) {
+        const std::vector<Location>& locs = cfg.servers[i].locations;
+        for (size_t j = 0; j < locs.size(); ++j) {
+            std::string err;
+            if (!locs[j].fastcgi_pass.empty() && !_fcgi.add(locs[j].fastcgi_pass, this, err)) {
+                WS_LOG_WARN(err);
+                return false;
+            }
+            if (!locs[j].proxy_pass.empty() && !_proxy.add(locs[j].proxy_pass, this, err)) {
+                WS_LOG_WARN(err);
+                return false;
+            }
+            if (locs[j].cgi_pool && locs[j].fastcgi_pass.empty())
+                _cgiPool.add(&locs[j], this, &_cgiLimits.stats(&locs[j]));
+            if (locs[j].aio_threads > aioThreads) aioThreads = locs[j].aio_threads;
+            if (locs[j].upload_durable && aioThreads < 2) aioThreads = 2;
+        }
+    }
+    if (aioThreads && !_aio.start(aioThreads, this)) return false;
+    _commits.init(this);
+    Metrics::setLatencySlots(cfg.stats_slots);
+
+    // access_log: файлы открываем сейчас; location без своего пишет в лог сервера
+    for (size_t i = 0; i < cfg.servers.size(); ++i) {
+        const ServerConfig& s = cfg.servers[i];
+        for (size_t j = 0; j <= s.locations.size(); ++j) {
+            const bool own = (j == s.locations.size());
+            const AccessLogConfig& al = (!own && s.locations[j].access_log.set) ? s.locations[j].access_log
+                                                                                 : s.access_log;
+            if (al.path.empty()) continue;
+            std::string err;
+            const int id = _accessLog.open(al.path, al.buffer, al.flush_ms, err);
+            if (id < 0) {
+                WS_LOG_WARN(err);
+                return false;
+            }
+            AccessLog::Format f = AccessLog::COMBINED;
+            AccessLog::formatFromName(al.format, f);
+            _accessLog.route(own ? s.stats_slot : s.locations[j].stats_slot, id, f);
+        }
+    }
+    if (!_accessLog.start()) return false;
 
     // подчистить прежние слушатели/бинды
     for (size_t i = 0; i < _listeners.size(); ++i) delete _listeners[i];
@@ -69,7 +131,7 @@ bool EventLoop::initFromConfig(const Config& cfg) {
         if (!L->open(host, port)) {
             std::ostringstream oss;
             oss << "Listener open failed for " << host << ":" << port;
-            ws::Log::warn(oss.str());
+            WS_LOG_WARN(oss.str());
             delete L;
             return false; // “всё или ничего”
         }
@@ -80,6 +142,45 @@ bool EventLoop::initFromConfig(const Config& cfg) {
     return true;
 }
 
+void EventLoop::watch(int fd, IoWatcher* w) {
+    Watch& x = _watchers[fd];
+    x.w = w;
+    x.seq = ++_watchSeq;
+}
+
+void EventLoop::unwatch(int fd) {
+    _watchers.erase(fd);
+}
+
+void EventLoop::setTimer(TimerListener* l, long long delayMs) {
+    cancelTimer(l);
+    _timerOf[l] = _timers.insert(std::make_pair(monotonicMs() + delayMs, l));
+}
+
+void EventLoop::cancelTimer(TimerListener* l) {
+    std::map<TimerListener*, TimerQueue::iterator>::iterator it = _timerOf.find(l);
+    if (it == _timerOf.end()) return;
+    _timers.erase(it->second);
+    _timerOf.erase(it);
+}
+
+int EventLoop::pollTimeout() const {
+    if (_timers.empty()) return 1000;
+    long long d = _timers.begin()->first - monotonicMs();
+    if (d < 0) return 0;
+    return d < 1000 ? (int)d : 1000;
+}
+
+void EventLoop::runTimers() {
+    const long long now = monotonicMs();
+    while (!_timers.empty() && _timers.begin()->first <= now) {
+        TimerListener* l = _timers.begin()->second;
+        _timers.erase(_timers.begin());
+        _timerOf.erase(l); // до вызова: слушатель может перевзвести таймер или исчезнуть
+        l->onTimer();
+    }
+}
+
 void EventLoop::rebuildPollSet() {
     _poller.clear();
 
@@ -92,18 +193,43 @@ void EventLoop::rebuildPollSet() {
     for (std::map<int, Connection*>::iterator it = _conns.begin(); it != _conns.end(); ++it) {
         _poller.add(it->first, it->second->wantEvents());
     }
+
+    // пайпы CGI и прочие наблюдатели
+    _pollSeq = _watchSeq;
+    for (std::map<int, Watch>::iterator it = _watchers.begin(); it != _watchers.end(); ++it) {
+        short want = it->second.w->ioEvents(it->first);
+        if (want) _poller.add(it->first, want);
+    }
+}
+
+// адрес клиента для access_log и X-Forwarded-For: 127.0.0.1, ::1
+static std::string peerAddress(const struct sockaddr_storage& ss) {
+    char buf[INET6_ADDRSTRLEN] = "";
+    if (ss.ss_family == AF_INET)
+        ::inet_ntop(AF_INET, &((const struct sockaddr_in*)&ss)->sin_addr, buf, sizeof(buf));
+    else if (ss.ss_family == AF_INET6)
+        ::inet_ntop(AF_INET6, &((const struct sockaddr_in6*)&ss)->sin6_addr, buf, sizeof(buf));
+    return buf;
 }
 
 void EventLoop::acceptReady(int lfd) {
     for (;;) {
-        int cfd = ::accept(lfd, 0, 0);
+        struct sockaddr_storage peer;
+        socklen_t plen = sizeof(peer);
+        int cfd = ::accept(lfd, (struct sockaddr*)&peer, &plen);
         if (cfd < 0) {
             // не трогаем errno (по твоему требованию) — просто ждём следующего POLLIN
             return;
         }
         setNonBlocking(cfd);
+        setCloseOnExec(cfd);
 
         Connection* c = new Connection(cfd);
+        Metrics::inc(Metrics::CONN_ACCEPTED);
+        c->setLoop(this);
+        const std::string addr = peerAddress(peer);
+        c->setPeer(addr);
+        WS_LOG_DEBUG("accept fd " + Log::num(cfd) + " from " + addr);
 
         // передадим, на каком (host,port) нас приняли
         std::map<int, std::pair<std::string,int> >::iterator itB = _listenerBind.find(lfd);
@@ -112,6 +238,7 @@ void EventLoop::acceptReady(int lfd) {
         }
 
         c->setRouter(_router);
+        c->setErrorPages(&_errorPages);
         _conns[cfd] = c;
     }
 }
@@ -132,14 +259,15 @@ void EventLoop::gcClosed() {
 }
 
 int EventLoop::run() {
-    ws::Log::info("Event loop started");
+    WS_LOG_INFO("Event loop started");
 
     std::vector<PollEvent> evs;
 
     while (true) {
         rebuildPollSet();
 
-        int n = _poller.wait(evs, 1000);
+        int n = _poller.wait(evs, pollTimeout());
+        ws::refreshHttpDate(std::time(0)); // Date: форматируется раз в секунду, не на каждый ответ
         if (n < 0) continue;
 
         for (size_t i = 0; i < evs.size(); ++i) {
@@ -157,13 +285,25 @@ int EventLoop::run() {
                 continue;
             }
 
+            // пайп CGI / self-pipe?
+            std::map<int, Watch>::iterator w = _watchers.find(fd);
+            if (w != _watchers.end()) {
+                // зарегистрирован после сборки набора: событие было для прежнего
+                // владельца этого номера fd (закрыт и выдан заново в этой итерации)
+                if (w->second.seq <= _pollSeq) w->second.w->onIo(fd, ev);
+                continue;
+            }
+
             // иначе — соединение
             std::map<int, Connection*>::iterator it = _conns.find(fd);
             if (it == _conns.end()) continue;
 
             if (ev & (POLLERR | POLLHUP | POLLNVAL)) {
-                if (it->second->wantEvents() & POLLOUT) it->second->onWritable();
-                else if (it->second->wantEvents() & POLLIN) it->second->onReadable();
+                // клиента нет: остаток запроса ещё можно дочитать, отправить ответ — уже нет
+                // (send() даёт -1, неотличимое от «сокет полон», и poll крутился бы вхолостую)
+                short want = it->second->wantEvents();
+                if ((want & POLLIN) && !(want & POLLOUT)) it->second->onReadable();
+                else it->second->onHangup();
                 continue;
             }
 
@@ -171,6 +311,7 @@ int EventLoop::run() {
             if (ev & POLLOUT) it->second->onWritable();
         }
 
+        runTimers();
         gcClosed();
     }
 
@@ -0,0 +1,339 @@
+#include "webserv/net/FcgiPool.hpp"
+#include "webserv/net/EventLoop.hpp"
+#include "webserv/net/Listener.hpp"
+#include "webserv/utils/IO.hpp"
+#include "webserv/Log.hpp"
+
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cstdlib>
+#include <cstring>
+
+namespace ws {
+
+static const size_t FCGI_MPX_CAP = 32; // больше одновременных запросов на соединение не просим
+
+// ---------------- FcgiRequest ----------------
+
+FcgiRequest::FcgiRequest(FcgiUpstream* up, CgiClient* client, const std::string& env)
+  : _up(up), _client(client), _conn(0), _id(0), _stdinClosed(false), _done(false) {
+  fcgiEnvToParams(env, _params);
+}
+
+FcgiRequest::~FcgiRequest() {
+  if (_conn) _conn->abort(this);
+  else if (!_done) _up->cancel(this);
+}
+
+void FcgiRequest::writeStdin(const char* data, size_t n) {
+  if (_stdinClosed || _done || n == 0) return;
+  if (_conn) _conn->queue(FCGI_STDIN, _id, data, n);
+  else _stdin.append(data, n);
+}
+
+void FcgiRequest::closeStdin() {
+  if (_stdinClosed) return;
+  _stdinClosed = true;
+  if (_conn) _conn->queue(FCGI_STDIN, _id, 0, 0);
+}
+
+size_t FcgiRequest::stdinBacklog() const {
+  return _conn ? _conn->pendingOut() : _stdin.size();
+}
+
+void FcgiRequest::terminate() {
+  if (_done) return;
+  if (_conn) _conn->abort(this); // id освободится по FCGI_END_REQUEST
+  else _up->cancel(this);
+  finish();
+}
+
+void FcgiRequest::finish() {
+  _conn = 0;
+  _done = true;
+  _client->onCgiEvent(); // последним: клиент может удалить нас
+}
+
+// ---------------- FcgiConn ----------------
+
+FcgiConn::FcgiConn(FcgiUpstream* up, EventLoop* loop)
+  : _up(up), _loop(loop), _fd(-1), _state(CLOSED), _outOff(0), _maxReqs(1) {}
+
+FcgiConn::~FcgiConn() {
+  if (_fd >= 0) {
+    _loop->unwatch(_fd);
+    ::close(_fd);
+  }
+}
+
+bool FcgiConn::hasSlot() const { return _reqs.size() < _maxReqs; }
+
+bool FcgiConn::connect() {
+  int fd = ::socket(_up->family(), SOCK_STREAM, 0);
+  if (fd < 0) return false;
+  setNonBlocking(fd);
+  setCloseOnExec(fd);
+  if (::connect(fd, _up->sockAddr(), _up->sockLen()) == 0) {
+    _state = READY;
+  } else if (errno == EINPROGRESS || errno == EAGAIN) {
+    _state = CONNECTING;
+  } else {
+    ::close(fd);
+    return false;
+  }
+  _fd = fd;
+  _out.clear();
+  _outOff = 0;
+  _rd.reset();
+  _maxReqs = 1;
+  _loop->watch(_fd, this);
+
+  // умеет ли сервер мультиплексировать? до ответа — один запрос на соединение
+  std::string q;
+  fcgiAppendPair(q, "FCGI_MPXS_CONNS", 15, "", 0);
+  fcgiAppendPair(q, "FCGI_MAX_REQS", 13, "", 0);
+  queue(FCGI_GET_VALUES, 0, q.data(), q.size());
+  return true;
+}
+
+bool FcgiConn::attach(FcgiRequest* r) {
+  if (_state == CLOSED && !connect()) return false;
+  unsigned id = 1;
+  while (_reqs.count(id)) ++id;
+  _reqs[id] = r;
+  r->_conn = this;
+  r->_id = id;
+
+  if (_outOff == _out.size()) { _out.clear(); _outOff = 0; }
+  fcgiAppendBeginRequest(_out, id, true);
+  queue(FCGI_PARAMS, id, r->_params.data(), r->_params.size());
+  queue(FCGI_PARAMS, id, 0, 0);
+  std::string().swap(r->_params);
+  if (!r->_stdin.empty()) queue(FCGI_STDIN, id, r->_stdin.data(), r->_stdin.size());
+  std::string().swap(r->_stdin);
+  if (r->_stdinClosed) queue(FCGI_STDIN, id, 0, 0);
+  return true;
+}
+
+void FcgiConn::abort(FcgiRequest* r) {
+  std::map<unsigned, FcgiRequest*>::iterator it = _reqs.find(r->_id);
+  if (it != _reqs.end()) it->second = 0; // id занят до FCGI_END_REQUEST
+  queue(FCGI_ABORT_REQUEST, r->_id, 0, 0);
+  r->_conn = 0;
+}
+
+void FcgiConn::queue(int type, unsigned id, const char* data, size_t n) {
+  if (_outOff == _out.size()) { _out.clear(); _outOff = 0; }
+  fcgiAppendRecord(_out, type, id, data, n);
+}
+
+short FcgiConn::ioEvents(int) const {
+  if (_state == CONNECTING) return POLLOUT;
+  if (_state != READY) return 0;
+  short ev = pendingOut() ? POLLOUT : 0;
+  // вывод не забирают — не читаем (в т.ч. за соседей по соединению)
+  for (std::map<unsigned, FcgiRequest*>::const_iterator it = _reqs.begin(); it != _reqs.end(); ++it)
+    if (it->second && it->second->_out.size() >= CgiBackend::OUT_HIGH) return ev;
+  return ev | POLLIN;
+}
+
+void FcgiConn::onIo(int, short revents) {
+  if (_state == CONNECTING) {
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (::getsockopt(_fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0 || err != 0) {
+      fail();
+      return;
+    }
+    _state = READY;
+    return;
+  }
+
+  if ((revents & POLLOUT) && pendingOut()) {
+    ssize_t n = ::send(_fd, _out.data() + _outOff, pendingOut(), 0);
+    if (n < 0 && ioTryAgain()) n = 0; // сокет полон: допишем по следующему POLLOUT
+    else if (n <= 0) { fail(); return; }
+    _outOff += (size_t)n;
+  }
+  if (!(revents & (POLLIN | POLLHUP | POLLERR))) return;
+
+  char buf[65536];
+  ssize_t n = ::recv(_fd, buf, sizeof(buf), 0);
+  if (n < 0 && ioTryAgain()) return;
+  if (n <= 0) { fail(); return; } // сервер закрыл соединение: следующий attach переподключится
+  _rd.feed(buf, (size_t)n);
+  FcgiRecord rec;
+  while (_state == READY && _rd.next(rec))
+    onRecord(rec);
+}
+
+void FcgiConn::onRecord(const FcgiRecord& rec) {
+  if (rec.id == 0) {
+    if (rec.type != FCGI_GET_VALUES_RESULT) return;
+    std::map<std::string, std::string> vals;
+    if (!fcgiParsePairs(rec.content, vals) || vals["FCGI_MPXS_CONNS"] != "1") return;
+    size_t n = (size_t)std::atoi(vals["FCGI_MAX_REQS"].c_str());
+    _maxReqs = (n == 0 || n > FCGI_MPX_CAP) ? FCGI_MPX_CAP : n;
+    _up->dispatch();
+    return;
+  }
+
+  std::map<unsigned, FcgiRequest*>::iterator it = _reqs.find(rec.id);
+  if (it == _reqs.end()) return;
+  FcgiRequest* r = it->second; // 0: владелец ушёл, вывод выбрасываем
+
+  switch (rec.type) {
+    case FCGI_STDOUT:
+      if (r && !rec.content.empty()) {
+        r->_out += rec.content;
+        r->_client->onCgiEvent();
+      }
+      break;
+    case FCGI_STDERR:
+      if (!rec.content.empty()) WS_LOG_WARN("fastcgi stderr: " + rec.content);
+      break;
+    case FCGI_END_REQUEST:
+      _reqs.erase(it);
+      if (r) r->finish();
+      _up->dispatch();
+      break;
+    default:
+      break;
+  }
+}
+
+void FcgiConn::fail() {
+  if (_fd >= 0) {
+    _loop->unwatch(_fd);
+    ::close(_fd);
+    _fd = -1;
+  }
+  _state = CLOSED;
+  _out.clear();
+  _outOff = 0;
+  _rd.reset();
+  _maxReqs = 1;
+
+  std::map<unsigned, FcgiRequest*> reqs;
+  reqs.swap(_reqs);
+  for (std::map<unsigned, FcgiRequest*>::iterator it = reqs.begin(); it != reqs.end(); ++it)
+    if (it->second) it->second->finish(); // что успело прийти — отдаст клиент; пусто -> 502
+  _up->dispatch();
+}
+
+// ---------------- FcgiUpstream ----------------
+
+FcgiUpstream::FcgiUpstream(const FcgiAddress& addr, EventLoop* loop)
+  : _addr(addr), _loop(loop), _saLen(0) {
+  std::memset(&_sa, 0, sizeof(_sa));
+}
+
+FcgiUpstream::~FcgiUpstream() {
+  for (size_t i = 0; i < _conns.size(); ++i) delete _conns[i];
+}
+
+bool FcgiUpstream::resolve(std::string& err) {
+  if (_addr.isUnix) {
+    struct sockaddr_un* un = reinterpret_cast<struct sockaddr_un*>(&_sa);
+    if (_addr.path.size() >= sizeof(un->sun_path)) {
+      err = "fastcgi_pass: unix socket path too long: " + _addr.path;
+      return false;
+    }
+    un->sun_family = AF_UNIX;
+    std::memcpy(un->sun_path, _addr.path.c_str(), _addr.path.size() + 1);
+    _saLen = sizeof(struct sockaddr_un);
+    return true;
+  }
+  struct addrinfo hints;
+  std::memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo* res = 0;
+  if (::getaddrinfo(_addr.host.c_str(), 0, &hints, &res) != 0 || !res) {
+    err = "fastcgi_pass: cannot resolve " + _addr.host;
+    return false;
+  }
+  struct sockaddr_in* in = reinterpret_cast<struct sockaddr_in*>(&_sa);
+  std::memcpy(in, res->ai_addr, sizeof(struct sockaddr_in));
+  in->sin_port = htons((unsigned short)_addr.port);
+  _saLen = sizeof(struct sockaddr_in);
+  ::freeaddrinfo(res);
+  return true;
+}
+
+FcgiRequest* FcgiUpstream::open(const std::string& env, CgiClient* client) {
+  FcgiRequest* r = new FcgiRequest(this, client, env);
+  if (!_waiting.empty()) { // очередь уже есть — встаём в конец
+    _waiting.push_back(r);
+    return r;
+  }
+  FcgiConn* c = 0;
+  for (size_t i = 0; i < _conns.size() && !c; ++i)
+    if (_conns[i]->hasSlot()) c = _conns[i];
+  if (!c && _conns.size() < MAX_CONNS) {
+    c = new FcgiConn(this, _loop);
+    _conns.push_back(c);
+  }
+  if (!c) {
+    _waiting.push_back(r);
+    return r;
+  }
+  if (!c->attach(r)) { // сервер недоступен
+    r->_done = true;
+    delete r;
+    return 0;
+  }
+  return r;
+}
+
+void FcgiUpstream::dispatch() {
+  while (!_waiting.empty()) {
+    FcgiConn* c = 0;
+    for (size_t i = 0; i < _conns.size() && !c; ++i)
+      if (_conns[i]->hasSlot()) c = _conns[i];
+    if (!c && _conns.size() < MAX_CONNS) {
+      c = new FcgiConn(this, _loop);
+      _conns.push_back(c);
+    }
+    if (!c) return;
+    FcgiRequest* r = _waiting.front();
+    _waiting.pop_front();
+    if (!c->attach(r)) r->finish(); // пустой вывод -> 502
+  }
+}
+
+void FcgiUpstream::cancel(FcgiRequest* r) {
+  for (std::deque<FcgiRequest*>::iterator it = _waiting.begin(); it != _waiting.end(); ++it)
+    if (*it == r) { _waiting.erase(it); return; }
+}
+
+// ---------------- FcgiPool ----------------
+
+FcgiPool::~FcgiPool() {
+  for (std::map<std::string, FcgiUpstream*>::iterator it = _ups.begin(); it != _ups.end(); ++it)
+    delete it->second;
+}
+
+bool FcgiPool::add(const std::string& spec, EventLoop* loop, std::string& err) {
+  if (_ups.count(spec)) return true;
+  FcgiAddress a;
+  if (!fcgiParseAddress(spec, a, err)) return false;
+  FcgiUpstream* up = new FcgiUpstream(a, loop);
+  if (!up->resolve(err)) {
+    delete up;
+    return false;
+  }
+  _ups[spec] = up;
+  return true;
+}
+
+FcgiRequest* FcgiPool::open(const std::string& spec, const std::string& env, CgiClient* client) {
+  std::map<std::string, FcgiUpstream*>::iterator it = _ups.find(spec);
+  return it == _ups.end() ? 0 : it->second->open(env, client);
+}
+
+} // namespace ws
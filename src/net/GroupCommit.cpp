@@ -0,0 +1,152 @@
+#include "webserv/net/GroupCommit.hpp"
+#include "webserv/net/EventLoop.hpp"
+#include "webserv/utils/Time.hpp"
+#include "webserv/Log.hpp"
+
+#include <map>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace ws {
+
+// fsync (dir) / fdatasync (файл) по пути; fsync работает с inode, fd годится любой
+static bool syncPath(const std::string& path, bool dir) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+#ifdef __linux__
+  int r = dir ? ::fsync(fd) : ::fdatasync(fd);
+#else
+  int r = ::fsync(fd);
+#endif
+  ::close(fd);
+  return r == 0;
+}
+
+// родитель в записи пути: "a/b" -> "a", "a" -> ".", "/a" -> "/"; "" — выше некуда
+static std::string parentDir(const std::string& path) {
+  std::string::size_type end = path.find_last_not_of('/');
+  if (end == std::string::npos || path == ".") return "";
+  std::string::size_type slash = path.rfind('/', end);
+  if (slash == std::string::npos) return ".";
+  std::string::size_type keep = path.find_last_not_of('/', slash);
+  return keep == std::string::npos ? "/" : path.substr(0, keep + 1);
+}
+
+// задача пула: одна группа целиком
+struct SyncTask : public AioTask {
+  std::vector<DurableWait*> waits;
+  bool viaSyncfs;
+
+  SyncTask() : viaSyncfs(false) {}
+  ~SyncTask() {
+    for (size_t i = 0; i < waits.size(); ++i) delete waits[i];
+  }
+
+  void run() {
+    std::map<std::string, bool> done;  // путь -> уже на диске
+#ifdef __linux__
+    size_t files = 0;
+    for (size_t i = 0; i < waits.size(); ++i) files += waits[i]->files.size();
+    if (files >= GroupCommit::SYNCFS_MIN) syncByFilesystem(done);
+#endif
+    for (size_t i = 0; i < waits.size(); ++i) {
+      DurableWait* w = waits[i];
+      w->ok = true;
+      for (size_t j = 0; j < w->files.size(); ++j)
+        w->ok = syncOnce(done, w->files[j], false) && w->ok;
+      // ensureDirRecursive мог создать любой каталог пути: запись о каждом новом
+      // лежит в его родителе, поэтому fsync — вверх до начала пути
+      for (std::string d = w->dir; !d.empty(); d = parentDir(d))
+        w->ok = syncOnce(done, d, true) && w->ok;
+    }
+  }
+
+  static bool syncOnce(std::map<std::string, bool>& done, const std::string& path, bool dir) {
+    std::map<std::string, bool>::iterator it = done.find(path);
+    if (it == done.end()) it = done.insert(std::make_pair(path, syncPath(path, dir))).first;
+    return it->second;
+  }
+
+#ifdef __linux__
+  // много файлов: один syncfs() на файловую систему вместо fdatasync на каждый
+  void syncByFilesystem(std::map<std::string, bool>& done) {
+    std::map<std::string, dev_t> devOf;
+    for (size_t i = 0; i < waits.size(); ++i) {
+      struct stat st;
+      for (std::string d = waits[i]->dir; !d.empty(); d = parentDir(d))
+        if (::stat(d.c_str(), &st) == 0) devOf[d] = st.st_dev;
+      for (size_t j = 0; j < waits[i]->files.size(); ++j)
+        if (::stat(waits[i]->files[j].c_str(), &st) == 0) devOf[waits[i]->files[j]] = st.st_dev;
+    }
+    std::map<dev_t, bool> fsOk;
+    for (std::map<std::string, dev_t>::iterator it = devOf.begin(); it != devOf.end(); ++it) {
+      std::map<dev_t, bool>::iterator f = fsOk.find(it->second);
+      if (f == fsOk.end()) {
+        int fd = ::open(it->first.c_str(), O_RDONLY);
+        f = fsOk.insert(std::make_pair(it->second, fd >= 0 && ::syncfs(fd) == 0)).first;
+        if (fd >= 0) ::close(fd);
+      }
+      if (f->second) done[it->first] = true;  // иначе — по одному, как без syncfs
+    }
+    viaSyncfs = true;
+  }
+#endif
+};
+
+GroupCommit::~GroupCommit() {
+  if (!_pending.empty() && _loop) _loop->cancelTimer(this);
+  for (size_t i = 0; i < _pending.size(); ++i) delete _pending[i];
+}
+
+DurableWait* GroupCommit::request(DurableClient* c, const std::vector<std::string>& files,
+                                  const std::string& dir, size_t delayMs, size_t batch) {
+  DurableWait* w = new DurableWait;
+  w->client = c;
+  w->files = files;
+  w->dir = dir;
+  ++_st.requests;
+
+  if (_pending.empty() || batch < _batch) _batch = batch;
+  _pending.push_back(w);
+  const long long now = monotonicMs();
+  long long deadline = now + (long long)delayMs;
+  if (_pending.size() >= _batch) deadline = now;  // группа набрана: на ближайшей итерации цикла
+  if (_pending.size() == 1 || deadline < _deadline) {
+    _deadline = deadline;
+    _loop->setTimer(this, deadline - now);
+  }
+  return w;
+}
+
+void GroupCommit::onTimer() {
+  flush();
+}
+
+void GroupCommit::flush() {
+  if (_pending.empty()) return;
+  _loop->cancelTimer(this);
+  SyncTask* t = new SyncTask;
+  t->waits.swap(_pending);
+  ++_st.batches;
+  if (t->waits.size() > _st.largestBatch) _st.largestBatch = t->waits.size();
+  if (_loop->aio().submit(t, this)) return;
+  t->run();  // пул не запущен или очередь полна — синхронно в цикле
+  onAioDone(t);
+  delete t;
+}
+
+void GroupCommit::onAioDone(AioTask* at) {
+  SyncTask* t = static_cast<SyncTask*>(at);
+  if (t->viaSyncfs) ++_st.syncfs;
+  for (size_t i = 0; i < t->waits.size(); ++i) {
+    DurableWait* w = t->waits[i];
+    if (!w->ok) {
+      ++_st.failures;
+      WS_LOG_WARN("upload_durability: sync failed in " + w->dir);
+    }
+    if (w->client) w->client->onDurable(w->ok);
+  }
+}
+
+} // namespace ws
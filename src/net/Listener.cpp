@@ -18,6 +18,10 @@ namespace ws
 			return false;
 		return fcntl(fd, F_SETFL, fl | O_NONBLOCK) == 0;
 	}
+	bool setCloseOnExec(int fd)
+	{
+		return fcntl(fd, F_SETFD, FD_CLOEXEC) == 0;
+	}
 	bool setReuseAddr(int fd)
 	{
 		int yes = 1;
@@ -35,16 +39,17 @@ namespace ws
 		_fd = ::socket(AF_INET, SOCK_STREAM, 0);
 		if (_fd < 0)
 		{
-			ws::Log::error(std::string("socket() failed: ") + std::strerror(errno));
+			WS_LOG_ERROR(std::string("socket() failed: ") + std::strerror(errno));
 			return false;
 		}
 		if (!setReuseAddr(_fd))
-			ws::Log::warn("setsockopt(SO_REUSEADDR) failed");
+			WS_LOG_WARN("setsockopt(SO_REUSEADDR) failed");
 		if (!setNonBlocking(_fd))
 		{
-			ws::Log::error("fcntl(O_NONBLOCK) failed");
+			WS_LOG_ERROR("fcntl(O_NONBLOCK) failed");
 			return false;
 		}
+		setCloseOnExec(_fd);
 
 		struct sockaddr_in sa;
 		std::memset(&sa, 0, sizeof(sa));
@@ -80,7 +85,7 @@ namespace ws
 				int rc = getaddrinfo(host.c_str(), NULL, &hints, &res);
 				if (rc != 0)
 				{
-					ws::Log::error(std::string("getaddrinfo(\"") + host + "\") failed: " + gai_strerror(rc));
+					WS_LOG_ERROR(std::string("getaddrinfo(\"") + host + "\") failed: " + gai_strerror(rc));
 					return false;
 				}
 				// берём первый IPv4
@@ -96,17 +101,17 @@ namespace ws
 
 		if (::bind(_fd, (struct sockaddr *)&sa, sizeof(sa)) != 0)
 		{
-			ws::Log::error(std::string("bind() failed: ") + std::strerror(errno));
+			WS_LOG_ERROR(std::string("bind() failed: ") + std::strerror(errno));
 			return false;
 		}
 		if (::listen(_fd, 128) != 0)
 		{
-			ws::Log::error(std::string("listen() failed: ") + std::strerror(errno));
+			WS_LOG_ERROR(std::string("listen() failed: ") + std::strerror(errno));
 			return false;
 		}
 
 		_bind = host + ":" + (port <= 0 ? std::string("0") : std::to_string(port));
-		ws::Log::info("Listening on " + _bind);
+		WS_LOG_INFO("Listening on " + _bind);
 		return true;
 	}
 }
\ No newline at end of file
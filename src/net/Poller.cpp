@@ -46,6 +46,7 @@ namespace ws
 
 	int Poller::wait(std::vector<PollEvent> &out, int timeout_ms)
 	{
+		out.clear(); // при таймауте/ошибке не отдавать события прошлой итерации
 		std::vector<struct pollfd> pfds(_items.size());
 		for (size_t i = 0; i < _items.size(); ++i)
 		{
@@ -57,7 +58,6 @@ namespace ws
 		if (n <= 0)
 			return n;
 
-		out.clear();
 		out.reserve(pfds.size());
 		for (size_t i = 0; i < pfds.size(); ++i)
 		{
@@ -0,0 +1,358 @@
+#include "webserv/net/ProxyPool.hpp"
+#include "webserv/net/EventLoop.hpp"
+#include "webserv/net/Listener.hpp"
+#include "webserv/utils/IO.hpp"
+#include "webserv/net/ResponseBuilder.hpp"
+#include "webserv/Log.hpp"
+
+#include <sys/socket.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cstring>
+
+namespace ws {
+
+// ---------------- ProxyRequest ----------------
+
+ProxyRequest::ProxyRequest(ProxyUpstream* up, CgiClient* client, const std::string& head,
+                           ProxyBody body, bool headRequest)
+  : _up(up), _client(client), _conn(0), _head(head), _body(body), _headRequest(headRequest),
+    _stdinClosed(false), _retried(false), _done(false), _broken(false) {}
+
+ProxyRequest::~ProxyRequest() {
+  if (_conn) _conn->abandon(this);
+  else if (!_done) _up->cancel(this);
+}
+
+void ProxyRequest::encode(std::string& dst, const char* data, size_t n) const {
+  if (_body != PROXY_BODY_CHUNKED) {
+    dst.append(data, n);
+    return;
+  }
+  appendHex(dst, (unsigned long long)n);
+  dst += "\r\n";
+  dst.append(data, n);
+  dst += "\r\n";
+}
+
+void ProxyRequest::writeStdin(const char* data, size_t n) {
+  if (_stdinClosed || _done || n == 0 || _body == PROXY_BODY_NONE) return;
+  if (!_conn) {
+    encode(_stdin, data, n);
+    return;
+  }
+  std::string chunk;
+  encode(chunk, data, n);
+  _conn->queue(chunk);
+}
+
+void ProxyRequest::closeStdin() {
+  if (_stdinClosed) return;
+  _stdinClosed = true;
+  if (_body != PROXY_BODY_CHUNKED || _done) return;
+  if (_conn) _conn->queue("0\r\n\r\n");
+  else _stdin += "0\r\n\r\n";
+}
+
+size_t ProxyRequest::stdinBacklog() const {
+  return _conn ? _conn->pendingOut() : _stdin.size();
+}
+
+void ProxyRequest::terminate() {
+  if (_done) return;
+  if (_conn) _conn->abandon(this);
+  else _up->cancel(this);
+  _broken = true;
+  finish();
+}
+
+void ProxyRequest::finish() {
+  _conn = 0;
+  _done = true;
+  _client->onCgiEvent(); // последним: клиент может удалить нас
+}
+
+// ---------------- ProxyConn ----------------
+
+ProxyConn::ProxyConn(ProxyUpstream* up, EventLoop* loop)
+  : _up(up), _loop(loop), _fd(-1), _state(CLOSED), _outOff(0), _req(0), _reused(false) {}
+
+ProxyConn::~ProxyConn() {
+  close();
+}
+
+bool ProxyConn::connect() {
+  int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) return false;
+  setNonBlocking(fd);
+  setCloseOnExec(fd);
+  if (::connect(fd, _up->sockAddr(), _up->sockLen()) == 0) {
+    _state = READY;
+  } else if (errno == EINPROGRESS || errno == EAGAIN) {
+    _state = CONNECTING;
+  } else {
+    ::close(fd);
+    return false;
+  }
+  _fd = fd;
+  _out.clear();
+  _outOff = 0;
+  _loop->watch(_fd, this);
+  return true;
+}
+
+void ProxyConn::close() {
+  if (_fd >= 0) {
+    _loop->unwatch(_fd);
+    ::close(_fd);
+    _fd = -1;
+  }
+  _state = CLOSED;
+  std::string().swap(_out);
+  _outOff = 0;
+}
+
+bool ProxyConn::attach(ProxyRequest* r) {
+  _reused = _state != CLOSED;
+  if (_state == CLOSED && !connect()) return false;
+  _req = r;
+  r->_conn = this;
+  _rd.reset(r->_headRequest);
+  queue(r->_head);
+  if (!r->_stdin.empty()) queue(r->_stdin);
+  std::string().swap(r->_stdin);
+  return true;
+}
+
+void ProxyConn::queue(const std::string& data) {
+  if (_outOff == _out.size()) { _out.clear(); _outOff = 0; }
+  _out += data;
+}
+
+void ProxyConn::abandon(ProxyRequest* r) {
+  r->_conn = 0;
+  if (_req != r) return;
+  _req = 0;
+  close(); // посреди ответа соединение уже не вернуть в пул
+  _up->dispatch();
+}
+
+short ProxyConn::ioEvents(int) const {
+  if (_state == CONNECTING) return POLLOUT;
+  if (_state != READY) return 0;
+  short ev = pendingOut() ? POLLOUT : 0;
+  // в пуле — ждём только закрытия со стороны backend; иначе читаем, пока вывод забирают
+  if (!_req || _req->_out.size() < CgiBackend::OUT_HIGH) ev |= POLLIN;
+  return ev;
+}
+
+void ProxyConn::onIo(int, short revents) {
+  if (_state == CONNECTING) {
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (::getsockopt(_fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0 || err != 0) {
+      fail();
+      return;
+    }
+    _state = READY;
+    return;
+  }
+
+  if ((revents & POLLOUT) && pendingOut()) {
+    ssize_t n = ::send(_fd, _out.data() + _outOff, pendingOut(), 0);
+    if (n < 0 && ioTryAgain()) n = 0; // сокет полон: допишем по следующему POLLOUT
+    else if (n <= 0) { fail(); return; }
+    _outOff += (size_t)n;
+  }
+  if (!(revents & (POLLIN | POLLHUP | POLLERR))) return;
+
+  char buf[65536];
+  ssize_t n = ::recv(_fd, buf, sizeof(buf), 0);
+  if (n < 0 && ioTryAgain()) return; // устаревшее событие: соединение живо
+  if (!_req) { // из пула: backend закрыл соединение (или прислал лишнее)
+    close();
+    _up->dispatch();
+    return;
+  }
+  if (n <= 0) {
+    _rd.eof();
+    if (_rd.done()) complete();
+    else fail();
+    return;
+  }
+  ProxyRequest* r = _req;
+  size_t before = r->_out.size();
+  if (!_rd.feed(buf, (size_t)n, r->_out)) {
+    WS_LOG_WARN("proxy_pass: malformed response from " + _up->target().host);
+    fail();
+    return;
+  }
+  if (_rd.done()) { complete(); return; }
+  if (r->_out.size() != before) r->_client->onCgiEvent(); // последним
+}
+
+void ProxyConn::complete() {
+  ProxyRequest* r = _req;
+  // в пул — только если ответ и запрос дошли целиком и backend не против
+  bool reuse = _rd.keepAlive() && r->_stdinClosed && !pendingOut();
+  _req = 0;
+  r->_conn = 0;
+  if (!reuse) close();
+  r->finish(); // клиент может удалить r, но не нас
+  _up->dispatch();
+}
+
+void ProxyConn::fail() {
+  ProxyRequest* r = _req;
+  bool stale = _reused && !_rd.started();
+  _req = 0;
+  close();
+  if (!r) {
+    _up->dispatch();
+    return;
+  }
+  r->_conn = 0;
+  // соединение из пула оказалось закрытым: безопасно повторить запрос без тела
+  if (stale && r->_body == PROXY_BODY_NONE && !r->_retried) {
+    r->_retried = true;
+    if (_up->retry(r)) return;
+  }
+  r->_broken = true;
+  r->finish(); // пустой вывод -> 502; после заголовков — обрыв для клиента
+  _up->dispatch();
+}
+
+// ---------------- ProxyUpstream ----------------
+
+ProxyUpstream::ProxyUpstream(const ProxyTarget& t, EventLoop* loop) : _t(t), _loop(loop) {
+  std::memset(&_sa, 0, sizeof(_sa));
+}
+
+ProxyUpstream::~ProxyUpstream() {
+  for (size_t i = 0; i < _conns.size(); ++i) delete _conns[i];
+}
+
+bool ProxyUpstream::resolve(std::string& err) {
+  struct addrinfo hints;
+  std::memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo* res = 0;
+  if (::getaddrinfo(_t.host.c_str(), 0, &hints, &res) != 0 || !res) {
+    err = "proxy_pass: cannot resolve " + _t.host;
+    return false;
+  }
+  std::memcpy(&_sa, res->ai_addr, sizeof(_sa));
+  _sa.sin_port = htons((unsigned short)_t.port);
+  ::freeaddrinfo(res);
+  return true;
+}
+
+// закрытое (или новое) соединение; 0 — уже MAX_CONNS живых
+ProxyConn* ProxyUpstream::freshConn() {
+  ProxyConn* c = 0;
+  size_t live = 0;
+  for (size_t i = 0; i < _conns.size(); ++i) {
+    if (!_conns[i]->closed()) ++live;
+    else if (!c) c = _conns[i];
+  }
+  if (live >= MAX_CONNS) return 0;
+  if (!c) {
+    c = new ProxyConn(this, _loop);
+    _conns.push_back(c);
+  }
+  return c;
+}
+
+ProxyConn* ProxyUpstream::freeConn() {
+  for (size_t i = _conns.size(); i-- > 0;) // любое свободное из пула
+    if (_conns[i]->idle()) return _conns[i];
+  return freshConn();
+}
+
+ProxyRequest* ProxyUpstream::open(const std::string& head, ProxyBody body, bool headRequest,
+                                  CgiClient* client) {
+  ProxyRequest* r = new ProxyRequest(this, client, head, body, headRequest);
+  ProxyConn* c = _waiting.empty() ? freeConn() : 0; // очередь уже есть — встаём в конец
+  if (!c) {
+    _waiting.push_back(r);
+    return r;
+  }
+  if (!c->attach(r)) {
+    r->_done = true;
+    delete r;
+    return 0;
+  }
+  return r;
+}
+
+bool ProxyUpstream::retry(ProxyRequest* r) {
+  ProxyConn* c = freshConn();
+  return c && c->attach(r);
+}
+
+void ProxyUpstream::dispatch() {
+  while (!_waiting.empty()) {
+    ProxyConn* c = freeConn();
+    if (!c) return;
+    ProxyRequest* r = _waiting.front();
+    _waiting.pop_front();
+    if (!c->attach(r)) {
+      r->_broken = true;
+      r->finish(); // пустой вывод -> 502
+    }
+  }
+}
+
+void ProxyUpstream::cancel(ProxyRequest* r) {
+  for (std::deque<ProxyRequest*>::iterator it = _waiting.begin(); it != _waiting.end(); ++it)
+    if (*it == r) { _waiting.erase(it); return; }
+}
+
+// ---------------- ProxyPool ----------------
+
+ProxyPool::~ProxyPool() {
+  for (std::map<std::string, ProxyUpstream*>::iterator it = _ups.begin(); it != _ups.end(); ++it)
+    delete it->second;
+}
+
+bool ProxyPool::add(const std::string& spec, EventLoop* loop, std::string& err) {
+  if (_ups.count(spec)) return true;
+  ProxyTarget t;
+  if (!proxyParseTarget(spec, t, err)) return false;
+  ProxyUpstream* up = new ProxyUpstream(t, loop);
+  if (!up->resolve(err)) {
+    delete up;
+    return false;
+  }
+  _ups[spec] = up;
+  return true;
+}
+
+ProxyRequest* ProxyPool::open(const Location* loc, const HttpRequest& req,
+                              const std::string& clientAddr, CgiClient* client) {
+  std::map<std::string, ProxyUpstream*>::iterator it = _ups.find(loc->proxy_pass);
+  if (it == _ups.end()) return 0;
+  const ProxyTarget& t = it->second->target();
+
+  // proxy_pass с URI заменяет префикс location (как в nginx); без URI — target как есть
+  std::string target = req.getRawTarget().empty() ? req.target : req.getRawTarget();
+  if (!t.uri.empty() && loc->match == LOC_PREFIX && target.compare(0, loc->path.size(), loc->path) == 0) {
+    std::string tail = target.substr(loc->path.size());
+    if (!tail.empty() && tail[0] == '/' && t.uri[t.uri.size() - 1] == '/') tail.erase(0, 1);
+    target = t.uri + tail;
+  }
+
+  std::string host = t.host;
+  if (t.port != 80) {
+    host += ':';
+    appendUint(host, (unsigned long long)t.port);
+  }
+  ProxyBody body;
+  std::string head = proxyRequestHead(req, target, host, clientAddr, body);
+  return it->second->open(head, body, req.method_id == M_HEAD, client);
+}
+
+} // namespace ws
@@ -1,14 +1,134 @@
 #include "webserv/net/ResponseBuilder.hpp"
 #include "webserv/utils/Time.hpp"
-#include <sstream>
-#include <iomanip>
 
 namespace ws {
 
-static std::string hexLower(size_t x) {
-  std::ostringstream oss;
-  oss << std::hex << std::nouppercase << x;
-  return oss.str();
+// постоянные фрагменты заголовков
+static const char kServerDate[]  = "Server: webserv-dev\r\nDate: ";
+static const char kCtype[]       = "\r\nContent-Type: ";
+static const char kClen[]        = "\r\nContent-Length: ";
+static const char kChunked[]     = "\r\nTransfer-Encoding: chunked\r\n";
+static const char kKeepAlive[]   = "Connection: keep-alive\r\nKeep-Alive: timeout=5, max=100\r\n";
+static const char kClose[]       = "Connection: close\r\n";
+static const char kLocation[]    = "Location: ";
+
+#define WS_APPEND_LIT(out, lit) (out).append((lit), sizeof(lit) - 1)
+
+struct StatusLine { int code; const char* reason; const char* line; size_t len; };
+#define WS_STATUS(c, r) { c, r, "HTTP/1.1 " #c " " r "\r\n", sizeof("HTTP/1.1 " #c " " r "\r\n") - 1 }
+static const StatusLine kStatus[] = {
+  WS_STATUS(200, "OK"),
+  WS_STATUS(201, "Created"),
+  WS_STATUS(204, "No Content"),
+  WS_STATUS(206, "Partial Content"),
+  WS_STATUS(301, "Moved Permanently"),
+  WS_STATUS(302, "Found"),
+  WS_STATUS(304, "Not Modified"),
+  WS_STATUS(400, "Bad Request"),
+  WS_STATUS(403, "Forbidden"),
+  WS_STATUS(404, "Not Found"),
+  WS_STATUS(405, "Method Not Allowed"),
+  WS_STATUS(409, "Conflict"),
+  WS_STATUS(411, "Length Required"),
+  WS_STATUS(413, "Payload Too Large"),
+  WS_STATUS(415, "Unsupported Media Type"),
+  WS_STATUS(416, "Range Not Satisfiable"),
+  WS_STATUS(500, "Internal Server Error"),
+  WS_STATUS(501, "Not Implemented"),
+  WS_STATUS(502, "Bad Gateway"),
+  WS_STATUS(503, "Service Unavailable"),
+  WS_STATUS(504, "Gateway Timeout")
+};
+#undef WS_STATUS
+
+void appendUint(std::string& out, unsigned long long v) {
+  char buf[24];
+  char* p = buf + sizeof(buf);
+  do { *--p = char('0' + v % 10); v /= 10; } while (v);
+  out.append(p, (size_t)(buf + sizeof(buf) - p));
+}
+
+void appendHex(std::string& out, unsigned long long v) {
+  static const char digits[] = "0123456789abcdef";
+  char buf[20];
+  char* p = buf + sizeof(buf);
+  do { *--p = digits[v & 0xf]; v >>= 4; } while (v);
+  out.append(p, (size_t)(buf + sizeof(buf) - p));
+}
+
+void appendStatusLine(std::string& out, int code, const std::string& reason) {
+  for (size_t i = 0; i < sizeof(kStatus) / sizeof(kStatus[0]); ++i) {
+    if (kStatus[i].code == code && reason == kStatus[i].reason) {
+      out.append(kStatus[i].line, kStatus[i].len);
+      return;
+    }
+  }
+  WS_APPEND_LIT(out, "HTTP/1.1 ");
+  appendUint(out, (unsigned long long)(code < 0 ? 0 : code));
+  out += ' ';
+  out += reason;
+  WS_APPEND_LIT(out, "\r\n");
+}
+
+void appendConnection(std::string& out, bool keepAlive) {
+  if (keepAlive) WS_APPEND_LIT(out, kKeepAlive);
+  else           WS_APPEND_LIT(out, kClose);
+}
+
+// status-line + Server + Date + Content-Type (без завершающего CRLF)
+static void appendHead(std::string& out, int code, const std::string& reason,
+                       const std::string& date, const std::string& ctype) {
+  appendStatusLine(out, code, reason);
+  WS_APPEND_LIT(out, kServerDate);
+  out += date;
+  WS_APPEND_LIT(out, kCtype);
+  out += ctype;
+}
+
+static void appendTail(std::string& out, bool keepAlive,
+                       const std::string& location, const std::string& extra) {
+  appendConnection(out, keepAlive);
+  if (!location.empty()) {
+    WS_APPEND_LIT(out, kLocation);
+    out += location;
+    WS_APPEND_LIT(out, "\r\n");
+  }
+  if (!extra.empty()) out += extra;
+  WS_APPEND_LIT(out, "\r\n");
+}
+
+static void appendHeadersWithDate(std::string& out, int code, const std::string& reason,
+                                  const std::string& ctype, size_t clen, bool keepAlive,
+                                  const std::string& location, const std::string& date,
+                                  const std::string& extra) {
+  appendHead(out, code, reason, date, ctype);
+  WS_APPEND_LIT(out, kClen);
+  appendUint(out, (unsigned long long)clen);
+  WS_APPEND_LIT(out, "\r\n");
+  appendTail(out, keepAlive, location, extra);
+}
+
+void appendHeaders(std::string& out,
+                   int code,
+                   const std::string& reason,
+                   const std::string& ctype,
+                   size_t clen,
+                   bool keepAlive,
+                   const std::string& location,
+                   const std::string& extra) {
+  appendHeadersWithDate(out, code, reason, ctype, clen, keepAlive, location,
+                        httpDateCached(), extra);
+}
+
+void appendChunkedHeaders(std::string& out,
+                          int code,
+                          const std::string& reason,
+                          const std::string& ctype,
+                          bool keepAlive,
+                          const std::string& extra) {
+  appendHead(out, code, reason, httpDateCached(), ctype);
+  WS_APPEND_LIT(out, kChunked);
+  appendTail(out, keepAlive, std::string(), extra);
 }
 
 std::string buildHeaders(int code,
@@ -19,25 +139,46 @@ std::string buildHeaders(int code,
                          const std::string& location,
                          const std::string& dateStr,
                          const std::string& extra) {
-  std::ostringstream oss;
-  oss << "HTTP/1.1 " << code << ' ' << reason << "\r\n";
-  oss << "Server: webserv-dev\r\n";
-  oss << "Date: " << (dateStr.empty() ? httpDateNow() : dateStr) << "\r\n";
-  oss << "Content-Type: " << ctype << "\r\n";
-  oss << "Content-Length: " << (int)clen << "\r\n";
-  oss << "Connection: " << (keepAlive ? "keep-alive" : "close") << "\r\n";
-  if (keepAlive) oss << "Keep-Alive: timeout=5, max=100\r\n";
-  if (!location.empty()) oss << "Location: " << location << "\r\n";
-  if (!extra.empty()) oss << extra;
-  oss << "\r\n";
-  return oss.str();
+  std::string out;
+  out.reserve(256);
+  appendHeadersWithDate(out, code, reason, ctype, clen, keepAlive, location,
+                        dateStr.empty() ? httpDateCached() : dateStr, extra);
+  return out;
+}
+
+void renderHeaderTemplate(HeaderTemplate& tpl, int code, const std::string& reason,
+                          const std::string& ctype, size_t clen) {
+  tpl.pre.clear();
+  appendStatusLine(tpl.pre, code, reason);
+  WS_APPEND_LIT(tpl.pre, kServerDate);
+  tpl.post.clear();
+  WS_APPEND_LIT(tpl.post, kCtype);
+  tpl.post += ctype;
+  WS_APPEND_LIT(tpl.post, kClen);
+  appendUint(tpl.post, (unsigned long long)clen);
+  WS_APPEND_LIT(tpl.post, "\r\n");
+}
+
+void appendFromTemplate(std::string& out, const HeaderTemplate& tpl, bool keepAlive,
+                        const char* extra) {
+  out += tpl.pre;
+  out += httpDateCached();
+  out += tpl.post;
+  appendConnection(out, keepAlive);
+  if (extra) out += extra;
+  WS_APPEND_LIT(out, "\r\n");
 }
 
 void appendChunked(std::string& out, const std::string& body) {
-  out += hexLower(body.size());
-  out += "\r\n";
-  out += body;
-  out += "\r\n0\r\n\r\n";
+  if (!body.empty()) {
+    appendHex(out, (unsigned long long)body.size());
+    WS_APPEND_LIT(out, "\r\n");
+    out += body;
+    WS_APPEND_LIT(out, "\r\n");
+  }
+  WS_APPEND_LIT(out, "0\r\n\r\n");
 }
 
-} // namespace ws
\ No newline at end of file
+#undef WS_APPEND_LIT
+
+} // namespace ws
@@ -0,0 +1,97 @@
+#include "webserv/net/ResponseCache.hpp"
+
+namespace ws {
+
+std::string ResponseCache::key(const std::string& method, const std::string& host,
+                               const std::string& target) {
+  std::string k;
+  k.reserve(method.size() + host.size() + target.size() + 2);
+  k += method;
+  k += ' ';
+  for (size_t i = 0; i < host.size(); ++i) {
+    char c = host[i];
+    k += (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c;
+  }
+  k += ' ';
+  k += target;
+  return k;
+}
+
+ResponseCache::Lookup ResponseCache::lookup(const std::string& key, long long nowMs, bool lock,
+                                            CacheWaiter* w, const CachedResponse** hit) {
+  std::map<std::string, Entry>::iterator it = _entries.find(key);
+  if (it != _entries.end()) {
+    if (it->second.expires > nowMs) {
+      *hit = &it->second.resp;
+      return HIT;
+    }
+    erase(it);
+  }
+  if (!lock) return MISS;
+  std::map<std::string, std::vector<CacheWaiter*> >::iterator l = _locks.find(key);
+  if (l != _locks.end()) {
+    l->second.push_back(w);
+    return WAIT;
+  }
+  _locks[key]; // теперь мы производитель
+  return MISS;
+}
+
+void ResponseCache::store(const std::string& key, const CachedResponse& r,
+                          long long nowMs, long long ttlMs) {
+  if (r.body.size() <= MAX_ENTRY) {
+    std::map<std::string, Entry>::iterator it = _entries.find(key);
+    if (it != _entries.end()) erase(it);
+    Entry& e = _entries[key];
+    e.resp = r;
+    e.expires = nowMs + ttlMs;
+    _byExpiry.insert(std::make_pair(e.expires, key));
+    _bytes += r.body.size();
+    evict(nowMs);
+  }
+  unlock(key);
+}
+
+void ResponseCache::unlock(const std::string& key) {
+  std::map<std::string, std::vector<CacheWaiter*> >::iterator l = _locks.find(key);
+  if (l == _locks.end()) return;
+  std::vector<CacheWaiter*> waiters;
+  waiters.swap(l->second);
+  _locks.erase(l);
+  // каждый смотрит ключ заново: попадание — или к бэкенду сам
+  for (size_t i = 0; i < waiters.size(); ++i) waiters[i]->onCacheReady();
+}
+
+void ResponseCache::cancel(const std::string& key, CacheWaiter* w) {
+  std::map<std::string, std::vector<CacheWaiter*> >::iterator l = _locks.find(key);
+  if (l == _locks.end()) return;
+  for (size_t i = 0; i < l->second.size(); ++i) {
+    if (l->second[i] == w) {
+      l->second.erase(l->second.begin() + (long)i);
+      return;
+    }
+  }
+}
+
+void ResponseCache::erase(std::map<std::string, Entry>::iterator it) {
+  std::pair<ExpiryIndex::iterator, ExpiryIndex::iterator> r = _byExpiry.equal_range(it->second.expires);
+  for (ExpiryIndex::iterator x = r.first; x != r.second; ++x) {
+    if (x->second == it->first) {
+      _byExpiry.erase(x);
+      break;
+    }
+  }
+  _bytes -= it->second.resp.body.size();
+  _entries.erase(it);
+}
+
+void ResponseCache::evict(long long nowMs) {
+  // сначала просроченные, затем — ближайшие к истечению, пока не влезем
+  while (!_byExpiry.empty() && (_byExpiry.begin()->first <= nowMs || _bytes > MAX_BYTES)) {
+    std::map<std::string, Entry>::iterator it = _entries.find(_byExpiry.begin()->second);
+    if (it == _entries.end()) { _byExpiry.erase(_byExpiry.begin()); continue; }
+    erase(it);
+  }
+}
+
+} // namespace ws
@@ -0,0 +1,97 @@
+#include "webserv/net/ResumableUpload.hpp"
+#include "webserv/utils/IO.hpp"
+#include "webserv/Log.hpp"
+
+#include <sstream>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+
+namespace ws {
+
+static std::string indexPath(const std::string& dir) {
+  return dir + "/.resumable";
+}
+
+std::string ResumableUploads::partPath(const std::string& dir, const std::string& id) {
+  return dir + "/" + id + ".part";
+}
+
+ResumableUploads::Sessions& ResumableUploads::load(const std::string& dir) {
+  std::map<std::string, Sessions>::iterator it = _dirs.find(dir);
+  if (it != _dirs.end()) return it->second;
+  Sessions& s = _dirs[dir];
+  std::string text;
+  if (!readWholeFile(indexPath(dir), text)) return s; // индекса ещё нет
+  std::istringstream in(text);
+  std::string id;
+  UploadSession u;
+  while (in >> id >> u.length >> u.offset >> u.touched) {
+    if (u.offset > u.length) u.offset = u.length;
+    // индекс мог попасть на диск раньше данных: offset — не дальше реального размера
+    struct stat st;
+    if (::stat(partPath(dir, id).c_str(), &st) == 0 && (unsigned long long)st.st_size < u.offset)
+      u.offset = (unsigned long long)st.st_size;
+    s[id] = u;
+  }
+  return s;
+}
+
+UploadSession* ResumableUploads::create(const std::string& dir, const std::string& id,
+                                        unsigned long long length) {
+  if (!ensureDirRecursive(dir)) return 0;
+  int fd = ::open(partPath(dir, id).c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+  if (fd < 0) return 0;
+  ::close(fd);
+  Sessions& s = load(dir);
+  UploadSession& u = s[id];
+  u.length = length;
+  u.touched = (long long)std::time(0);
+  if (!save(dir)) {
+    ::unlink(partPath(dir, id).c_str());
+    s.erase(id);
+    return 0;
+  }
+  return &s[id];
+}
+
+UploadSession* ResumableUploads::find(const std::string& dir, const std::string& id) {
+  Sessions& s = load(dir);
+  Sessions::iterator it = s.find(id);
+  return it == s.end() ? 0 : &it->second;
+}
+
+bool ResumableUploads::save(const std::string& dir) {
+  Sessions& s = load(dir);
+  const long long now = (long long)std::time(0);
+  std::ostringstream out;
+  for (Sessions::iterator it = s.begin(); it != s.end();) {
+    if (!it->second.busy && now - it->second.touched > EXPIRE_SEC) {
+      ::unlink(partPath(dir, it->first).c_str()); // брошенная загрузка
+      s.erase(it++);
+      continue;
+    }
+    out << it->first << ' ' << it->second.length << ' ' << it->second.offset << ' '
+        << it->second.touched << '\n';
+    ++it;
+  }
+  // индекс целиком во временный файл и rename: после сбоя — либо старый, либо новый
+  const std::string tmp = indexPath(dir) + ".tmp";
+  if (!writeBinary(tmp, out.str()) || std::rename(tmp.c_str(), indexPath(dir).c_str()) != 0) {
+    WS_LOG_WARN("resumable upload index write failed in " + dir);
+    return false;
+  }
+  return true;
+}
+
+bool ResumableUploads::finish(const std::string& dir, const std::string& id) {
+  Sessions& s = load(dir);
+  if (std::rename(partPath(dir, id).c_str(), (dir + "/" + id).c_str()) != 0) return false;
+  s.erase(id);
+  save(dir);
+  return true;
+}
+
+} // namespace ws
@@ -0,0 +1,284 @@
+#include "webserv/net/StatusPage.hpp"
+#include <cstdio>
+#include <cstring>
+#include "webserv/net/ResponseBuilder.hpp"
+#include "webserv/http/Request.hpp"
+
+namespace ws {
+
+struct MetricInfo {
+  const char* name;  // webserv_<name>
+  const char* help;
+};
+
+// порядок — как в Metrics::Counter
+static const MetricInfo kCounters[Metrics::COUNTER_COUNT] = {
+  { "connections_accepted", "Accepted client connections." },
+  { "requests", "Responses sent in full." },
+  { 0, 0 }, { 0, 0 }, { 0, 0 }, { 0, 0 }, { 0, 0 },  // RESP_*: одна метрика с меткой class
+  { "received_bytes", "Bytes read from clients." },
+  { "sent_bytes", "Bytes written to clients." },
+  { "cgi_spawns", "CGI processes started (per request and pool workers)." },
+  { "parse_errors", "Requests rejected by the parser (400/411/413/501)." },
+  { "cache_hits", "Responses served from the cache_valid microcache." },
+  { "cache_misses", "Cacheable requests that missed the microcache." },
+  { "aio_tasks", "Jobs run on aio pool threads." },
+  { "access_log_dropped", "access_log lines dropped because the ring buffer was full." },
+};
+
+static const MetricInfo kGauges[Metrics::GAUGE_COUNT] = {
+  { "connections_active", "Open client connections." },
+  { "connections_idle", "Connections waiting for a request." },
+};
+
+static void line(std::string& out, const char* label, unsigned long long v) {
+  out += label;
+  appendUint(out, v);
+  out += '\n';
+}
+
+static void promHeader(std::string& out, const std::string& name, const char* help, const char* type) {
+  out += "# HELP " + name + ' ' + help + "\n# TYPE " + name + ' ' + type + '\n';
+}
+
+static void promValue(std::string& out, const std::string& name, unsigned long long v) {
+  out += name + ' ';
+  appendUint(out, v);
+  out += '\n';
+}
+
+static std::string lower(const std::string& s) {
+  std::string r(s);
+  for (size_t i = 0; i < r.size(); ++i)
+    if (r[i] >= 'A' && r[i] <= 'Z') r[i] = char(r[i] - 'A' + 'a');
+  return r;
+}
+
+bool statusWantsPrometheus(const HttpRequest& req) {
+  const std::string& t = req.target;
+  size_t q = t.find('?');
+  if (q != std::string::npos && (t.find("format=prometheus", q) != std::string::npos)) return true;
+  std::string accept = lower(req.getHeader("accept"));
+  return accept.find("openmetrics") != std::string::npos || accept.find("version=0.0.4") != std::string::npos;
+}
+
+const char* statusContentType(bool prometheus) {
+  return prometheus ? "text/plain; version=0.0.4; charset=utf-8" : "text/plain; charset=utf-8";
+}
+
+// границы корзин Prometheus (мкс); внутри — по границам LatencyHistogram, с точностью до 1/16
+static const struct { unsigned long long us; const char* le; } kBounds[] = {
+  { 500, "0.0005" }, { 1000, "0.001" }, { 2500, "0.0025" }, { 5000, "0.005" },
+  { 10000, "0.01" }, { 25000, "0.025" }, { 50000, "0.05" }, { 100000, "0.1" },
+  { 250000, "0.25" }, { 500000, "0.5" }, { 1000000, "1" }, { 2500000, "2.5" },
+  { 5000000, "5" }, { 10000000, "10" },
+};
+
+static const double kQuantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+
+static void appendFixed(std::string& out, double v, int prec) {
+  char buf[64];
+  std::snprintf(buf, sizeof(buf), "%.*f", prec, v);
+  out += buf;
+}
+
+static const LatencyHistogram* latencyOf(const StatusReport& r, size_t slot, Metrics::Latency k) {
+  const size_t i = slot * Metrics::LATENCY_KINDS + k;
+  return i < r.latency.size() ? &r.latency[i] : 0;
+}
+
+static std::string serverName(const ServerConfig& s) {
+  std::string n = s.server_names.empty() ? s.host : s.server_names[0];
+  n += ':';
+  appendUint(n, (unsigned long long)s.port);
+  return n;
+}
+
+static std::string locationName(const Location& l) {
+  if (l.match == LOC_EXACT) return "= " + l.path;
+  if (l.match == LOC_REGEX) return (l.regex_icase ? "~* " : "~ ") + l.path;
+  return l.path;
+}
+
+// " requests N total p50 p90 p99 p999 ttfb p50 p90 p99 p999" (мс)
+static void latencyLine(std::string& out, const std::string& label,
+                        const LatencyHistogram& total, const LatencyHistogram& ttfb) {
+  out += label;
+  out += ": requests ";
+  appendUint(out, total.total);
+  const LatencyHistogram* h[2] = { &total, &ttfb };
+  for (int k = 0; k < 2; ++k) {
+    out += k ? " ttfb" : " total";
+    for (size_t q = 0; q < sizeof(kQuantiles) / sizeof(kQuantiles[0]); ++q) {
+      out += ' ';
+      appendFixed(out, (double)h[k]->percentile(kQuantiles[q]) / 1000.0, 3);
+    }
+  }
+  out += '\n';
+}
+
+static void renderLatencyText(std::string& out, const StatusReport& r) {
+  if (!r.cfg || r.latency.empty()) return;
+  out += "Latency, ms (p50 p90 p99 p999):\n";
+  for (size_t i = 0; i < r.cfg->servers.size(); ++i) {
+    const ServerConfig& s = r.cfg->servers[i];
+    LatencyHistogram all[2];
+    std::memset(all, 0, sizeof(all));
+    std::string locs;
+    for (size_t j = 0; j <= s.locations.size(); ++j) {
+      const size_t slot = j < s.locations.size() ? s.locations[j].stats_slot : s.stats_slot;
+      const LatencyHistogram* t = latencyOf(r, slot, Metrics::LAT_TOTAL);
+      const LatencyHistogram* f = latencyOf(r, slot, Metrics::LAT_TTFB);
+      if (!t || !f || !t->total) continue;
+      all[0].merge(*t);
+      all[1].merge(*f);
+      if (j < s.locations.size()) latencyLine(locs, "  location " + locationName(s.locations[j]), *t, *f);
+    }
+    if (!all[0].total) continue;
+    latencyLine(out, "server " + serverName(s), all[0], all[1]);
+    out += locs;
+  }
+}
+
+static std::string promLabel(const std::string& v) {
+  std::string r;
+  for (size_t i = 0; i < v.size(); ++i) {
+    if (v[i] == '\\' || v[i] == '"') r += '\\';
+    if (v[i] == '\n') { r += "\\n"; continue; }
+    r += v[i];
+  }
+  return r;
+}
+
+static void promHistogram(std::string& out, const std::string& name, const std::string& labels,
+                          const LatencyHistogram& h) {
+  for (size_t b = 0; b < sizeof(kBounds) / sizeof(kBounds[0]); ++b)
+    promValue(out, name + "_bucket{" + labels + ",le=\"" + kBounds[b].le + "\"}", h.countAtMost(kBounds[b].us));
+  promValue(out, name + "_bucket{" + labels + ",le=\"+Inf\"}", h.total);
+  out += name + "_sum{" + labels + "} ";
+  appendFixed(out, (double)h.sum / 1e6, 6);
+  out += '\n';
+  promValue(out, name + "_count{" + labels + "}", h.total);
+}
+
+static void renderLatencyPrometheus(std::string& out, const StatusReport& r) {
+  if (!r.cfg || r.latency.empty()) return;
+  static const char* const names[Metrics::LATENCY_KINDS] = {
+    "webserv_request_duration_seconds", "webserv_time_to_first_byte_seconds"
+  };
+  static const char* const help[Metrics::LATENCY_KINDS] = {
+    "From the first request byte read to the last response byte sent.",
+    "From the first request byte read to the first response byte sent."
+  };
+  for (int k = 0; k < Metrics::LATENCY_KINDS; ++k) {
+    promHeader(out, names[k], help[k], "histogram");
+    for (size_t i = 0; i < r.cfg->servers.size(); ++i) {
+      const ServerConfig& s = r.cfg->servers[i];
+      const std::string srv = "server=\"" + promLabel(serverName(s)) + "\",location=\"";
+      for (size_t j = 0; j <= s.locations.size(); ++j) {
+        const bool own = j == s.locations.size();
+        const size_t slot = own ? s.stats_slot : s.locations[j].stats_slot;
+        const LatencyHistogram* h = latencyOf(r, slot, (Metrics::Latency)k);
+        if (!h) continue;
+        promHistogram(out, names[k], srv + (own ? "" : promLabel(locationName(s.locations[j]))) + "\"", *h);
+      }
+    }
+  }
+}
+
+static std::string renderText(const StatusReport& r) {
+  const unsigned long long* c = r.metrics.counters;
+  const long long* g = r.metrics.gauges;
+  std::string out;
+  // первые строки — как у nginx stub_status: их понимают готовые парсеры
+  line(out, "Active connections: ", (unsigned long long)g[Metrics::CONN_ACTIVE]);
+  out += "server accepts handled requests\n ";
+  appendUint(out, c[Metrics::CONN_ACCEPTED]);
+  out += ' ';
+  appendUint(out, c[Metrics::CONN_ACCEPTED]);
+  out += ' ';
+  appendUint(out, c[Metrics::REQUESTS]);
+  out += "\nReading: 0 Writing: ";
+  appendUint(out, (unsigned long long)(g[Metrics::CONN_ACTIVE] - g[Metrics::CONN_IDLE]));
+  out += " Waiting: ";
+  appendUint(out, (unsigned long long)g[Metrics::CONN_IDLE]);
+  out += "\nResponses: 1xx ";
+  for (int i = 0; i < 5; ++i) {
+    if (i) {
+      out += ' ';
+      out += char('1' + i);
+      out += "xx ";
+    }
+    appendUint(out, c[Metrics::RESP_1XX + i]);
+  }
+  out += '\n';
+  line(out, "Bytes received: ", c[Metrics::BYTES_IN]);
+  line(out, "Bytes sent: ", c[Metrics::BYTES_OUT]);
+  line(out, "CGI spawns: ", c[Metrics::CGI_SPAWNS]);
+  line(out, "Parse errors: ", c[Metrics::PARSE_ERRORS]);
+  out += "Cache: hits ";
+  appendUint(out, c[Metrics::CACHE_HITS]);
+  out += " misses ";
+  appendUint(out, c[Metrics::CACHE_MISSES]);
+  out += "\nAio: threads ";
+  appendUint(out, r.aio.threads);
+  out += " queued ";
+  appendUint(out, r.aio.queued);
+  out += " running ";
+  appendUint(out, r.aio.running);
+  out += " completed ";
+  appendUint(out, r.aio.completed);
+  out += " inlined ";
+  appendUint(out, r.aio.inlined);
+  out += "\nUpload syncs: requests ";
+  appendUint(out, r.commits.requests);
+  out += " batches ";
+  appendUint(out, r.commits.batches);
+  out += " failures ";
+  appendUint(out, r.commits.failures);
+  out += '\n';
+  line(out, "Access log dropped: ", c[Metrics::ACCESS_LOG_DROPS]);
+  line(out, "Metric threads: ", r.metrics.threads);
+  renderLatencyText(out, r);
+  return out;
+}
+
+static std::string renderPrometheus(const StatusReport& r) {
+  std::string out;
+  for (size_t i = 0; i < Metrics::COUNTER_COUNT; ++i) {
+    if (i == Metrics::RESP_1XX) {
+      promHeader(out, "webserv_responses_total", "Responses by status class.", "counter");
+      for (int k = 0; k < 5; ++k) {
+        std::string name = "webserv_responses_total{class=\"";
+        name += char('1' + k);
+        name += "xx\"}";
+        promValue(out, name, r.metrics.counters[Metrics::RESP_1XX + k]);
+      }
+    }
+    if (!kCounters[i].name) continue;
+    const std::string name = std::string("webserv_") + kCounters[i].name + "_total";
+    promHeader(out, name, kCounters[i].help, "counter");
+    promValue(out, name, r.metrics.counters[i]);
+  }
+  for (size_t i = 0; i < Metrics::GAUGE_COUNT; ++i) {
+    const std::string name = std::string("webserv_") + kGauges[i].name;
+    promHeader(out, name, kGauges[i].help, "gauge");
+    promValue(out, name, (unsigned long long)r.metrics.gauges[i]);
+  }
+  promHeader(out, "webserv_aio_queued", "Jobs waiting for an aio thread.", "gauge");
+  promValue(out, "webserv_aio_queued", r.aio.queued);
+  promHeader(out, "webserv_aio_inlined_total", "Jobs run on the loop because the aio queue was full.", "counter");
+  promValue(out, "webserv_aio_inlined_total", r.aio.inlined);
+  promHeader(out, "webserv_upload_sync_batches_total", "upload_durability group commits.", "counter");
+  promValue(out, "webserv_upload_sync_batches_total", r.commits.batches);
+  promHeader(out, "webserv_upload_sync_failures_total", "Uploads whose fsync failed.", "counter");
+  promValue(out, "webserv_upload_sync_failures_total", r.commits.failures);
+  renderLatencyPrometheus(out, r);
+  return out;
+}
+
+std::string renderStatus(const StatusReport& r, bool prometheus) {
+  return prometheus ? renderPrometheus(r) : renderText(r);
+}
+
+} // namespace ws
@@ -4,6 +4,8 @@
 #include <sstream>
 #include <ctime>
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
 #include <sys/stat.h>
 
 namespace ws {
@@ -19,7 +21,7 @@ static std::string genUploadName() {
 std::pair<int,std::string> handleUpload(const ws::RouteMatch& m,
                                         const ws::HttpRequest& req,
                                         std::string& outLocation) {
-  if (req.method != "POST" || !m.location || !m.location->upload_enable || m.location->upload_store.empty())
+  if (req.method_id != M_POST || !m.location || !m.location->upload_enable || m.location->upload_store.empty())
     return std::make_pair(0, std::string());
 
   // size limit: loc > server > 10M
@@ -47,4 +49,108 @@ std::pair<int,std::string> handleUpload(const ws::RouteMatch& m,
   return std::make_pair(201, "201 Created\n");
 }
 
-} // namespace ws
\ No newline at end of file
+// ---------------- MultipartUpload ----------------
+
+static void jsonString(std::string& out, const std::string& s) {
+  static const char hex[] = "0123456789abcdef";
+  out += '"';
+  for (size_t i = 0; i < s.size(); ++i) {
+    unsigned char c = (unsigned char)s[i];
+    if (c == '"' || c == '\\') { out += '\\'; out += (char)c; }
+    else if (c < 0x20) { out += "\\u00"; out += hex[c >> 4]; out += hex[c & 15]; }
+    else out += (char)c;
+  }
+  out += '"';
+}
+
+MultipartUpload::MultipartUpload(const std::string& boundary, const std::string& dir,
+                                 const std::string& base, const std::string& urlPrefix)
+  : _parser(boundary), _dir(dir), _base(base), _urlPrefix(urlPrefix),
+    _fd(-1), _committed(false), _writeFailed(false) {}
+
+MultipartUpload::~MultipartUpload() {
+  if (_fd >= 0) ::close(_fd);
+  if (_committed) return;
+  // оборванная/битая загрузка не оставляет полуфайлов
+  for (size_t i = 0; i < _parts.size(); ++i) ::unlink(_parts[i].path.c_str());
+}
+
+bool MultipartUpload::open() {
+  return ensureDirRecursive(_dir);
+}
+
+bool MultipartUpload::feed(const char* data, size_t n) {
+  return _parser.feed(data, n, *this);
+}
+
+bool MultipartUpload::partBegin(const MultipartPart& p) {
+  std::ostringstream name;
+  name << _base << "_" << (_parts.size() + 1);
+  Stored s;
+  s.part = p;
+  s.path = _dir + "/" + name.str();
+  s.url = _urlPrefix + name.str();
+  s.size = 0;
+  _fd = ::open(s.path.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+  if (_fd < 0) {
+    _writeFailed = true;
+    return false;
+  }
+  _parts.push_back(s);
+  return true;
+}
+
+bool MultipartUpload::partData(const char* data, size_t n) {
+  _parts.back().size += n;
+  while (n) {
+    ssize_t w = ::write(_fd, data, n);
+    if (w < 0) {
+      if (errno == EINTR) continue;
+      _writeFailed = true;
+      return false;
+    }
+    data += w;
+    n -= static_cast<size_t>(w);
+  }
+  return true;
+}
+
+bool MultipartUpload::partEnd() {
+  int fd = _fd;
+  _fd = -1;
+  if (::close(fd) != 0) {
+    _writeFailed = true; // отложенная ошибка записи (NFS, квота)
+    return false;
+  }
+  return true;
+}
+
+std::vector<std::string> MultipartUpload::paths() const {
+  std::vector<std::string> out;
+  for (size_t i = 0; i < _parts.size(); ++i) out.push_back(_parts[i].path);
+  return out;
+}
+
+std::string MultipartUpload::commit() {
+  _committed = true;
+  std::string json = "{\"files\":[";
+  for (size_t i = 0; i < _parts.size(); ++i) {
+    const Stored& s = _parts[i];
+    std::ostringstream size;
+    size << s.size;
+    if (i) json += ',';
+    json += "{\"field\":";
+    jsonString(json, s.part.name);
+    json += ",\"filename\":";
+    jsonString(json, s.part.filename);
+    json += ",\"content_type\":";
+    jsonString(json, s.part.contentType);
+    json += ",\"size\":" + size.str() + ",\"location\":";
+    jsonString(json, s.url);
+    json += '}';
+  }
+  json += "]}\n";
+  return json;
+}
+
+} // namespace ws
@@ -0,0 +1,39 @@
+#include "webserv/utils/Histogram.hpp"
+
+namespace ws {
+
+unsigned long long LatencyHistogram::bucketHigh(size_t i) {
+  if (i < SUB) return i;
+  const size_t k = i - SUB;
+  const unsigned shift = (unsigned)(k / SUB);
+  const unsigned long long low = (unsigned long long)(SUB + k % SUB) << shift;
+  return low + (1ULL << shift) - 1;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& o) {
+  for (size_t i = 0; i < BUCKETS; ++i) counts[i] += o.counts[i];
+  total += o.total;
+  sum += o.sum;
+}
+
+unsigned long long LatencyHistogram::percentile(double q) const {
+  if (!total) return 0;
+  // ранг: наименьший n, для которого n/total >= q
+  unsigned long long rank = (unsigned long long)(q * (double)total);
+  if ((double)rank < q * (double)total) ++rank;
+  if (rank == 0) rank = 1;
+  unsigned long long seen = 0;
+  for (size_t i = 0; i < BUCKETS; ++i) {
+    seen += counts[i];
+    if (seen >= rank) return bucketHigh(i);
+  }
+  return bucketHigh(BUCKETS - 1);
+}
+
+unsigned long long LatencyHistogram::countAtMost(unsigned long long us) const {
+  unsigned long long n = 0;
+  for (size_t i = 0; i < BUCKETS && bucketHigh(i) <= us; ++i) n += counts[i];
+  return n;
+}
+
+} // namespace ws
@@ -1,8 +1,18 @@
+#ifdef __linux__
+# ifndef _GNU_SOURCE
+#  define _GNU_SOURCE // splice()
+# endif
+#endif
 #include "webserv/utils/IO.hpp"
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <errno.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#ifdef __linux__
+# include <sys/sendfile.h>
+#endif
 #include <fstream>
 #include <sstream>
 #include <string>
@@ -41,6 +51,11 @@ bool writeBinary(const std::string& path, const std::string& data) {
   return true;
 }
 
+bool ioTryAgain() {
+  int err = errno;
+  return err == EAGAIN || err == EWOULDBLOCK || err == EINTR;
+}
+
 bool ensureDirRecursive(const std::string& dir) {
   if (dir.empty()) return false;
 
@@ -69,4 +84,38 @@ bool ensureDirRecursive(const std::string& dir) {
   return true;
 }
 
-} // namespace ws
\ No newline at end of file
+#ifdef __linux__
+bool haveSplice() { return true; }
+
+long spliceBytes(int from, int to, size_t n) {
+  ssize_t r = ::splice(from, 0, to, 0, n, SPLICE_F_MOVE | SPLICE_F_NONBLOCK | SPLICE_F_MORE);
+  return r < 0 ? -1 : (long)r;
+}
+
+long sendFileBytes(int sock, int fd, off_t& off, size_t n) {
+  ssize_t r = ::sendfile(sock, fd, &off, n); // сдвигает off сам
+  return r < 0 ? -1 : (long)r;
+}
+#else
+bool haveSplice() { return false; }
+
+long spliceBytes(int, int, size_t) { return -1; }
+
+long sendFileBytes(int sock, int fd, off_t& off, size_t n) {
+  char buf[65536];
+  ssize_t r = ::pread(fd, buf, n < sizeof(buf) ? n : sizeof(buf), off);
+  if (r <= 0) return r < 0 ? -1 : 0;
+  ssize_t w = ::send(sock, buf, (size_t)r, 0);
+  if (w <= 0) return -1; // недописанное прочитаем заново со старого off
+  off += w;
+  return (long)w;
+}
+#endif
+
+long pendingBytes(int fd) {
+  int n = 0;
+  if (::ioctl(fd, FIONREAD, &n) != 0) return -1;
+  return n;
+}
+
+} // namespace ws
@@ -0,0 +1,87 @@
+#include "webserv/utils/Metrics.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+#include <pthread.h>
+
+namespace ws {
+
+static const size_t CACHE_LINE = 64;
+
+__thread MetricsShard* Metrics::_shard = 0;
+
+// все выданные шарды; под g_mu только добавление и обход, сами счётчики — без него
+static pthread_mutex_t g_mu = PTHREAD_MUTEX_INITIALIZER;
+static std::vector<MetricsShard*>* g_shards = 0;  // не освобождается: потоки пишут до exit
+static size_t g_latencySlots = 0;                 // задаётся до старта потоков, дальше только читается
+
+static void* alignedZero(size_t bytes) {
+  // размер — кратный линии кэша: соседний блок начинается с новой линии
+  const size_t size = (bytes + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+  void* mem = 0;
+  if (posix_memalign(&mem, CACHE_LINE, size) != 0) throw std::bad_alloc();
+  std::memset(mem, 0, size);
+  return mem;
+}
+
+void Metrics::setLatencySlots(size_t n) { g_latencySlots = n; }
+size_t Metrics::latencySlots() { return g_latencySlots; }
+
+MetricsShard* Metrics::attach() {
+  MetricsShard* s = static_cast<MetricsShard*>(alignedZero(sizeof(MetricsShard)));
+
+  pthread_mutex_lock(&g_mu);
+  if (!g_shards) g_shards = new std::vector<MetricsShard*>;
+  g_shards->push_back(s);
+  pthread_mutex_unlock(&g_mu);
+  _shard = s;
+  return s;
+}
+
+MetricsSnapshot Metrics::snapshot() {
+  MetricsSnapshot snap;
+  std::memset(&snap, 0, sizeof(snap));
+  pthread_mutex_lock(&g_mu);
+  if (g_shards) {
+    // чужие шарды читаются без синхронизации: выровненное 64-битное слово
+    // не рвётся, а отставание на пару инкрементов для статистики не важно
+    for (size_t i = 0; i < g_shards->size(); ++i) {
+      const volatile MetricsShard* s = (*g_shards)[i];
+      for (size_t c = 0; c < COUNTER_COUNT; ++c) snap.counters[c] += s->counters[c];
+      for (size_t g = 0; g < GAUGE_COUNT; ++g) snap.gauges[g] += s->gauges[g];
+    }
+    snap.threads = g_shards->size();
+  }
+  pthread_mutex_unlock(&g_mu);
+  return snap;
+}
+
+LatencyHistogram* Metrics::attachLatency(MetricsShard* s) {
+  if (!g_latencySlots) return 0;
+  LatencyHistogram* h = static_cast<LatencyHistogram*>(
+      alignedZero(g_latencySlots * LATENCY_KINDS * sizeof(LatencyHistogram)));
+  // под мьютексом: snapshot() не должен увидеть указатель раньше обнулённой памяти
+  pthread_mutex_lock(&g_mu);
+  s->latency = h;
+  pthread_mutex_unlock(&g_mu);
+  return h;
+}
+
+void Metrics::latencySnapshot(std::vector<LatencyHistogram>& out) {
+  const size_t n = g_latencySlots * LATENCY_KINDS;
+  out.resize(n);
+  if (n) std::memset(&out[0], 0, n * sizeof(LatencyHistogram));
+  pthread_mutex_lock(&g_mu);
+  if (g_shards) {
+    for (size_t i = 0; i < g_shards->size(); ++i) {
+      const LatencyHistogram* h = (*g_shards)[i]->latency;
+      if (!h) continue;
+      for (size_t k = 0; k < n; ++k) out[k].merge(h[k]);
+    }
+  }
+  pthread_mutex_unlock(&g_mu);
+}
+
+} // namespace ws
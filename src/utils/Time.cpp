@@ -21,6 +21,32 @@ std::string httpDateNow() {
   return fmtGmt(gmt);
 }
 
+long long monotonicMs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+long long monotonicUs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static std::string g_dateCache;
+static time_t      g_dateSec = (time_t)-1;
+
+void refreshHttpDate(time_t now) {
+  if (now == g_dateSec) return;
+  g_dateSec = now;
+  g_dateCache = httpDateFrom(now);
+}
+
+const std::string& httpDateCached() {
+  if (g_dateSec == (time_t)-1) refreshHttpDate(std::time(0));
+  return g_dateCache;
+}
+
 std::string httpDateFrom(time_t t) {
   std::tm gmt;
 #if defined(_WIN32)
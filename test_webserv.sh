@@ -135,6 +135,14 @@ fi
 res="$(curl_do GET "$BASE/cgi/chunked.py")"; code="${res%%:*}"
 if [[ "$code" == "200" ]]; then ok "CGI chunked.py -> 200"; else note "CGI chunked.py -> $code (опционально)"; fi
 
+# ------------------ 8b) CGI: тело запроса (chunked) -> stdin
+res="$(curl_do POST "$BASE/cgi/hello.py" -H 'Transfer-Encoding: chunked' --data-binary "cgi-stdin-$$")"; code="${res%%:*}"; rest="${res#*:}"; body="${rest##*:}"
+if [[ "$code" == "200" ]]; then
+  if grep -q "cgi-stdin-$$" "$body"; then ok "CGI получил chunked-тело в stdin"; else bad "CGI 200, но тела в выводе нет"; fi
+else
+  note "CGI POST hello.py -> $code (проверь конфиг CGI)"
+fi
+
 # ------------------ 9) Upload (POST) + GET + DELETE -----
 payload="test-$(date +%s).$$"
 res="$(curl_do POST "$BASE/upload" --data-binary "$payload")"; code="${res%%:*}"; rest="${res#*:}"; hdr="${rest%%:*}"
@@ -207,6 +215,135 @@ else
   note "Проверки server_name пропущены (не переданы --vhost кейсы)"
 fi
 
+# ------------------ 14) Выбор location: = / ~ / ~* / префикс
+# нужны location /rt/... из examples/two_dragons.conf: каждый отвечает
+# 301 на /rt-hit/<имя>, по нему и видно, какой location выбран
+rt_hit() { # path -> имя location (пусто, если не 301)
+  local res code rest hdr
+  res="$(curl_do GET "$BASE$1")"; code="${res%%:*}"; rest="${res#*:}"; hdr="${rest%%:*}"
+  [[ "$code" == "301" ]] || return 0
+  get_header "$hdr" 'Location' | sed 's#.*/rt-hit/##'
+}
+expect_route() { # path want ctx
+  local got; got="$(rt_hit "$1")"
+  if [[ "$got" == "$2" ]]; then ok "$3: $1 -> $2"; else bad "$3: $1 ожидался location '$2', получили '${got:-нет 301}'"; fi
+}
+if [[ "$(rt_hit /rt/)" == "prefix" ]]; then
+  say ""; say "${BOLD}Выбор location${NC}"
+  expect_route /rt/exact.php      exact  "= важнее regex"
+  expect_route /rt/page.php       php    "regex важнее префикса"
+  expect_route "/rt/page.php?x=1" php    "query не мешает '\$'"
+  expect_route /rt/order/a        first  "из двух regex — первый в конфиге"
+  expect_route /rt/x/order/       second "второй regex, когда первый не подходит"
+  expect_route /rt/anchor         anchor "^...\$ — точное совпадение"
+  expect_route /rt/anchor/x       prefix "'\$' не даёт совпасть с продолжением"
+  expect_route /rt/sub/rt/anchor  prefix "'^' не даёт совпасть с середины"
+  expect_route /rt/PHOTO.JPG      icase  "~* без учёта регистра"
+  expect_route /rt/page.PHP       prefix "~ с учётом регистра"
+  expect_route /rt/readme.txt     prefix "нет regex — префикс"
+  expect_route /rt/alt            alt    "якоря ветви: ^...\$|..."
+  expect_route /rt/x/alt-any      alt    "'^' первой ветви не действует на вторую"
+  expect_route /rt/alt/x          prefix "'\$' первой ветви держит её конец"
+else
+  note "Проверки выбора location пропущены (нет location /rt/, см. examples/two_dragons.conf)"
+fi
+
+# ------------------ 15) multipart/form-data ------------
+# файлы частей видны через autoindex на /uploads/ (как в examples/two_dragons.conf)
+count_uploads() { curl -sS "$BASE/uploads/" | grep -o 'href="up_[^"]*"' | sort -u | wc -l | tr -d ' '; }
+json_locations() { grep -o '"location":"[^"]*"' "$1" | sed 's#^"location":"##; s#"$##'; }
+res="$(curl_do GET "$BASE/uploads/")"; code="${res%%:*}"; rest="${res#*:}"; body="${rest##*:}"
+if [[ "$code" == "200" ]] && grep -q "Index of /uploads/" "$body"; then
+  say ""; say "${BOLD}multipart/form-data${NC}"
+
+  # несколько файлов; --limit-rate дробит тело, и разделитель попадает на стык чтений
+  printf 'first-file-%s' "$$" > "$TMPDIR/mp1.txt"
+  head -c 300000 /dev/urandom > "$TMPDIR/mp2.bin"
+  res="$(curl_do POST "$BASE/upload" --limit-rate 512k -F "one=@$TMPDIR/mp1.txt" -F "two=@$TMPDIR/mp2.bin" -F "note=plain-$$")"
+  code="${res%%:*}"; rest="${res#*:}"; hdr="${rest%%:*}"; body="${rest##*:}"
+  expect_code "$code" "201" "POST /upload multipart (3 части)"
+  if contains "$(get_header "$hdr" 'Content-Type')" "application/json"; then ok "Ответ — JSON"; else bad "Ответ не JSON: $(get_header "$hdr" 'Content-Type')"; fi
+  locs=()
+  while IFS= read -r l; do [[ -n "$l" ]] && locs+=("$l"); done < <(json_locations "$body")
+  if [[ "${#locs[@]}" == "3" ]]; then ok "В JSON три части"; else bad "В JSON ${#locs[@]} частей вместо 3"; fi
+  grep -q '"field":"two","filename":"mp2.bin"' "$body" && ok "field и filename второй части в JSON" || bad "В JSON нет field/filename второй части"
+  srcs=("$TMPDIR/mp1.txt" "$TMPDIR/mp2.bin")
+  printf 'plain-%s' "$$" > "$TMPDIR/mp3.txt"; srcs+=("$TMPDIR/mp3.txt")
+  for i in "${!locs[@]}"; do
+    code="$(curl -sS -o "$TMPDIR/part" -w '%{http_code}' "$BASE${locs[$i]}")"
+    if [[ "$code" == "200" ]] && cmp -s "$TMPDIR/part" "${srcs[$i]:-/dev/null}"; then ok "Часть $((i+1)) сохранена байт в байт"; else bad "Часть $((i+1)) (${locs[$i]}) не совпала (код $code)"; fi
+  done
+
+  # имя файла клиента только попадает в JSON — с экранированием
+  bd="wsTestBoundary$$"
+  { printf -- '--%s\r\n' "$bd"
+    printf '%s\r\n' 'Content-Disposition: form-data; name="f"; filename="we\"ird\\name.txt"'
+    printf 'Content-Type: text/plain\r\n\r\nquoted\r\n--%s--\r\n' "$bd"; } > "$TMPDIR/mpq.body"
+  res="$(curl_do POST "$BASE/upload" -H "Content-Type: multipart/form-data; boundary=$bd" --data-binary @"$TMPDIR/mpq.body")"
+  code="${res%%:*}"; rest="${res#*:}"; body="${rest##*:}"
+  expect_code "$code" "201" "POST /upload с кавычкой в filename"
+  if grep -qF '"filename":"we\"ird\\name.txt"' "$body"; then ok "filename экранирован в JSON"; else bad "filename не экранирован: $(cat "$body")"; fi
+
+  # первая часть целиком, вторая оборвана: файлов остаться не должно
+  before="$(count_uploads)"
+  { printf -- '--%s\r\nContent-Disposition: form-data; name="a"; filename="a.txt"\r\n\r\n' "$bd"
+    head -c 4000 /dev/zero | tr '\0' 'a'
+    printf '\r\n--%s\r\nContent-Disposition: form-data; name="b"; filename="b.txt"\r\n\r\npartial' "$bd"; } > "$TMPDIR/mpt.body"
+  res="$(curl_do POST "$BASE/upload" -H "Content-Type: multipart/form-data; boundary=$bd" --data-binary @"$TMPDIR/mpt.body")"; code="${res%%:*}"
+  expect_code "$code" "400" "multipart без закрывающего разделителя"
+  after="$(count_uploads)"
+  [[ "$after" == "$before" ]] && ok "После 400 частей не осталось" || bad "После 400 осталось файлов: $((after-before))"
+  # клиент обещал больше, чем прислал, и ушёл
+  curl -s -o /dev/null --max-time 1 -H "Content-Type: multipart/form-data; boundary=$bd" -H "Content-Length: 100000" \
+    --data-binary @"$TMPDIR/mpt.body" "$BASE/upload" || true
+  sleep 0.5
+  after="$(count_uploads)"
+  [[ "$after" == "$before" ]] && ok "После обрыва соединения частей не осталось" || bad "После обрыва осталось файлов: $((after-before))"
+else
+  note "Проверки multipart пропущены (нет autoindex на /uploads/, см. examples/two_dragons.conf)"
+fi
+
+# ------------------ 16) Докачка (tus): POST/HEAD/PATCH -
+res="$(curl_do PUT "$BASE/upload")"; rest="${res#*:}"; hdr="${rest%%:*}"
+if contains "$(get_header "$hdr" 'Allow')" "PATCH"; then
+  say ""; say "${BOLD}Докачка (Upload-Offset)${NC}"
+  res="$(curl_do POST "$BASE/upload" -H 'Tus-Resumable: 1.0.0' -H 'Upload-Length: 10' --data-binary '')"
+  code="${res%%:*}"; rest="${res#*:}"; hdr="${rest%%:*}"
+  expect_code "$code" "201" "POST с Upload-Length создаёт сессию"
+  sess="$(get_header "$hdr" 'Location')"
+  if [[ -n "$sess" ]]; then
+    patch_do() { # offset data
+      curl_do PATCH "$BASE$sess" -H 'Tus-Resumable: 1.0.0' -H 'Content-Type: application/offset+octet-stream' \
+        -H "Upload-Offset: $1" --data-binary "$2"
+    }
+    res="$(patch_do 0 hello)"; code="${res%%:*}"; rest="${res#*:}"; hdr="${rest%%:*}"
+    expect_code "$code" "204" "PATCH первых 5 байт"
+    [[ "$(get_header "$hdr" 'Upload-Offset')" == "5" ]] && ok "PATCH вернул Upload-Offset: 5" || bad "PATCH: Upload-Offset='$(get_header "$hdr" 'Upload-Offset')'"
+    res="$(curl_do HEAD "$BASE$sess" -H 'Tus-Resumable: 1.0.0')"; code="${res%%:*}"; rest="${res#*:}"; hdr="${rest%%:*}"
+    expect_code "$code" "200" "HEAD сессии"
+    if [[ "$(get_header "$hdr" 'Upload-Offset')" == "5" && "$(get_header "$hdr" 'Upload-Length')" == "10" ]]; then
+      ok "HEAD: Upload-Offset 5 из 10"
+    else
+      bad "HEAD: Upload-Offset='$(get_header "$hdr" 'Upload-Offset')' Upload-Length='$(get_header "$hdr" 'Upload-Length')'"
+    fi
+    res="$(patch_do 2 xxxxx)"; code="${res%%:*}"
+    expect_code "$code" "409" "PATCH с неверным Upload-Offset"
+    res="$(patch_do 5 world)"; code="${res%%:*}"; rest="${res#*:}"; hdr="${rest%%:*}"
+    expect_code "$code" "204" "PATCH последних 5 байт"
+    done_loc="$(get_header "$hdr" 'Content-Location')"
+    if [[ -n "$done_loc" ]]; then
+      code="$(curl -sS -o "$TMPDIR/part" -w '%{http_code}' "$BASE$done_loc")"
+      [[ "$code" == "200" && "$(cat "$TMPDIR/part")" == "helloworld" ]] && ok "Собранный файл: helloworld" || bad "GET $done_loc: код $code, тело '$(cat "$TMPDIR/part")'"
+    else
+      bad "Завершающий PATCH без Content-Location"
+    fi
+  else
+    bad "201 без Location сессии"
+  fi
+else
+  note "Проверки докачки пропущены (PATCH не разрешён на /upload)"
+fi
+
 echo
 printf "%sИТОГО:%s %sPASS%s=%d  %sFAIL%s=%d\n" "$BOLD" "$NC" "$GREEN" "$NC" "$pass" "$RED" "$NC" "$fail"
 echo